@@ -0,0 +1,278 @@
+/*
+ * CBRBenchmark.cpp
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Scaling benchmark for CBRLfD retrieval, reuse and retain.
+ *
+ *  Synthetic case bases of increasing size are generated from the statistics of a game log
+ *  (levels, lives, enemy counts and locations from "state" packets, touch solutions from the
+ *  logged case blocks), then every operation is timed query by query.
+ *
+ *      ./CBRBenchmark [-l log_file.txt] [-n 100,1000,...] [-s seconds] [-r seed] [-o results.json]
+ *
+ *  A JSON line per (operation, strategy, case-base size) is written to the output file
+ *  (stdout by default), and a readable table to stderr.
+ * Last modified: 2026. 10. 18.
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+
+#include "CBRLfD_Simple.h"
+#include "LogIngest.h"
+
+using std::string;
+using std::vector;
+using std::ifstream;
+using std::getline;
+
+//----------------------------------------------------------------------
+//  LogStatistics
+//      Problems observed at "state_new_round" packets and logged touch solutions.
+//      Synthetic cases are drawn from them with jitter.
+//----------------------------------------------------------------------
+struct LogStatistics{
+    vector< Problem > problems;
+    vector< std::pair< int, int > > solutions;
+};
+
+static LogStatistics ReadStatistics(const char *filename){
+
+    LogStatistics stats;
+    ifstream infile(filename);
+    string line;
+
+    while(getline(infile, line)){
+
+        vector< string > packet;
+        boost::algorithm::trim(line);
+        boost::algorithm::split( packet, line, boost::is_any_of("\t "), boost::token_compress_on );
+
+        if(packet.size() < 7 || packet[0] != "state" || packet[5] != "state_new_round" || packet[1].size() < 6)
+            continue;
+
+        Problem p;
+        p.level = atoi(packet[1].c_str() + 5);
+        p.round = 5 - atoi(packet[2].c_str());
+        p.enemy = atoi(packet[3].c_str());
+        p.score = atoi(packet[4].c_str());
+
+        if(packet.size() < (unsigned)(7 + 2*p.enemy))
+            continue;
+        for(int i=0; i<2*p.enemy; i++)
+            p.enemyLocation.push_back(atof(packet[7+i].c_str()));
+
+        stats.problems.push_back(p);
+    }
+
+    //Touch solutions from the logged case blocks
+    vector< string > files(1, filename);
+    CBRLfD cbr;
+    LogIngest ingest(1);
+    ingest.Ingest(files, &cbr);
+
+    for(unsigned i=0; i<cbr.casebase.size(); i++)
+        stats.solutions.push_back(std::make_pair(cbr.casebase[i]->mSolution->xTouch, cbr.casebase[i]->mSolution->yTouch));
+
+    return stats;
+}
+
+static float jitter(float range){
+    return range * ((rand() / (float) RAND_MAX) * 2.0f - 1.0f);
+}
+
+static Problem* SynthesizeProblem(const LogStatistics &stats){
+
+    const Problem &t = stats.problems[rand() % stats.problems.size()];
+    Problem *p = new Problem();
+
+    p->level = t.level;
+    p->round = t.round;
+    p->enemy = (t.enemy > 1) ? rand() % t.enemy + 1 : t.enemy;     //some enemies already cleared
+    p->score = (t.score > 0) ? rand() % (2*t.score + 1) : rand() % 1000;
+
+    for(int i=0; i<p->enemy; i++){
+        p->enemyLocation.push_back(t.enemyLocation[2*i] + jitter(30.0f));
+        p->enemyLocation.push_back(t.enemyLocation[2*i+1] + jitter(30.0f));
+    }
+
+    return p;
+}
+
+static Solution* SynthesizeSolution(const LogStatistics &stats){
+
+    const std::pair< int, int > &t = stats.solutions[rand() % stats.solutions.size()];
+    Solution *s = new Solution();
+
+    s->xTouch = t.first + (int) jitter(20.0f);
+    s->yTouch = t.second + (int) jitter(20.0f);
+
+    return s;
+}
+
+static double now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+//----------------------------------------------------------------------
+//  Result of one (operation, strategy, size) run. Latencies in microseconds.
+//----------------------------------------------------------------------
+static void Report(FILE *out, const char *op, const char *strategy, unsigned cases, vector< double > &lat, double total){
+
+    unsigned n = lat.size();
+    if(n == 0){
+        fprintf(stderr, "%-10s %-10s %9u cases       0 ops   (no time left to run; raise -s)\n", op, strategy, cases);
+        return;
+    }
+
+    std::sort(lat.begin(), lat.end());
+
+    double p50 = lat[n*50/100];
+    double p90 = lat[n*90/100];
+    double p99 = lat[(n*99/100 < n) ? n*99/100 : n-1];
+    double mean = 0.0;
+    for(unsigned i=0; i<n; i++)
+        mean += lat[i];
+    mean /= n;
+
+    fprintf(out, "{\"op\":\"%s\",\"strategy\":\"%s\",\"cases\":%u,\"queries\":%u,\"mean_us\":%.3f,\"p50_us\":%.3f,\"p90_us\":%.3f,\"p99_us\":%.3f,\"max_us\":%.3f,\"ops_per_s\":%.1f}\n",
+            op, strategy, cases, n, mean, p50, p90, p99, lat[n-1], n / total);
+    fflush(out);
+
+    fprintf(stderr, "%-10s %-10s %9u cases %7u ops   p50 %10.2f us   p90 %10.2f us   p99 %10.2f us   %10.1f ops/s\n",
+            op, strategy, cases, n, p50, p90, p99, n / total);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *logfile = "log_file.txt";
+    const char *outfile = NULL;
+    string sizeList = "100,1000,10000,100000,1000000";
+    double seconds = 1.0;
+    unsigned seed = 1;
+    int opt;
+
+    while((opt = getopt(argc, argv, "l:n:s:r:o:")) != -1){
+        switch(opt){
+            case 'l': logfile = optarg; break;
+            case 'n': sizeList = optarg; break;
+            case 's': seconds = atof(optarg); break;
+            case 'r': seed = atoi(optarg); break;
+            case 'o': outfile = optarg; break;
+            default:
+                printf("usage: %s [-l log_file.txt] [-n 100,1000,...] [-s seconds] [-r seed] [-o results.json]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    FILE *out = outfile ? fopen(outfile, "w") : stdout;
+    if(!out){
+        printf("Cannot open %s\n", outfile);
+        return 1;
+    }
+
+    vector< string > sizes;
+    boost::algorithm::split( sizes, sizeList, boost::is_any_of(",") );
+
+    LogStatistics stats = ReadStatistics(logfile);
+    fprintf(stderr, "%u problem templates, %u solution templates from %s\n", (unsigned) stats.problems.size(), (unsigned) stats.solutions.size(), logfile);
+
+    //Synthetic cases are drawn from the templates: a log without them leaves nothing to draw from
+    if(stats.problems.empty() || stats.solutions.empty()){
+        fprintf(stderr, "%s has no state_new_round packets or no logged touch cases to synthesize case bases from\n", logfile);
+        if(outfile)
+            fclose(out);
+        return 1;
+    }
+
+    srand(seed);
+
+    for(unsigned n=0; n<sizes.size(); n++){
+
+        unsigned size = atoi(sizes[n].c_str());
+        CBRLfD cbr;
+
+        //Build the case base through the bulk path
+        caseVector cases;
+        cases.reserve(size);
+        for(unsigned i=0; i<size; i++)
+            cases.push_back(new Case(SynthesizeProblem(stats), SynthesizeSolution(stats), cbr.nIDGenerator++, cbr.nRobotID, cbr.nEpoch));
+        cbr.BulkLoad(cases);
+
+        //Queries, prepared ahead of timing
+        vector< Problem* > queries;
+        for(unsigned i=0; i<1024; i++)
+            queries.push_back(SynthesizeProblem(stats));
+
+        //Retrieve: full sort, and partial sort of the nearest cases used by Reuse()
+        for(int strategy=0; strategy<2; strategy++){
+
+            vector< double > lat;
+            double start = now();
+
+            while(lat.size() < 3 || (now() - start < seconds && lat.size() < 100000)){
+                Problem *q = queries[lat.size() % queries.size()];
+                double t0 = now();
+                caseVector result = (strategy == 0) ? cbr.Retrieve(q) : cbr.RetrieveNearest(q, 4);
+                lat.push_back((now() - t0) * 1e6);
+            }
+
+            Report(out, "retrieve", strategy == 0 ? "sort" : "nearest4", size, lat, now() - start);
+        }
+
+        //Reuse of the nearest cases
+        {
+            caseVector result = cbr.RetrieveNearest(queries[0], 4);
+            vector< double > lat;
+            double start = now();
+
+            while(lat.size() < 100000 && now() - start < seconds){
+                double t0 = now();
+                Solution *s = cbr.Reuse(result);
+                lat.push_back((now() - t0) * 1e6);
+                delete s;
+            }
+
+            Report(out, "reuse", "gaussian4", size, lat, now() - start);
+        }
+
+        //Retain: may grow the case base slightly
+        {
+            vector< double > lat;
+            double start = now();
+            caseVector rejected;
+
+            while(lat.size() < 3 || (now() - start < seconds && lat.size() < 100000)){
+                Case *c = new Case(SynthesizeProblem(stats), SynthesizeSolution(stats), cbr.nIDGenerator++, cbr.nRobotID, cbr.nEpoch);
+                unsigned before = cbr.casebase.size();
+                double t0 = now();
+                cbr.Retain(c);
+                lat.push_back((now() - t0) * 1e6);
+                if(cbr.casebase.size() == before)
+                    rejected.push_back(c);
+            }
+
+            Report(out, "retain", "sort", size, lat, now() - start);
+
+            for(unsigned i=0; i<rejected.size(); i++){
+                delete rejected[i]->mProblem;
+                delete rejected[i]->mSolution;
+                delete rejected[i];
+            }
+        }
+
+        for(unsigned i=0; i<queries.size(); i++)
+            delete queries[i];
+    }
+
+    if(outfile)
+        fclose(out);
+
+    return 0;
+}
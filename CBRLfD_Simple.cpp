@@ -7,6 +7,8 @@
  * Last modified: 2013. 7. 15.
  */
 
+#include <time.h>
+
 #include "CBRLfD_Simple.h"
 
 using  std::cout;
@@ -20,7 +22,13 @@ using  std::stringstream;
 using  std::ifstream;
 using  boost::lexical_cast;
 
-CBRLfD::CBRLfD(){
+CBRLfD::CBRLfD(int robotID){
+    
+    nRobotID = robotID;
+    nEpoch = (unsigned) time(NULL);
+    nIDGenerator = 1;
+    mListener = NULL;
+    mTrace = NULL;
     
     LoadXML(CBRLfD_CONFIG_FILE);
     
@@ -31,6 +39,9 @@ CBRLfD::~CBRLfD(){
     for(unsigned i=0; i < casebase.size(); i++)
         delete casebase[i];
     
+    if(mTrace)
+        delete mTrace;
+    
 }
 
 //----------------------------------------------------------------------
@@ -40,17 +51,19 @@ CBRLfD::~CBRLfD(){
 //  void BuildCase(int level, int round, int enemy, vector< float > location, int score, int xTouch, int yTouch);
 //----------------------------------------------------------------------
 void CBRLfD::BuildCase(Case *newCase){
-    casebase.push_back(newCase);
+    AddCase(newCase);
     nIDGenerator++;
+    
+    if(mListener)
+        mListener->OnRetain(newCase);
 }
 
 
 Case* CBRLfD::BuildCase(Problem *p, Solution *s){
     
-    Case *newCase = new Case(p, s, nIDGenerator);
+    Case *newCase = new Case(p, s, nIDGenerator, nRobotID, nEpoch);
     
-    casebase.push_back(newCase);
-    nIDGenerator++;
+    BuildCase(newCase);
 	
 	return newCase;
 }
@@ -80,6 +93,10 @@ void CBRLfD::BuildCase(int level, int round, int enemy, vector< float > location
 //----------------------------------------------------------------------
 caseVector CBRLfD::Retrieve(Problem *p){
     
+    struct timespec start;
+    if(mTrace)
+        clock_gettime(CLOCK_MONOTONIC, &start);
+    
     caseVector result = casebase;
     
     // Compute distance between p and problems of cases in casebase
@@ -89,31 +106,82 @@ caseVector CBRLfD::Retrieve(Problem *p){
     // Sort cases with their distance to p
     sort(result.begin(), result.end(), less_than_distance());
     
-    // Print to log
-#ifdef DEBUG
-    stringstream sstm;
-    sstm << "Given Problem: level(" << p->level << ") round(" << p->round << ") enemy(" << p->enemy << ") enemy locations (";
+    // Record the nearest cases and their per-feature distances. Dumped on demand through GetTrace().
+    if(mTrace)
+        RecordTrace(p, result, result.size(), start);
     
-    for (int i=0; i< p->enemy; i++)
-    	sstm << "(" << p->enemyLocation[2*i] << "," << p->enemyLocation[2*i+1] << ") ";
+    return result;
+}
+
+// Same as Retrieve(), but only the nearest k cases are ordered and returned.
+// Reuse() never looks past the nearest 4 cases, so a partial sort is sufficient for it.
+// Setting *cancel (from any thread) stops the scan within RETRIEVE_CANCEL_STRIDE cases; nothing is returned then.
+caseVector CBRLfD::RetrieveNearest(Problem *p, unsigned k, const volatile bool *cancel){
     
-    sstm << ") score(" << p->score << ")\n" << endl;
+    struct timespec start;
+    if(mTrace)
+        clock_gettime(CLOCK_MONOTONIC, &start);
+    
+    caseVector result = casebase;
     
     for(unsigned i=0; i<result.size(); i++){
-        cout << "Case: " << i << " Sorted Distance to Problem: " << result[i]->distance << " Solution x: " << result[i]->mSolution->xTouch << " y: " << result[i]->mSolution->yTouch << endl;
-        sstm << "Case: " << i << " Distance to Problem: " << result[i]->distance << endl;
-        sstm << "Problem: level(" << result[i]->mProblem->level << ") round(" << result[i]->mProblem->round << ") enemy(" << result[i]->mProblem->enemy << ") enemy locations (";
-        
-        for (int j=0; j< result[i]->mProblem->enemy; j++)
-            sstm <<"(" << result[i]->mProblem->enemyLocation[2*j] << "," << result[i]->mProblem->enemyLocation[2*j+1] << ") ";
-        
-        sstm << ") score(" << result[i]->mProblem->score << ")" << endl;
-        sstm << "  Solution: x(" << result[i]->mSolution->xTouch << ") y(" <<result[i]->mSolution->yTouch << ")" << endl;
-        
+        if(cancel && (i % RETRIEVE_CANCEL_STRIDE) == 0 && *cancel)
+            return caseVector();
+        result[i]->distance = Distance(result[i]->mProblem, p);
+    }
+    
+    if(k > result.size())
+        k = result.size();
+    
+    std::partial_sort(result.begin(), result.begin() + k, result.end(), less_than_distance());
+    
+    result.resize(k);
+    
+    if(mTrace)
+        RecordTrace(p, result, casebase.size(), start);
+    
+    return result;
+}
+
+// Distance order of (distance, case) pairs. Ties resolve by case key, so that equal distances
+// rank the same way in every run and on every robot, wherever the cases sit in memory.
+struct less_than_ranked
+{
+    inline bool operator() (const std::pair< float, Case* > &r1, const std::pair< float, Case* > &r2)
+    {
+        if(r1.first != r2.first)
+            return r1.first < r2.first;
+        return CaseKey(r1.second) < CaseKey(r2.second);
+    }
+};
+
+// Same as RetrieveNearest(), but the distances are kept aside in distances (in result order)
+// instead of in the shared cases, and no trace is recorded. Several threads may retrieve
+// concurrently, as long as none of them modifies the case base meanwhile. *cancel as above.
+caseVector CBRLfD::RetrieveNearest(Problem *p, unsigned k, vector< float > &distances, const volatile bool *cancel){
+    
+    vector< std::pair< float, Case* > > ranked(casebase.size());
+    
+    for(unsigned i=0; i<casebase.size(); i++){
+        if(cancel && (i % RETRIEVE_CANCEL_STRIDE) == 0 && *cancel){
+            distances.clear();
+            return caseVector();
+        }
+        ranked[i] = std::make_pair(Distance(casebase[i]->mProblem, p), casebase[i]);
     }
     
-    LOG::write_log(sstm.str());
-#endif
+    if(k > ranked.size())
+        k = ranked.size();
+    
+    std::partial_sort(ranked.begin(), ranked.begin() + k, ranked.end(), less_than_ranked());
+    
+    caseVector result(k);
+    distances.resize(k);
+    
+    for(unsigned i=0; i<k; i++){
+        distances[i] = ranked[i].first;
+        result[i] = ranked[i].second;
+    }
     
     return result;
 }
@@ -149,7 +217,7 @@ Solution* CBRLfD::Reuse(caseVector result){
 Case* CBRLfD::Revise(Problem *p, Solution *s){
     
     // Difference from BuildCase(): newly created case is not stored in case base.
-    Case *newCase = new Case(p, s, nIDGenerator);
+    Case *newCase = new Case(p, s, nIDGenerator, nRobotID, nEpoch);
     nIDGenerator++;
 	
 	return newCase;
@@ -168,11 +236,164 @@ void CBRLfD::Retain(Case *c){
         sort(result.begin(), result.end(), less_than_distance());
         
         if( result[0]->distance > RETAIN_T1 )
-            if( result[0]->distance < RETAIN_T2 )
-                casebase.push_back(c);
+            if( result[0]->distance < RETAIN_T2 ){
+                AddCase(c);
+                if(mListener)
+                    mListener->OnRetain(c);
+            }
     }
 }
 
+//----------------------------------------------------------------------
+// Case-base sharing between robots
+//      Merge: Stores a case created by another robot unless its (robotID, epoch, ID) key is already known.
+//      Find: Looks up a case by its (robotID, epoch, ID) key.
+//      BulkLoad: Stores many cases at once. The case index is rebuilt once at the end instead of per case.
+//          Cases whose key is already known are not stored; they are left in cases for the caller to free.
+//      SetListener: Registers a listener notified about newly stored local cases.
+//----------------------------------------------------------------------
+bool CBRLfD::Merge(Case *c){
+    
+    if(caseIndex.find(CaseKey(c)) != caseIndex.end())
+        return false;
+    
+    AddCase(c);
+    
+    return true;
+}
+
+Case* CBRLfD::Find(const CaseKey &key){
+    
+    std::map< CaseKey, Case* >::iterator it = caseIndex.find(key);
+    
+    return (it == caseIndex.end()) ? NULL : it->second;
+}
+
+int CBRLfD::BulkLoad(caseVector &cases){
+    
+    // Sort the new keys once (ties keep input order), and drop keys already known or repeated within cases.
+    vector< std::pair< CaseKey, unsigned > > keys;
+    vector< char > keep(cases.size(), 0);
+    
+    keys.reserve(cases.size());
+    for(unsigned i=0; i<cases.size(); i++)
+        keys.push_back(std::make_pair(CaseKey(cases[i]), i));
+    
+    sort(keys.begin(), keys.end());
+    
+    for(unsigned i=0; i<keys.size(); i++)
+        if(!(i > 0 && keys[i].first == keys[i-1].first) && !caseIndex.count(keys[i].first))
+            keep[keys[i].second] = 1;
+    
+    // Store in input order, so retrieval ties resolve as with per-case insertion.
+    caseVector rejected;
+    int stored = 0;
+    
+    casebase.reserve(casebase.size() + cases.size());
+    for(unsigned i=0; i<cases.size(); i++){
+        if(keep[i]){
+            casebase.push_back(cases[i]);
+            stored++;
+        }
+        else
+            rejected.push_back(cases[i]);
+    }
+    
+    // Rebuild the index in one merge pass. Keys arrive in order, so every insertion is amortized constant time.
+    std::map< CaseKey, Case* > index;
+    std::map< CaseKey, Case* >::iterator it = caseIndex.begin();
+    unsigned j = 0;
+    
+    while(it != caseIndex.end() || j < keys.size()){
+        if(j < keys.size() && (it == caseIndex.end() || keys[j].first < it->first)){
+            if(keep[keys[j].second])
+                index.insert(index.end(), std::make_pair(keys[j].first, cases[keys[j].second]));
+            j++;
+        }
+        else{
+            index.insert(index.end(), *it);
+            ++it;
+        }
+    }
+    caseIndex.swap(index);
+    
+    if(mListener)
+        for(unsigned i=0; i<cases.size(); i++)
+            if(keep[i])
+                mListener->OnRetain(cases[i]);
+    
+    cases.swap(rejected);
+    
+    return stored;
+}
+
+void CBRLfD::SetListener(CaseListener *listener){
+    mListener = listener;
+}
+
+//----------------------------------------------------------------------
+// Retrieval tracing
+//      EnableTrace: Allocates a ring buffer of capacity records. Features are named after <Value> in xml.
+//      DisableTrace: Releases the ring buffer.
+//      RecordTrace: Fills the next record from a sorted retrieval result of scanned cases.
+//----------------------------------------------------------------------
+void CBRLfD::EnableTrace(unsigned capacity){
+    
+    vector< string > names;
+    
+    for(unsigned i=0; i<npValue.size(); i++)
+        names.push_back(boost::algorithm::trim_copy(npValue[i]));
+    
+    if(mTrace)
+        delete mTrace;
+    mTrace = new RetrievalTrace(capacity, names);
+}
+
+void CBRLfD::DisableTrace(){
+    
+    if(mTrace)
+        delete mTrace;
+    mTrace = NULL;
+}
+
+void CBRLfD::RecordTrace(Problem *p, const caseVector &result, unsigned scanned, const struct timespec &start){
+    
+    TraceRecord *r = mTrace->Next();
+    
+    r->level = p->level;
+    r->round = p->round;
+    r->enemy = p->enemy;
+    r->score = p->score;
+    for(unsigned i=0; i < p->enemyLocation.size() && i < 2*TRACE_MAX_ENEMY; i++)
+        r->enemyLocation[i] = p->enemyLocation[i];
+    
+    r->scanned = scanned;
+    r->k = (result.size() < TRACE_TOP_K) ? result.size() : TRACE_TOP_K;
+    
+    for(int i=0; i < r->k; i++){
+        TraceEntry &e = r->top[i];
+        e.robotID = result[i]->robotID;
+        e.ID = result[i]->ID;
+        e.distance = result[i]->distance;
+        e.xTouch = result[i]->mSolution->xTouch;
+        e.yTouch = result[i]->mSolution->yTouch;
+        DistanceTerms(result[i]->mProblem, p, e.contribution);
+        for(int f=CBR_FEATURES; f < TRACE_MAX_FEATURES; f++)
+            e.contribution[f] = 0.0f;
+    }
+    
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    r->elapsedNs = (long long) (end.tv_sec - start.tv_sec) * 1000000000LL + (end.tv_nsec - start.tv_nsec);
+    
+    mTrace->Commit();
+}
+
+void CBRLfD::AddCase(Case *c){
+    casebase.push_back(c);
+    caseIndex[CaseKey(c)] = c;
+}
+
 // Parse XML
 int CBRLfD::LoadXML(const char* filename){
     
@@ -450,26 +671,36 @@ int CBRLfD::AssignDistMetric(){
     return 1;
 }
 
-// Nearest-neighbor distance function used for case retrieval.
+// Nearest-neighbor distance function used for case retrieval: the sum of the weighted per-feature terms.
 float CBRLfD::Distance(Problem *p1, Problem *p2){
     
+    float terms[CBR_FEATURES];
     float total = 0.0f;
     
+    DistanceTerms(p1, p2, terms);
+    for(int i=0; i < CBR_FEATURES; i++)
+        total += terms[i];
+    
+    return total;
+    
+}
+
+// Weighted per-feature terms of Distance(), in feature order; the metric is defined here only.
+// terms must hold CBR_FEATURES values.
+void CBRLfD::DistanceTerms(Problem *p1, Problem *p2, float *terms){
+    
     int i = 0;
-    total += npWeight[i]*(*npDistFunc_i[i].pFunc)(p1->level, p2->level, npDistFunc_i[i].var1, npDistFunc_i[i].var2);
+    terms[i] = npWeight[i]*(*npDistFunc_i[i].pFunc)(p1->level, p2->level, npDistFunc_i[i].var1, npDistFunc_i[i].var2);
     
     i++;
-    total += npWeight[i]*(*npDistFunc_i[i].pFunc)(p1->round, p2->round, npDistFunc_i[i].var1, npDistFunc_i[i].var2);
+    terms[i] = npWeight[i]*(*npDistFunc_i[i].pFunc)(p1->round, p2->round, npDistFunc_i[i].var1, npDistFunc_i[i].var2);
     
     i++;
-    total += npWeight[i]*(*npDistFunc_i[i].pFunc)(p1->enemy, p2->enemy, npDistFunc_i[i].var1, npDistFunc_i[i].var2);
+    terms[i] = npWeight[i]*(*npDistFunc_i[i].pFunc)(p1->enemy, p2->enemy, npDistFunc_i[i].var1, npDistFunc_i[i].var2);
     
     i++;
-    total += npWeight[i]*(*npDistFunc_fv[i].pFunc)(p1->enemyLocation, p2->enemyLocation, npDistFunc_fv[i].var1, npDistFunc_fv[i].var2);
+    terms[i] = npWeight[i]*(*npDistFunc_fv[i].pFunc)(p1->enemyLocation, p2->enemyLocation, npDistFunc_fv[i].var1, npDistFunc_fv[i].var2);
     
     i++;
-    total += npWeight[i]*(*npDistFunc_i[i].pFunc)(p1->score, p2->score, npDistFunc_i[i].var1, npDistFunc_i[i].var2);
-    
-    return total;
-    
+    terms[i] = npWeight[i]*(*npDistFunc_i[i].pFunc)(p1->score, p2->score, npDistFunc_i[i].var1, npDistFunc_i[i].var2);
 }
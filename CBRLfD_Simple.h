@@ -29,10 +29,12 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 #include <vector>
 #include <cstdlib>
 #include <iostream>
 #include <algorithm> 
+#include <map>
 #include <fstream>
 #include <sstream>
 #include <boost/algorithm/string.hpp>
@@ -40,12 +42,17 @@
 
 #include "tinyxml.h"
 #include "Log.h"
+#include "RetrievalTrace.h"
 
 #define CBRLfD_CONFIG_FILE  "./CBRLfD_Simple.xml"
 
+#define CBR_FEATURES  5         // problem features compared by Distance(): level, round, enemy, enemy locations, score
+
 #define RETAIN_T1  0.2          // low similarity score for retaining
 #define RETAIN_T2  0.8          // high similarity score for retaining
 
+#define RETRIEVE_CANCEL_STRIDE  64     // cases compared between checks of a cancellation flag
+
 using std::string;
 using std::vector;
 
@@ -100,7 +107,9 @@ struct Solution{
 //----------------------------------------------------------------------
 struct Case{
     
-    int ID;
+    int ID;                 //sequence number assigned by the robot that created the case
+    int robotID;            //robot that created the case.
+    unsigned epoch;         //incarnation of the robot process that created the case. (robotID, epoch, ID) is unique across robots.
     
     vector< string > vProblem;
     vector< string > vSolution;
@@ -113,18 +122,27 @@ struct Case{
     Case(void){
         mProblem = NULL;
         mSolution = NULL;
+        ID = 0;
+        robotID = 0;
+        epoch = 0;
     }
     
-    Case(vector< string > problem, vector< string > solution, int idNum){
+    Case(vector< string > problem, vector< string > solution, int idNum, int robot = 0, unsigned inc = 0){
         vProblem = problem;
         vSolution = solution;
+        mProblem = NULL;
+        mSolution = NULL;
         ID = idNum;
+        robotID = robot;
+        epoch = inc;
     }
     
-    Case(Problem *problem, Solution *solution, int idNum){
+    Case(Problem *problem, Solution *solution, int idNum, int robot = 0, unsigned inc = 0){
         mProblem = problem;
         mSolution = solution;
         ID = idNum;
+        robotID = robot;
+        epoch = inc;
     }
     
 };
@@ -145,6 +163,42 @@ struct less_than_distance
 
 typedef vector< Case* > caseVector;
 
+//----------------------------------------------------------------------
+//  CaseKey
+//      Case identity shared between robots: (robotID, epoch, ID).
+//      Used to merge cases received from other robots idempotently.
+//      A restarted robot numbers its cases from 1 again under a new epoch.
+//----------------------------------------------------------------------
+struct CaseKey{
+    
+    int robotID;
+    unsigned epoch;
+    int ID;
+    
+    CaseKey(int robot, unsigned inc, int idNum) : robotID(robot), epoch(inc), ID(idNum) {}
+    explicit CaseKey(const Case *c) : robotID(c->robotID), epoch(c->epoch), ID(c->ID) {}
+    
+    bool operator<(const CaseKey &k) const {
+        if(robotID != k.robotID) return robotID < k.robotID;
+        if(epoch != k.epoch) return epoch < k.epoch;
+        return ID < k.ID;
+    }
+    bool operator==(const CaseKey &k) const {
+        return robotID == k.robotID && epoch == k.epoch && ID == k.ID;
+    }
+};
+
+//----------------------------------------------------------------------
+//  CaseListener
+//      Notified whenever a locally created case enters the case base
+//      (BuildCase() or Retain()). Cases merged from other robots are not reported.
+//----------------------------------------------------------------------
+class CaseListener{
+public:
+    virtual ~CaseListener() {}
+    virtual void OnRetain(Case *c) = 0;
+};
+
 //----------------------------------------------------------------------
 //  distFunction
 //      distFunction consists of a pointer to a distance-metric method,
@@ -265,11 +319,13 @@ float distMinVectorAvg (vector<T> a, vector<T> b, vector<T> *var1, vector<T> *va
 class CBRLfD{
     
 public:
-    CBRLfD();
+    CBRLfD(int robotID = 0);
     ~CBRLfD();
     
 	caseVector	casebase;       //case base for storing cases
-    static int nIDGenerator;    //keeps tract of the case id sequence.
+    int nRobotID;               //ID of the robot owning this case base. Stamped on every local case.
+    unsigned nEpoch;            //incarnation of this process (start time in seconds). Stamped on every local case.
+    int nIDGenerator;           //keeps tract of the case id sequence of this robot.
     
     // BuildCase() creates a case from a problem-solution pair. 
     void BuildCase(Case *newCase);
@@ -278,12 +334,30 @@ public:
     
     // Implementation of CBR-4R steps
     caseVector Retrieve(Problem *p);            //Cases in the case base is sorted using Distance()
+    caseVector RetrieveNearest(Problem *p, unsigned k, const volatile bool *cancel = NULL);   //Only the nearest k cases are sorted and returned.
+    caseVector RetrieveNearest(Problem *p, unsigned k, vector< float > &distances, const volatile bool *cancel = NULL);   //Same, without writing Case::distance: safe for concurrent readers.
     Solution* Reuse(caseVector result);         //Builds a new solution from retrieved cases using gaussian weighting.
     Case* Revise(Problem *p, Solution *s);      //Builds a new case from newly created problem-solution pair.
     void Retain(Case *c);                        //Analyzes the new case and decides whether to retain the new case in case base.
 
+    // Case-base sharing between robots
+    bool Merge(Case *c);                        //Adds a case created by another robot. Returns false if the case is already known.
+    Case* Find(const CaseKey &key);             //Looks up a case by its (robotID, epoch, ID) key. Returns NULL if not found.
+    int BulkLoad(caseVector &cases);            //Stores many cases at once and indexes them once at the end. Returns the number stored.
+    void SetListener(CaseListener *listener);   //Registers a listener notified about newly stored local cases.
+    
+    // Retrieval tracing. While disabled, Retrieve() pays a single branch.
+    void EnableTrace(unsigned capacity = TRACE_CAPACITY);   //Allocates a ring buffer of capacity trace records.
+    void DisableTrace();
+    RetrievalTrace* GetTrace() { return mTrace; }           //NULL while disabled.
     
 private:
+    
+    std::map< CaseKey, Case* > caseIndex;       //(robotID, epoch, ID) index over casebase
+    CaseListener *mListener;
+    RetrievalTrace *mTrace;
+    
+    void AddCase(Case *c);                      //Stores c in casebase and caseIndex.
             
     // Raw incoming variables from xml. The size of each vector is the number of case features.
     vector < string > npValue;                  //<Value>: name of the feature
@@ -302,6 +376,8 @@ private:
     int LoadXML(const char* filename);              // Parse XML
     int AssignDistMetric();                         // Assign pointer to distance metric for each feature.
     float Distance(Problem *p1, Problem *p2);       // Nearest-neighbor distance function used for case retrieval.
+    void DistanceTerms(Problem *p1, Problem *p2, float *terms);    // Weighted per-feature terms of Distance(). terms holds CBR_FEATURES values.
+    void RecordTrace(Problem *p, const caseVector &result, unsigned scanned, const struct timespec &start);
 };
 
 #endif
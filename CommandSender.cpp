@@ -0,0 +1,282 @@
+/*
+ * CommandSender.cpp
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Implementation of the asynchronous command sender to the tablet.
+ * Last modified: 2026. 10. 18.
+ */
+
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <iostream>
+
+#include "EventLoop.h"
+#include "CommandSender.h"
+
+using std::cout;
+using std::endl;
+
+CommandSender::CommandSender(){
+
+    pthread_mutex_init(&mutex, NULL);
+
+    queueHead = 0;
+    queueSize = 0;
+    bInFlight = false;
+    inFlightCmd = 0;
+    inFlightSeq = 0;
+    frameSize = 0;
+    retries = 0;
+    firstSentUs = 0;
+    deadlineMs = 0;
+    bAcks = false;
+
+    mProtocol = NULL;
+    mCapture = NULL;
+    mLatency = NULL;
+    sockfd = -1;
+    notifyfd = EventLoop::CreateNotifier();
+    bRunning = false;
+
+    nCommands = 0;
+    nCoalesced = 0;
+    nSent = 0;
+    nRetransmits = 0;
+    nAcked = 0;
+    nLost = 0;
+    nDropped = 0;
+    rttSumUs = 0;
+    rttMaxUs = 0;
+}
+
+CommandSender::~CommandSender(){
+
+    Stop();
+
+    if(notifyfd >= 0)
+        close(notifyfd);
+
+    pthread_mutex_destroy(&mutex);
+}
+
+bool CommandSender::Start(int fd, const struct sockaddr_in &to, TabletProtocol *protocol){
+
+    if(bRunning || notifyfd < 0)
+        return false;
+
+    sockfd = fd;
+    addr = to;
+    mProtocol = protocol;
+
+    bRunning = true;
+    if(pthread_create(&thread_t, NULL, Sender_thread, this) != 0){
+        cout << "Cannot start command sender" << endl;
+        bRunning = false;
+        return false;
+    }
+
+    return true;
+}
+
+void CommandSender::Stop(){
+
+    if(!bRunning)
+        return;
+
+    bRunning = false;
+    EventLoop::Notify(notifyfd);
+    pthread_join(thread_t, NULL);
+}
+
+void CommandSender::SetAddress(const struct sockaddr_in &to){
+
+    pthread_mutex_lock(&mutex);
+    addr = to;
+    pthread_mutex_unlock(&mutex);
+}
+
+bool CommandSender::Enqueue(int cmd, int x, int y){
+
+    pthread_mutex_lock(&mutex);
+
+    Command *back = queueSize ? &queue[(queueHead + queueSize - 1) % CMD_QUEUE_SIZE] : NULL;
+
+    //Only the latest of consecutive commands of a kind matters
+    if(back && back->cmd == cmd){
+        nCoalesced++;
+    }
+    else if(queueSize < CMD_QUEUE_SIZE){
+        back = &queue[(queueHead + queueSize) % CMD_QUEUE_SIZE];
+        back->cmd = cmd;
+        queueSize++;
+    }
+    else{
+        pthread_mutex_unlock(&mutex);
+        cout << "Command queue is full" << endl;
+        return false;
+    }
+
+    back->x = x;
+    back->y = y;
+    nCommands++;
+
+    pthread_mutex_unlock(&mutex);
+
+    EventLoop::Notify(notifyfd);
+
+    return true;
+}
+
+void CommandSender::Drop(int cmd){
+
+    pthread_mutex_lock(&mutex);
+
+    unsigned kept = 0;
+    for(unsigned i=0; i<queueSize; i++){
+        Command &c = queue[(queueHead + i) % CMD_QUEUE_SIZE];
+        if(c.cmd == cmd)
+            nDropped++;
+        else
+            queue[(queueHead + kept++) % CMD_QUEUE_SIZE] = c;
+    }
+    queueSize = kept;
+
+    if(bInFlight && inFlightCmd == cmd){
+        bInFlight = false;
+        nDropped++;
+    }
+
+    pthread_mutex_unlock(&mutex);
+
+    EventLoop::Notify(notifyfd);
+}
+
+void CommandSender::OnAck(unsigned seq){
+
+    pthread_mutex_lock(&mutex);
+
+    bAcks = true;
+
+    if(bInFlight && seq == inFlightSeq){
+
+        long long rtt = EventLoop::NowUs() - firstSentUs;
+        rttSumUs += rtt;
+        if(rtt > rttMaxUs)
+            rttMaxUs = rtt;
+
+        nAcked++;
+        bInFlight = false;
+    }
+
+    pthread_mutex_unlock(&mutex);
+
+    EventLoop::Notify(notifyfd);
+}
+
+void CommandSender::PrintStats(){
+
+    if(nCommands == 0)
+        return;
+
+    pthread_mutex_lock(&mutex);
+
+    cout << "Sent " << nCommands << " commands (" << nCoalesced << " superseded) in " << nSent << " datagrams: " << nRetransmits << " retransmitted, "
+         << nAcked << " acked (rtt avg " << (nAcked ? rttSumUs / (long long) nAcked : 0) << " us max " << rttMaxUs << " us), " << nLost << " lost, " << nDropped << " dropped" << endl;
+
+    pthread_mutex_unlock(&mutex);
+}
+
+//Retransmit or give up the command in flight, then send queued commands until one waits for its ack.
+//Called with the mutex held.
+void CommandSender::SendPending(){
+
+    long long now = EventLoop::NowMs();
+
+    if(bInFlight){
+
+        if(queueSize && queue[queueHead].cmd == inFlightCmd){
+            bInFlight = false;      //superseded
+            nCoalesced++;
+        }
+        else if(now >= deadlineMs){
+
+            if(retries < CMD_MAX_RETRIES){
+                Send();
+                retries++;
+                nRetransmits++;
+                deadlineMs = now + CMD_RETRY_MS;
+            }
+            else{
+                cout << "Command " << inFlightSeq << " was not acknowledged by tablet" << endl;
+                nLost++;
+                bInFlight = false;
+            }
+        }
+    }
+
+    while(!bInFlight && queueSize){
+
+        Command c = queue[queueHead];
+        queueHead = (queueHead + 1) % CMD_QUEUE_SIZE;
+        queueSize--;
+
+        unsigned seq = 0;
+        frameSize = mProtocol->EncodeCommand(c.cmd, c.x, c.y, frame, &seq);
+        Send();
+
+        if(mLatency && c.cmd == CMD_TOUCH)
+            mLatency->Finish(STAGE_SEND);
+
+        if(bAcks && c.cmd != CMD_MOVE && TabletProtocol::IsFrame(frame, frameSize)){
+            bInFlight = true;
+            inFlightCmd = c.cmd;
+            inFlightSeq = seq;
+            retries = 0;
+            firstSentUs = EventLoop::NowUs();
+            deadlineMs = now + CMD_RETRY_MS;
+        }
+    }
+}
+
+//Send the encoded frame. Called with the mutex held.
+void CommandSender::Send(){
+
+    sendto(sockfd, frame, frameSize, 0, (struct sockaddr *)&addr, sizeof(addr));
+    nSent++;
+
+    PacketCapture *capture = mCapture;
+    if(capture)
+        capture->Record(CAPTURE_OUTBOUND, EventLoop::NowUs(), frame, frameSize);
+}
+
+void* CommandSender::Sender_thread(void *ptr){
+
+    CommandSender *pSend = (CommandSender*) ptr;
+
+    struct pollfd pfd;
+    pfd.fd = pSend->notifyfd;
+    pfd.events = POLLIN;
+
+    while(pSend->bRunning){
+
+        //Sleep until a command or an ack arrives, or the command in flight is due
+        int timeout = -1;
+
+        pthread_mutex_lock(&pSend->mutex);
+        if(pSend->bInFlight){
+            long long left = pSend->deadlineMs - EventLoop::NowMs();
+            timeout = left > 0 ? (int) left : 0;
+        }
+        pthread_mutex_unlock(&pSend->mutex);
+
+        if(poll(&pfd, 1, timeout) > 0)
+            EventLoop::Drain(pSend->notifyfd);
+
+        pthread_mutex_lock(&pSend->mutex);
+        pSend->SendPending();
+        pthread_mutex_unlock(&pSend->mutex);
+    }
+
+    return NULL;
+}
@@ -0,0 +1,118 @@
+/*
+ * CommandSender.h
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Declarations of the asynchronous command sender to the tablet.
+ * Last modified: 2026. 10. 18.
+ */
+
+/*
+ * The state machine enqueues touch, release and fulltouch commands and moves on. A sender thread
+ * encodes them in the negotiated protocol and sends them in order.
+ *
+ *  - A queued command is replaced by a newer command of the same kind (a touch moved before it
+ *    was sent, a repeated fulltouch, a drag overtaken by the next move); a touch followed by a
+ *    release is never merged.
+ *  - Binary commands carry a sequence number. Once the tablet has acknowledged a command
+ *    (FRAME_ACK), each command waits for its ack before the next one is sent, and is retransmitted
+ *    every CMD_RETRY_MS, with the same sequence number, up to CMD_MAX_RETRIES times.
+ *  - A command in flight is given up when a newer command of the same kind is queued.
+ *  - Drop() takes back the queued and in-flight commands of a kind, e.g. the touch of an aim the
+ *    user took over.
+ *  - Moves are never retransmitted: the next move or the release supersedes a lost one.
+ *  - Text commands and tablets that never acknowledge are sent once, as before.
+ *  - Commands are kept in a fixed ring of CMD_QUEUE_SIZE; enqueueing does not allocate.
+ */
+
+#ifndef _COMMANDSENDER_MODULE_H_
+#define _COMMANDSENDER_MODULE_H_
+
+#include <pthread.h>
+#include <netinet/in.h>
+
+#include "TabletProtocol.h"
+#include "PacketCapture.h"
+#include "DecisionLatency.h"
+
+#define CMD_RETRY_MS        40      // retransmission timeout
+#define CMD_MAX_RETRIES     5       // retransmissions before a command is given up
+#define CMD_QUEUE_SIZE      32      // commands waiting to be sent
+
+//----------------------------------------------------------------------
+//  CommandSender
+//----------------------------------------------------------------------
+class CommandSender : public AckListener{
+
+public:
+    CommandSender();
+    ~CommandSender();
+
+    // Send to the tablet at addr through sockfd on a new thread, encoding with protocol.
+    bool Start(int sockfd, const struct sockaddr_in &addr, TabletProtocol *protocol);
+    void Stop();
+
+    // Send to another tablet address from now on.
+    void SetAddress(const struct sockaddr_in &addr);
+    // Record the sent datagrams to capture (NULL stops recording).
+    void SetCapture(PacketCapture *capture){ mCapture = capture; }
+    // Finish the decision in progress of latency when a touch is sent.
+    void SetLatency(DecisionLatency *latency){ mLatency = latency; }
+
+    // Queue a command. Returns immediately; false if the queue is full.
+    bool Enqueue(int cmd, int x, int y);
+
+    // Drop the queued commands of kind cmd and give up one in flight (no retransmission).
+    void Drop(int cmd);
+
+    // Tablet acknowledged the command with seq. Called by the packet receiver thread.
+    virtual void OnAck(unsigned seq);
+
+    void PrintStats();
+
+    //Metrics
+    unsigned long nCommands;            //commands enqueued
+    unsigned long nCoalesced;           //commands replaced before they were acknowledged
+    unsigned long nSent;                //datagrams sent, retransmissions included
+    unsigned long nRetransmits;
+    unsigned long nAcked;
+    unsigned long nLost;                //commands given up after CMD_MAX_RETRIES
+    unsigned long nDropped;             //commands dropped before they were sent or acknowledged
+    long long rttSumUs, rttMaxUs;       //first transmission to ack
+
+private:
+    struct Command{
+        int cmd, x, y;
+    };
+
+    Command queue[CMD_QUEUE_SIZE];      //ring of commands waiting to be sent
+    unsigned queueHead, queueSize;
+    pthread_mutex_t mutex;
+
+    //Command in flight, waiting for its ack
+    bool bInFlight;
+    int inFlightCmd;
+    unsigned inFlightSeq;
+    char frame[TABLET_FRAME_MAX];
+    int frameSize;
+    int retries;
+    long long firstSentUs;
+    long long deadlineMs;
+
+    bool bAcks;                         //the tablet acknowledges commands
+
+    TabletProtocol *mProtocol;
+    PacketCapture * volatile mCapture;
+    DecisionLatency *mLatency;
+    int sockfd;
+    struct sockaddr_in addr;
+    int notifyfd;
+    pthread_t thread_t;
+    volatile bool bRunning;
+
+    static void *Sender_thread(void *ptr);
+
+    void SendPending();
+    void Send();
+};
+
+#endif
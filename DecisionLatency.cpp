@@ -0,0 +1,266 @@
+/*
+ * DecisionLatency.cpp
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Implementation of per-stage latency histograms of decisions.
+ * Last modified: 2026. 10. 18.
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <iostream>
+
+#include "DecisionLatency.h"
+#include "EventLoop.h"
+
+using std::cout;
+using std::endl;
+using std::string;
+
+//----------------------------------------------------------------------
+//  LatencyHistogram
+//----------------------------------------------------------------------
+LatencyHistogram::LatencyHistogram(){
+
+    Reset();
+}
+
+void LatencyHistogram::Reset(){
+
+    memset(buckets, 0, sizeof(buckets));
+    count = 0;
+    sum = 0;
+    max = 0;
+}
+
+//Exact below LATENCY_SUB_BUCKETS, then LATENCY_SUB_BUCKETS buckets per power of two
+int LatencyHistogram::Bucket(long long us){
+
+    if(us < 0)
+        us = 0;
+    if(us >= (1LL << LATENCY_MAX_BITS))
+        us = (1LL << LATENCY_MAX_BITS) - 1;
+
+    if(us < LATENCY_SUB_BUCKETS)
+        return (int) us;
+
+    int e = 63 - __builtin_clzll(us);      //us is in [2^e, 2^(e+1))
+    int shift = e - LATENCY_SUB_BITS;
+
+    return LATENCY_SUB_BUCKETS * (shift + 1) + (int) (us >> shift) - LATENCY_SUB_BUCKETS;
+}
+
+long long LatencyHistogram::BucketLimit(int bucket){
+
+    if(bucket < LATENCY_SUB_BUCKETS)
+        return bucket;
+
+    int shift = bucket / LATENCY_SUB_BUCKETS - 1;
+    long long lower = (long long) (LATENCY_SUB_BUCKETS + bucket % LATENCY_SUB_BUCKETS) << shift;
+
+    return lower + (1LL << shift) - 1;
+}
+
+void LatencyHistogram::Record(long long us){
+
+    if(us < 0)
+        us = 0;
+
+    buckets[Bucket(us)]++;
+    count++;
+    sum += us;
+    if(us > max)
+        max = us;
+}
+
+long long LatencyHistogram::Percentile(double q){
+
+    if(count == 0)
+        return 0;
+
+    unsigned long rank = (unsigned long) (q * count + 0.999999);
+    if(rank < 1)
+        rank = 1;
+
+    unsigned long seen = 0;
+    for(int b=0; b<LATENCY_BUCKETS; b++){
+        seen += buckets[b];
+        if(seen >= rank){
+            long long limit = BucketLimit(b);
+            return limit < max ? limit : max;
+        }
+    }
+
+    return max;
+}
+
+//----------------------------------------------------------------------
+//  DecisionLatency
+//----------------------------------------------------------------------
+DecisionLatency::DecisionLatency(){
+
+    pthread_mutex_init(&mutex, NULL);
+
+    bActive = false;
+    beginUs = lastUs = 0;
+    nDecisions = nAbandoned = 0;
+    listenfd = -1;
+}
+
+DecisionLatency::~DecisionLatency(){
+
+    if(listenfd >= 0){
+        close(listenfd);
+        unlink(path.c_str());
+    }
+
+    pthread_mutex_destroy(&mutex);
+}
+
+void DecisionLatency::Begin(const ReceivedPacket &r){
+
+    pthread_mutex_lock(&mutex);
+
+    if(bActive)
+        nAbandoned++;
+
+    //Without a kernel timestamp the decision starts at recvmmsg()
+    bActive = true;
+    beginUs = lastUs = r.kernelStamp ? r.kernelStamp : r.stamp;
+
+    if(r.kernelStamp)
+        MarkAt(STAGE_RECEIVE, r.stamp);
+    MarkAt(STAGE_PARSE, r.parsedStamp);
+    MarkAt(STAGE_DISPATCH, EventLoop::NowUs());
+
+    pthread_mutex_unlock(&mutex);
+}
+
+void DecisionLatency::Mark(int stage){
+
+    long long now = EventLoop::NowUs();
+
+    pthread_mutex_lock(&mutex);
+    if(bActive)
+        MarkAt(stage, now);
+    pthread_mutex_unlock(&mutex);
+}
+
+void DecisionLatency::Mark(int stage, long long stampUs){
+
+    pthread_mutex_lock(&mutex);
+    if(bActive)
+        MarkAt(stage, stampUs < lastUs ? lastUs : stampUs);
+    pthread_mutex_unlock(&mutex);
+}
+
+void DecisionLatency::Finish(int stage){
+
+    long long now = EventLoop::NowUs();
+
+    pthread_mutex_lock(&mutex);
+    if(bActive){
+        MarkAt(stage, now);
+        hist[STAGE_TOTAL].Record(now - beginUs);
+        nDecisions++;
+        bActive = false;
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+//Record the time since the previous stage. Called with the mutex held.
+void DecisionLatency::MarkAt(int stage, long long now){
+
+    hist[stage].Record(now - lastUs);
+    lastUs = now;
+}
+
+void DecisionLatency::Reset(){
+
+    pthread_mutex_lock(&mutex);
+    for(int i=0; i<STAGE_COUNT; i++)
+        hist[i].Reset();
+    nDecisions = nAbandoned = 0;
+    pthread_mutex_unlock(&mutex);
+}
+
+string DecisionLatency::Format(){
+
+    char line[256];
+    string table;
+
+    pthread_mutex_lock(&mutex);
+
+    snprintf(line, sizeof(line), "Decision latency: %lu decisions, %lu abandoned (usec)\n", nDecisions, nAbandoned);
+    table += line;
+    snprintf(line, sizeof(line), "%-14s %8s %10s %10s %10s %10s %10s\n", "stage", "count", "mean", "p50", "p90", "p99", "max");
+    table += line;
+
+    for(int i=0; i<STAGE_COUNT; i++){
+        LatencyHistogram &h = hist[i];
+        snprintf(line, sizeof(line), "%-14s %8lu %10.0f %10lld %10lld %10lld %10lld\n", StageName(i), h.Count(), h.Mean(),
+                 h.Percentile(0.5), h.Percentile(0.9), h.Percentile(0.99), h.Max());
+        table += line;
+    }
+
+    pthread_mutex_unlock(&mutex);
+
+    return table;
+}
+
+bool DecisionLatency::Listen(const char *socketPath){
+
+    struct sockaddr_un addr;
+
+    if(strlen(socketPath) >= sizeof(addr.sun_path)){
+        cout << "Latency socket path is too long: " << socketPath << endl;
+        return false;
+    }
+
+    listenfd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socketPath);
+
+    unlink(socketPath);         //left behind by a previous run
+    if(bind(listenfd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(listenfd, 4) < 0){
+        cout << "Fail to listen on latency socket " << socketPath << endl;
+        close(listenfd);
+        listenfd = -1;
+        return false;
+    }
+
+    fcntl(listenfd, F_SETFL, fcntl(listenfd, F_GETFL) | O_NONBLOCK);
+    path = socketPath;
+
+    return true;
+}
+
+void DecisionLatency::Serve(){
+
+    int fd = accept(listenfd, NULL, NULL);
+    if(fd < 0)
+        return;
+
+    string table = Format();
+    if(write(fd, table.data(), table.size()) < 0){
+        //client went away: nothing to do
+    }
+
+    close(fd);
+}
+
+const char* DecisionLatency::StageName(int stage){
+
+    static const char *names[STAGE_COUNT] = {
+        "receive", "parse", "dispatch", "retrieve", "reuse", "aim",
+        "page edit", "motion start", "motion done", "send", "total"
+    };
+
+    return (stage >= 0 && stage < STAGE_COUNT) ? names[stage] : "unknown";
+}
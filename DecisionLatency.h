@@ -0,0 +1,136 @@
+/*
+ * DecisionLatency.h
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Declarations of per-stage latency histograms of decisions, from packet arrival to touch command.
+ * Last modified: 2026. 10. 18.
+ */
+
+/*
+ * A decision starts with the state packet the robot aims at and ends when the touch command
+ * leaves the socket. Every stage it goes through is stamped on CLOCK_MONOTONIC (usec), and the
+ * time since the previous stage is recorded into the histogram of that stage:
+ *
+ *      receive         kernel receipt (SO_TIMESTAMPNS) to recvmmsg() return
+ *      parse           packet parsed on the receiver thread
+ *      dispatch        picked up by the state machine from the receiver queue
+ *      retrieve        CBRLfD::RetrieveNearest() on the PreAim worker
+ *      reuse           CBRLfD::Reuse() on the PreAim worker
+ *      aim             ComputeAim()
+ *      page edit       aim written into the shooting page
+ *      motion start    aiming motion started (after the motion playing before it)
+ *      motion done     aiming motion finished
+ *      send            touch command sent by the sender thread
+ *      total           kernel receipt to touch sent
+ *
+ * Retrieve and reuse are stamped on the worker and marked with those stamps when the state machine
+ * takes the plan. A plan made ahead of the packet (PreAim::Speculate()) cost the decision nothing:
+ * its retrieve and reuse are recorded as 0.
+ * Stages a decision skips (e.g. the touch drag starts before the aiming motion) are not recorded.
+ * Histograms are log-linear (HDR style): exact below LATENCY_SUB_BUCKETS usec, then
+ * LATENCY_SUB_BUCKETS buckets per power of two, i.e. within about 3%. Recording is O(1) and never
+ * allocates. The table is dumped on demand: Format() for a signal handler's deferred dump, and
+ * a local (unix) socket that writes it to every connection, e.g.
+ *
+ *      nc -U /tmp/angrydarwin-latency
+ */
+
+#ifndef _DECISIONLATENCY_MODULE_H_
+#define _DECISIONLATENCY_MODULE_H_
+
+#include <pthread.h>
+#include <string>
+
+#include "PacketBatch.h"
+
+#define LATENCY_SUB_BITS        5
+#define LATENCY_SUB_BUCKETS     (1 << LATENCY_SUB_BITS)
+#define LATENCY_MAX_BITS        36      // values up to 2^36 usec (19 hours)
+#define LATENCY_BUCKETS         (LATENCY_SUB_BUCKETS * (LATENCY_MAX_BITS - LATENCY_SUB_BITS + 1))
+#define LATENCY_SOCKET          "/tmp/angrydarwin-latency"
+
+//Stages of a decision, in order
+enum LATENCY_STAGES {
+    STAGE_RECEIVE,
+    STAGE_PARSE,
+    STAGE_DISPATCH,
+    STAGE_RETRIEVE,
+    STAGE_REUSE,
+    STAGE_AIM,
+    STAGE_PAGE_EDIT,
+    STAGE_MOTION_START,
+    STAGE_MOTION_DONE,
+    STAGE_SEND,
+    STAGE_TOTAL,
+    STAGE_COUNT
+};
+
+//----------------------------------------------------------------------
+//  LatencyHistogram
+//----------------------------------------------------------------------
+class LatencyHistogram{
+
+public:
+    LatencyHistogram();
+
+    void Record(long long us);
+    void Reset();
+
+    unsigned long Count(){ return count; }
+    long long Max(){ return max; }
+    double Mean(){ return count ? (double) sum / count : 0.0; }
+    long long Percentile(double q);     //Highest value equivalent to the q-quantile (0 < q <= 1).
+
+private:
+    unsigned long buckets[LATENCY_BUCKETS];
+    unsigned long count;
+    long long sum, max;
+
+    static int Bucket(long long us);
+    static long long BucketLimit(int bucket);   //highest value of a bucket
+};
+
+//----------------------------------------------------------------------
+//  DecisionLatency
+//      Stage timeline of the decision in progress and the histograms of all decisions.
+//      Stages may be marked from any thread.
+//----------------------------------------------------------------------
+class DecisionLatency{
+
+public:
+    DecisionLatency();
+    ~DecisionLatency();
+
+    // Start the timeline of a decision on packet r. A decision still in progress is abandoned.
+    void Begin(const ReceivedPacket &r);
+    // The decision in progress reached stage now. Ignored if no decision is in progress.
+    void Mark(int stage);
+    // Same, at stampUs (CLOCK_MONOTONIC) taken on another thread. A stamp before the previous stage counts as 0.
+    void Mark(int stage, long long stampUs);
+    // Mark the last stage, record the total and end the decision.
+    void Finish(int stage);
+
+    void Reset();
+    std::string Format();                   //Table of the stage percentiles.
+
+    // Serve the table on a unix socket at path. Returns false if it cannot listen.
+    bool Listen(const char *path = LATENCY_SOCKET);
+    int GetFd(){ return listenfd; }
+    void Serve();                           //Answer a pending connection. Call when GetFd() is readable.
+
+    static const char* StageName(int stage);
+
+private:
+    pthread_mutex_t mutex;
+    LatencyHistogram hist[STAGE_COUNT];
+    bool bActive;
+    long long beginUs, lastUs;
+    unsigned long nDecisions, nAbandoned;
+
+    int listenfd;
+    std::string path;
+
+    void MarkAt(int stage, long long now);
+};
+
+#endif
@@ -0,0 +1,233 @@
+/*
+ * DistBenchmark.cpp
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Micro-benchmark for the distance-metric templates of CBRLfD_Simple.h.
+ *
+ *  Every metric is called through a distFunction pointer, as in CBRLfD::Distance(),
+ *  for each supported data type and (for vector metrics) number of (x,y) pairs.
+ *  Results are checked against straightforward double-precision oracles, so a kernel
+ *  optimization that changes results, or an abs() resolving to the int overload, shows
+ *  up as mismatches. For vector metrics, the cost of copying both arguments (they are
+ *  passed by value) is measured separately.
+ *
+ *      ./DistBenchmark [-i iterations] [-o results.json]
+ *
+ *  A JSON line per (metric, type, size) is written to the output file (stdout by default),
+ *  and a readable table to stderr.
+ * Last modified: 2026. 10. 18.
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <math.h>
+
+#include "CBRLfD_Simple.h"
+
+using std::vector;
+
+#define NUM_INPUTS  1024    // distinct argument sets cycled through per measurement
+
+static double now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static volatile float sink;     // keeps results alive
+
+//----------------------------------------------------------------------
+// Oracles: reference definitions of the metrics in double precision.
+//----------------------------------------------------------------------
+static double oracleEqual(double a, double b){
+    return (fabs(a - b) < 5.96e-08) ? 0.0 : 1.0;
+}
+
+static double oracleMaxValue(double a, double b, double var1){
+    if(fabs(var1) < 5.96e-08) return 1.0;
+    double d = fabs(a - b) / var1;
+    return (d > 1.0) ? 1.0 : d;
+}
+
+static double oracleMinValue(double a, double b, double var1){
+    if(fabs(var1 - a) < 5.96e-08) return 1.0;
+    return fabs(var1 / (a - var1));
+}
+
+template <class T>
+static double oracleMinVectorAvg(const vector<T> &a, const vector<T> &b, double var1){
+    double avg = 0.0;
+    for(unsigned j=0; j < b.size()/2; j++){
+        double best = -1.0;
+        for(unsigned i=0; i < a.size()/2; i++){
+            double dx = (double) a[2*i] - b[2*j];
+            double dy = (double) a[2*i+1] - b[2*j+1];
+            double d = dx*dx + dy*dy;
+            if(best < 0 || d < best) best = d;
+        }
+        avg += (best / var1 > 1.0) ? 1.0 : best / var1;
+    }
+    return avg / (b.size()/2);
+}
+
+static void Report(FILE *out, const char *metric, const char *type, unsigned size, double ns, double copyNs, unsigned calls, unsigned checked, unsigned mismatches, double maxError){
+
+    fprintf(out, "{\"metric\":\"%s\",\"type\":\"%s\",\"pairs\":%u,\"ns_per_call\":%.3f,\"copy_ns_per_call\":%.3f,\"calls\":%u,\"checked\":%u,\"mismatches\":%u,\"max_abs_error\":%g}\n",
+            metric, type, size, ns, copyNs, calls, checked, mismatches, maxError);
+    fflush(out);
+
+    fprintf(stderr, "%-14s %-14s %4u pairs %10.2f ns/call  (copies %8.2f ns)  %u/%u mismatches  max error %g\n",
+            metric, type, size, ns, copyNs, mismatches, checked, maxError);
+}
+
+//----------------------------------------------------------------------
+// Scalar metrics: Equal, MaxValue, MinValue
+//----------------------------------------------------------------------
+template <class T>
+static void BenchScalar(FILE *out, const char *metric, const char *type, float (*pFunc)(T, T, T*, T*),
+                        double (*oracle)(double, double, double), T var, unsigned iterations){
+
+    distFunction<T> D;
+    D.pFunc = pFunc;
+    D.var1 = &var;
+    D.var2 = NULL;
+
+    //Inputs mix exact matches, near values and values far apart
+    vector< T > a(NUM_INPUTS), b(NUM_INPUTS);
+    for(unsigned i=0; i<NUM_INPUTS; i++){
+        a[i] = (T) (rand() % 2000 - 1000) / ((T) 1 + (T) (i % 2) * (T) 0.5);
+        switch(i % 4){
+            case 0:  b[i] = a[i]; break;
+            case 1:  b[i] = a[i] + (T) 1; break;
+            case 2:  b[i] = a[i] + (T) 0.25; break;
+            default: b[i] = (T) (rand() % 2000 - 1000); break;
+        }
+    }
+
+    unsigned mismatches = 0;
+    double maxError = 0.0;
+    for(unsigned i=0; i<NUM_INPUTS; i++){
+        double ref = oracle(a[i], b[i], var);
+        double err = fabs((*D.pFunc)(a[i], b[i], D.var1, D.var2) - ref);
+        if(err > 1e-4 * (fabs(ref) > 1.0 ? fabs(ref) : 1.0)) mismatches++;
+        if(err > maxError) maxError = err;
+    }
+
+    double start = now();
+    float acc = 0.0f;
+    for(unsigned n=0; n<iterations; n++)
+        for(unsigned i=0; i<NUM_INPUTS; i++)
+            acc += (*D.pFunc)(a[i], b[i], D.var1, D.var2);
+    double elapsed = now() - start;
+    sink = acc;
+
+    Report(out, metric, type, 1, elapsed * 1e9 / ((double) iterations * NUM_INPUTS), 0.0, iterations * NUM_INPUTS, NUM_INPUTS, mismatches, maxError);
+}
+
+static double equalOracle(double a, double b, double var1){
+    return oracleEqual(a, b);
+}
+
+//----------------------------------------------------------------------
+// Vector metric: MinVectorAvg
+//----------------------------------------------------------------------
+template <class T>
+static void BenchVector(FILE *out, const char *type, unsigned pairs, unsigned iterations){
+
+    distFunction< vector<T> > D;
+    float (*pFunc)(vector<T>, vector<T>, vector<T>*, vector<T>*) = distMinVectorAvg<T>;
+    vector<T> var(1, (T) 40000);
+
+    D.pFunc = pFunc;
+    D.var1 = &var;
+    D.var2 = NULL;
+
+    //Enemy locations in the tablet's game coordinates
+    unsigned inputs = NUM_INPUTS / 16;
+    vector< vector<T> > a(inputs), b(inputs);
+    for(unsigned i=0; i<inputs; i++){
+        for(unsigned j=0; j<pairs; j++){
+            a[i].push_back((T) (700 + rand() % 250) + (T) 0.5);
+            a[i].push_back((T) (rand() % 260) + (T) 0.25);
+            b[i].push_back((T) (700 + rand() % 250));
+            b[i].push_back((T) (rand() % 260));
+        }
+    }
+
+    unsigned mismatches = 0;
+    double maxError = 0.0;
+    for(unsigned i=0; i<inputs; i++){
+        double ref = oracleMinVectorAvg<T>(a[i], b[i], var[0]);
+        double err = fabs((*D.pFunc)(a[i], b[i], D.var1, D.var2) - ref);
+        if(err > 1e-4) mismatches++;
+        if(err > maxError) maxError = err;
+    }
+
+    unsigned rounds = iterations / pairs + 1;
+
+    double start = now();
+    float acc = 0.0f;
+    for(unsigned n=0; n<rounds; n++)
+        for(unsigned i=0; i<inputs; i++)
+            acc += (*D.pFunc)(a[i], b[i], D.var1, D.var2);
+    double elapsed = now() - start;
+
+    //Cost of the two by-value argument copies alone
+    double copyStart = now();
+    for(unsigned n=0; n<rounds; n++){
+        for(unsigned i=0; i<inputs; i++){
+            vector<T> ca(a[i]), cb(b[i]);
+            acc += ca[0] + cb[0];
+        }
+    }
+    double copyElapsed = now() - copyStart;
+    sink = acc;
+
+    double calls = (double) rounds * inputs;
+    Report(out, "MinVectorAvg", type, pairs, elapsed * 1e9 / calls, copyElapsed * 1e9 / calls, (unsigned) calls, inputs, mismatches, maxError);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *outfile = NULL;
+    unsigned iterations = 2000;
+    int opt;
+
+    while((opt = getopt(argc, argv, "i:o:")) != -1){
+        switch(opt){
+            case 'i': iterations = atoi(optarg); break;
+            case 'o': outfile = optarg; break;
+            default:
+                printf("usage: %s [-i iterations] [-o results.json]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    FILE *out = outfile ? fopen(outfile, "w") : stdout;
+    if(!out){
+        printf("Cannot open %s\n", outfile);
+        return 1;
+    }
+
+    srand(1);
+
+    BenchScalar<int>(out, "Equal", "int", distEqual<int>, equalOracle, 0, iterations);
+    BenchScalar<float>(out, "Equal", "float", distEqual<float>, equalOracle, 0.0f, iterations);
+    BenchScalar<int>(out, "MaxValue", "int", distMaxValue<int>, oracleMaxValue, 3, iterations);
+    BenchScalar<float>(out, "MaxValue", "float", distMaxValue<float>, oracleMaxValue, 3.0f, iterations);
+    BenchScalar<int>(out, "MinValue", "int", distMinValue<int>, oracleMinValue, 200, iterations);
+    BenchScalar<float>(out, "MinValue", "float", distMinValue<float>, oracleMinValue, 200.0f, iterations);
+
+    unsigned sizes[] = {1, 2, 4, 8, 16, 64};
+    for(unsigned i=0; i<sizeof(sizes)/sizeof(sizes[0]); i++){
+        BenchVector<int>(out, "vector:int", sizes[i], iterations * 16);
+        BenchVector<float>(out, "vector:float", sizes[i], iterations * 16);
+    }
+
+    if(outfile)
+        fclose(out);
+
+    return 0;
+}
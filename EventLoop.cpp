@@ -0,0 +1,173 @@
+/*
+ * EventLoop.cpp
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Implementation of the epoll event loop driving the Angry Darwin state machine.
+ * Last modified: 2026. 10. 18.
+ */
+
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <iostream>
+
+#include "EventLoop.h"
+
+using std::cout;
+using std::endl;
+
+EventLoop::EventLoop(){
+
+    epfd = epoll_create(EVENTLOOP_MAX_EVENTS);
+    if(epfd < 0)
+        cout << "Cannot create event loop: " << strerror(errno) << endl;
+
+    bRunning = false;
+}
+
+EventLoop::~EventLoop(){
+
+    if(epfd >= 0)
+        close(epfd);
+}
+
+bool EventLoop::Add(int fd, EventHandler *handler){
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+
+    if(epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0){
+        cout << "Cannot add fd " << fd << " to event loop: " << strerror(errno) << endl;
+        return false;
+    }
+
+    handlers[fd] = handler;
+    return true;
+}
+
+void EventLoop::Remove(int fd){
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+
+    epoll_ctl(epfd, EPOLL_CTL_DEL, fd, &ev);
+    handlers.erase(fd);
+}
+
+int EventLoop::Poll(int timeoutMs){
+
+    struct epoll_event events[EVENTLOOP_MAX_EVENTS];
+
+    int n = epoll_wait(epfd, events, EVENTLOOP_MAX_EVENTS, timeoutMs);
+    if(n < 0)
+        return (errno == EINTR) ? 0 : -1;
+
+    for(int i=0; i<n; i++){
+        //A handler may have removed a later fd of this batch
+        std::map< int, EventHandler* >::iterator it = handlers.find(events[i].data.fd);
+        if(it != handlers.end())
+            it->second->OnEvent(events[i].data.fd);
+    }
+
+    return n;
+}
+
+void EventLoop::Run(){
+
+    bRunning = true;
+
+    while(bRunning){
+        if(Poll(-1) < 0){
+            cout << "Event loop failed: " << strerror(errno) << endl;
+            break;
+        }
+    }
+}
+
+void EventLoop::Stop(){
+    bRunning = false;
+}
+
+int EventLoop::CreateTimer(){
+    return timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+}
+
+void EventLoop::ArmTimer(int fd, long long deadlineMs){
+
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+
+    //it_value of zero disarms; a deadline already passed fires immediately
+    if(deadlineMs > 0){
+        its.it_value.tv_sec = deadlineMs / 1000;
+        its.it_value.tv_nsec = (deadlineMs % 1000) * 1000000;
+    }
+
+    timerfd_settime(fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+void EventLoop::ArmPeriodicTimer(int fd, long long periodNs){
+
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+
+    if(periodNs > 0){
+        its.it_interval.tv_sec = periodNs / 1000000000;
+        its.it_interval.tv_nsec = periodNs % 1000000000;
+        its.it_value = its.it_interval;
+    }
+
+    timerfd_settime(fd, 0, &its, NULL);
+}
+
+int EventLoop::CreateNotifier(){
+    return eventfd(0, EFD_NONBLOCK);
+}
+
+void EventLoop::Notify(int fd){
+
+    uint64_t one = 1;
+    if(write(fd, &one, sizeof(one)) < 0){
+        //counter saturated: the loop has not drained it yet, nothing is lost
+    }
+}
+
+unsigned long long EventLoop::Drain(int fd){
+
+    uint64_t count = 0;
+    if(read(fd, &count, sizeof(count)) != sizeof(count))
+        return 0;
+
+    return count;
+}
+
+long long EventLoop::NowMs(){
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (long long) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+long long EventLoop::NowUs(){
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (long long) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+long long EventLoop::CpuUs(bool bThread){
+
+    struct timespec ts;
+    clock_gettime(bThread ? CLOCK_THREAD_CPUTIME_ID : CLOCK_PROCESS_CPUTIME_ID, &ts);
+
+    return (long long) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
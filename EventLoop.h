@@ -0,0 +1,66 @@
+/*
+ * EventLoop.h
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Declarations of the epoll event loop driving the Angry Darwin state machine.
+ * Last modified: 2026. 10. 18.
+ */
+
+/*
+ * File descriptors (sockets, timers, notifiers) are registered with a handler and dispatched
+ * from a single thread, so the state machine reacts to packets, deadlines and motion completion
+ * alike instead of blocking on one socket.
+ *
+ *  - Timers are timerfds armed with absolute CLOCK_MONOTONIC deadlines in milliseconds (NowMs()).
+ *  - Notifiers are eventfds: other threads call Notify(), the loop thread reads them with Drain().
+ */
+
+#ifndef _EVENTLOOP_MODULE_H_
+#define _EVENTLOOP_MODULE_H_
+
+#include <map>
+
+#define EVENTLOOP_MAX_EVENTS    16      // events dispatched per epoll_wait
+
+//Receives the events of the file descriptors it was registered for.
+class EventHandler{
+public:
+    virtual ~EventHandler(){}
+    virtual void OnEvent(int fd) = 0;
+};
+
+//----------------------------------------------------------------------
+//  EventLoop
+//      epoll dispatcher. All handlers run on the thread calling Poll() or Run().
+//----------------------------------------------------------------------
+class EventLoop{
+
+public:
+    EventLoop();
+    ~EventLoop();
+
+    bool Add(int fd, EventHandler *handler);    //Dispatch readability of fd to handler.
+    void Remove(int fd);
+
+    int Poll(int timeoutMs);                    //Wait once and dispatch. Returns the number of events, -1 on error.
+    void Run();                                 //Poll until Stop().
+    void Stop();
+
+    static int CreateTimer();                   //Non-blocking timerfd on CLOCK_MONOTONIC.
+    static void ArmTimer(int fd, long long deadlineMs);    //Absolute deadline (NowMs() clock). 0 disarms.
+    static void ArmPeriodicTimer(int fd, long long periodNs);   //Expire every periodNs from now. 0 disarms.
+    static int CreateNotifier();                //Non-blocking eventfd.
+    static void Notify(int fd);
+    static unsigned long long Drain(int fd);    //Read and reset a timer or notifier. Returns the count.
+
+    static long long NowMs();
+    static long long NowUs();
+    static long long CpuUs(bool bThread = false);     //CPU time (usec) of the process, or of the calling thread.
+
+private:
+    int epfd;
+    bool bRunning;
+    std::map< int, EventHandler* > handlers;
+};
+
+#endif
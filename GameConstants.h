@@ -0,0 +1,38 @@
+/*
+ * GameConstants.h
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Tablet region limits and game timing shared by the robot state machine and the session server.
+ * Last modified: 2026. 10. 18.
+ */
+
+#ifndef _GAMECONSTANTS_MODULE_H_
+#define _GAMECONSTANTS_MODULE_H_
+
+//-------------------------------------------------------------
+// Robot is communicating with the tablet and generates
+// synthesized touch events. Inverse kinematics for the robot's
+// 6-DOF upper body and 2-DOF head is computed for the tablet region.
+// The following limits are defining the tablet screen region where the
+// robot is able to interact.
+//-------------------------------------------------------------
+#define xLowLimit   138
+#define xHighLimit  180
+#define yLowLimit   178
+#define yHighLimit  212
+
+//-------------------------------------------------------------
+// At the end of a round, robot waits until the score stays the same
+// for this period (msec) so that all game physics are settled, but no
+// longer than ROUND_SETTLE_MAX_MS after the end of round.
+//-------------------------------------------------------------
+#define ROUND_SETTLE_MS     1000
+#define ROUND_SETTLE_MAX_MS 5000
+
+//-------------------------------------------------------------
+// After sending the touch command, robot holds its aim for this period (msec)
+// before the next motion.
+//-------------------------------------------------------------
+#define AIM_HOLD_MS         500
+
+#endif
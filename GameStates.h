@@ -0,0 +1,105 @@
+/*
+ * GameStates.h
+ *
+ * Created on: 2026. 10. 18.
+ * Description: States, events and transition rules of the Angry Darwin round state machine.
+ * Last modified: 2026. 10. 18.
+ */
+
+/*
+ * The rules are a template over the handler class, so that the robot (AngryDarwin) and the
+ * hardware-free check (StateCheck, make statecheck) compile the very same list: the check
+ * runs it on a stub handler with the same action names.
+ */
+
+#ifndef _GAMESTATES_MODULE_H_
+#define _GAMESTATES_MODULE_H_
+
+#include "TabletPacket.h"
+#include "StateTable.h"
+
+//Angry Darwin state machine states enum.
+enum{
+    STATE_ROUND_READY,
+    STATE_AIM,
+    STATE_SHOOT,
+    STATE_ROUND_END,
+    STATE_GAME_END,
+    STATE_DEMONSTRATION,
+    STATE_SELF_TRAIN,
+    STATE_IDLE,
+    STATE_COUNT
+};
+
+//Angry Darwin state machine events: the round state of a task-status packet (ROUND_STATES), or a touch.
+enum{
+    EVENT_STATE_UNKNOWN = ROUND_UNKNOWN,
+    EVENT_TRANS_NEW = ROUND_TRANS_NEW,
+    EVENT_NEW_ROUND = ROUND_NEW,
+    EVENT_AIMING_SHOT = ROUND_AIMING_SHOT,
+    EVENT_SHOT_IN_PLAY = ROUND_SHOT_IN_PLAY,
+    EVENT_END_ROUND = ROUND_END,
+    EVENT_TRANS_CALL = ROUND_TRANS_CALL,
+    EVENT_END_GAME = ROUND_END_GAME,
+    EVENT_DEMONSTRATION,    //usertouch inside the tablet touch limit
+    EVENT_TOUCH,            //any other usertouch
+    EVENT_COUNT
+};
+
+#define EVENTS_STATE    (FSM_EVENT(EVENT_END_GAME + 1) - 1)                      // any task status
+#define EVENTS_TOUCH    (FSM_EVENT(EVENT_DEMONSTRATION) | FSM_EVENT(EVENT_TOUCH))  // any usertouch
+
+//----------------------------------------------------------------------
+//  GameRules
+//      State machine transitions: state x event -> action, next state.
+//      Later rules override earlier ones; FSM_ALWAYS rules run on every event of their state first.
+//----------------------------------------------------------------------
+template < class H >
+struct GameRules{
+
+    typedef typename StateTable< H, STATE_COUNT, EVENT_COUNT >::Rule Rule;
+
+    static const Rule rules[];
+    static int Count();
+};
+
+template < class H >
+const typename GameRules< H >::Rule GameRules< H >::rules[] = {
+
+    //Initial task state
+    { STATE_ROUND_READY,    FSM_ALWAYS,                     &H::EnterRoundReady,    FSM_SAME },
+    { STATE_ROUND_READY,    FSM_EVENT(EVENT_DEMONSTRATION), &H::Demonstrate,        STATE_ROUND_END },
+    { STATE_ROUND_READY,    FSM_EVENT(EVENT_NEW_ROUND),     &H::OpenRound,          STATE_AIM },
+    { STATE_ROUND_READY,    FSM_EVENT(EVENT_END_ROUND) | FSM_EVENT(EVENT_TRANS_CALL), NULL, STATE_ROUND_END },
+    { STATE_ROUND_READY,    FSM_EVENT(EVENT_END_GAME),      NULL,                   STATE_GAME_END },
+
+    //Any task status is aimed at; a demonstration takes over
+    { STATE_AIM,            FSM_ALWAYS,                     &H::SuspendIdle,        FSM_SAME },
+    { STATE_AIM,            EVENTS_STATE,                   &H::Decide,             STATE_SHOOT },
+    { STATE_AIM,            FSM_EVENT(EVENT_DEMONSTRATION), &H::Demonstrate,        STATE_ROUND_END },
+
+    //Aiming: shoot when the game is ready for it; any touch interrupts
+    { STATE_SHOOT,          FSM_EVENT(EVENT_AIMING_SHOT),   &H::Shoot,              STATE_ROUND_END },
+    { STATE_SHOOT,          FSM_EVENT(EVENT_END_ROUND),     NULL,                   STATE_ROUND_END },
+    { STATE_SHOOT,          FSM_EVENT(EVENT_TOUCH),         &H::InterruptShot,      FSM_SAME },
+    { STATE_SHOOT,          FSM_EVENT(EVENT_DEMONSTRATION), &H::DemonstrateInShot,  STATE_ROUND_END },
+
+    //Round over: settle the score, then FinishRound() moves on
+    { STATE_ROUND_END,      FSM_ALWAYS,                     &H::SuspendIdle,        FSM_SAME },
+    { STATE_ROUND_END,      EVENTS_STATE,                   &H::EndRound,           FSM_SAME },
+    { STATE_ROUND_END,      FSM_EVENT(EVENT_END_ROUND),     &H::Settle,             FSM_SAME },
+    { STATE_ROUND_END,      EVENTS_TOUCH,                   &H::EndRoundOnTouch,    FSM_SAME },
+
+    //Game over: wait for the next game
+    { STATE_GAME_END,       FSM_EVENT(EVENT_TRANS_NEW) | FSM_EVENT(EVENT_NEW_ROUND), &H::SuspendIdle, STATE_ROUND_READY },
+    { STATE_GAME_END,       FSM_EVENT(EVENT_END_GAME),      &H::ResumeIdle,         FSM_SAME },
+
+    //STATE_IDLE: idle behavior is playing. HandleMotionDone() moves on to STATE_GAME_END.
+};
+
+template < class H >
+int GameRules< H >::Count(){
+    return sizeof(rules) / sizeof(rules[0]);
+}
+
+#endif
@@ -0,0 +1,63 @@
+/*
+ * IngestLog.cpp
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Rebuilds a case base from one or more demonstration logs and reports
+ *  parse and bulk-load timing.
+ *
+ *      ./IngestLog [-j threads] [-v] log_file.txt [more logs ...]
+ *
+ * Last modified: 2026. 10. 18.
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "CBRLfD_Simple.h"
+#include "LogIngest.h"
+
+using std::string;
+using std::vector;
+
+int main(int argc, char *argv[])
+{
+    int numThreads = LOG_INGEST_THREADS;
+    bool bVerbose = false;
+    int opt;
+
+    while((opt = getopt(argc, argv, "j:v")) != -1){
+        switch(opt){
+            case 'j': numThreads = atoi(optarg); break;
+            case 'v': bVerbose = true; break;
+            default:
+                printf("usage: %s [-j threads] [-v] log_file.txt [more logs ...]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if(optind >= argc){
+        printf("usage: %s [-j threads] [-v] log_file.txt [more logs ...]\n", argv[0]);
+        return 1;
+    }
+
+    vector< string > files(argv + optind, argv + argc);
+
+    CBRLfD cbr;
+    LogIngest ingest(numThreads);
+
+    ingest.Ingest(files, &cbr);
+
+    printf("logs: %u, bytes: %lu, case blocks: %d, duplicates: %d, stored: %d\n", (unsigned) files.size(), ingest.nBytes, ingest.nParsed, ingest.nDuplicates, ingest.nStored);
+    printf("parse: %.3f ms (%d threads), bulk load: %.3f ms\n", ingest.parseTime * 1e3, numThreads, ingest.loadTime * 1e3);
+
+    if(bVerbose){
+        for(unsigned i=0; i<cbr.casebase.size(); i++){
+            Problem *p = cbr.casebase[i]->mProblem;
+            printf("ID: %d level(%d) round(%d) enemy(%d) score(%d) -> x(%d) y(%d)\n", cbr.casebase[i]->ID,
+                   p->level, p->round, p->enemy, p->score, cbr.casebase[i]->mSolution->xTouch, cbr.casebase[i]->mSolution->yTouch);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,184 @@
+/*
+ * LedController.cpp
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Implementation of the LED controller.
+ * Last modified: 2026. 10. 18.
+ */
+
+#include <stdlib.h>
+#include <time.h>
+#include <iostream>
+
+#include "LedController.h"
+
+using namespace Robot;
+using std::cout;
+using std::endl;
+
+LedController::LedController(CM730 *cm730){
+
+    mCM730 = cm730;
+    pthread_mutex_init(&lock, NULL);
+
+    leds[LED_HEAD].address = CM730::P_LED_HEAD_L;
+    leds[LED_EYE].address = CM730::P_LED_EYE_L;
+
+    tick = 0;
+    nextLed = 0;
+    seed = (unsigned) time(NULL);
+
+    for(int i=0; i<LED_COUNT; i++){
+        leds[i].shown[0] = leds[i].shown[1] = leds[i].shown[2] = 0;
+        leds[i].written = -1;
+        Start(i, EFFECT_SOLID, 0, 0, 0, 0);
+    }
+
+    nRequests = nWrites = nBusy = 0;
+
+    //Lights only: never drive a joint
+    m_Joint.SetEnableBody(false);
+}
+
+LedController::~LedController(){
+
+    pthread_mutex_destroy(&lock);
+}
+
+void LedController::Initialize(){
+
+    pthread_mutex_lock(&lock);
+    for(int i=0; i<LED_COUNT; i++)
+        leds[i].written = -1;           //unknown after (re)initialization: write again
+    pthread_mutex_unlock(&lock);
+}
+
+void LedController::Set(int led, int r, int g, int b){
+
+    Start(led, EFFECT_SOLID, r, g, b, 0);
+}
+
+void LedController::Blink(int led, int r, int g, int b, unsigned periodMs){
+
+    Start(led, EFFECT_BLINK, r, g, b, periodMs);
+}
+
+void LedController::Fade(int led, int r, int g, int b, unsigned ms){
+
+    Start(led, EFFECT_FADE, r, g, b, ms);
+}
+
+void LedController::Random(int led, unsigned periodMs){
+
+    Start(led, EFFECT_RANDOM, 0, 0, 0, periodMs);
+}
+
+void LedController::Start(int led, int effect, int r, int g, int b, unsigned ms){
+
+    if(led < 0 || led >= LED_COUNT)
+        return;
+
+    pthread_mutex_lock(&lock);
+
+    Led &l = leds[led];
+
+    l.effect = effect;
+    for(int c=0; c<3; c++)
+        l.from[c] = l.shown[c];         //a fade starts at the color shown now
+    l.to[0] = r;
+    l.to[1] = g;
+    l.to[2] = b;
+    if(effect == EFFECT_RANDOM){
+        for(int c=0; c<3; c++)
+            l.to[c] = rand_r(&seed) % 255;
+    }
+    l.startTick = tick;
+    l.periodTicks = ms / MotionModule::TIME_UNIT;
+    if(l.periodTicks < 1)
+        l.periodTicks = 1;
+
+    nRequests++;
+
+    pthread_mutex_unlock(&lock);
+}
+
+//Called every motion tick on the motion timer thread
+void LedController::Process(){
+
+    tick++;
+
+    //Never hold up the motion tick: a state being changed is rendered on the next tick
+    if(pthread_mutex_trylock(&lock) != 0){
+        nBusy++;
+        return;
+    }
+
+    for(int i=0; i<LED_COUNT; i++)
+        Render(leds[i]);
+
+    //At most one write per tick, of an LED whose color changed. Changed LEDs take turns.
+    int address = -1, color = 0;
+    for(int k=0; k<LED_COUNT; k++){
+        Led &l = leds[(nextLed + k) % LED_COUNT];
+        int word = CM730::MakeColor(l.shown[0], l.shown[1], l.shown[2]);
+        if(word != l.written){
+            address = l.address;
+            color = word;
+            l.written = word;
+            nextLed = (nextLed + k + 1) % LED_COUNT;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&lock);
+
+    if(address >= 0){
+        mCM730->WriteWord(address, color, 0);
+        nWrites++;
+    }
+}
+
+//Color of l on the current tick. Called with the lock held.
+void LedController::Render(Led &l){
+
+    unsigned elapsed = tick - l.startTick;
+
+    switch(l.effect){
+
+        case EFFECT_SOLID:
+            for(int c=0; c<3; c++)
+                l.shown[c] = l.to[c];
+            break;
+
+        case EFFECT_BLINK:{
+            unsigned half = l.periodTicks / 2 ? l.periodTicks / 2 : 1;
+            bool bOn = (elapsed / half) % 2 == 0;
+            for(int c=0; c<3; c++)
+                l.shown[c] = bOn ? l.to[c] : 0;
+            break;
+        }
+        case EFFECT_FADE:{
+            if(elapsed > l.periodTicks)
+                elapsed = l.periodTicks;
+            for(int c=0; c<3; c++)
+                l.shown[c] = l.from[c] + (l.to[c] - l.from[c]) * (int) elapsed / (int) l.periodTicks;
+            break;
+        }
+        case EFFECT_RANDOM:
+            if(elapsed > 0 && elapsed % l.periodTicks == 0){
+                for(int c=0; c<3; c++)
+                    l.to[c] = rand_r(&seed) % 255;
+            }
+            for(int c=0; c<3; c++)
+                l.shown[c] = l.to[c];
+            break;
+    }
+}
+
+void LedController::PrintStats(){
+
+    if(nRequests == 0)
+        return;
+
+    cout << "LEDs: " << nRequests << " requests, " << nWrites << " register writes over " << tick << " motion ticks, " << nBusy << " ticks deferred" << endl;
+}
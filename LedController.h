@@ -0,0 +1,90 @@
+/*
+ * LedController.h
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Declarations of the LED controller: head and eye colors and effects, flushed on the motion tick.
+ * Last modified: 2026. 10. 18.
+ */
+
+/*
+ * Writing a CM730 register from the state machine is a serial transaction of its own that contends
+ * with MotionManager::Process()'s SyncWrite for the bus. LedController only records the desired
+ * color or effect of every LED:
+ *
+ *      Set(led, r, g, b)                   solid color
+ *      Blink(led, r, g, b, periodMs)       color and off, half a period each
+ *      Fade(led, r, g, b, ms)              from the color shown now to (r, g, b) in ms
+ *      Random(led, periodMs)               a new random color every period
+ *
+ * Like MotionWatcher it is a motion module without joints: MotionManager calls its Process() every
+ * motion tick (MotionModule::TIME_UNIT) on the motion timer thread, right before the joint SyncWrite.
+ * There it renders the effects and writes at most one LED register per tick, and only one whose
+ * color changed since it was last written. An LED left behind is written on a following tick.
+ * The motion tick never waits for the state machine: if the desired state is being changed it is
+ * rendered on the next tick.
+ */
+
+#ifndef _LEDCONTROLLER_MODULE_H_
+#define _LEDCONTROLLER_MODULE_H_
+
+#include <pthread.h>
+
+#include "MotionModule.h"
+#include "CM730.h"
+
+namespace Robot
+{
+    //LEDs driven by the controller
+    enum LED_IDS {
+        LED_HEAD,               //P_LED_HEAD_L
+        LED_EYE,                //P_LED_EYE_L
+        LED_COUNT
+    };
+
+    class LedController : public MotionModule{
+
+    public:
+
+        LedController(CM730 *cm730);
+        virtual ~LedController();
+
+        void Initialize();
+        void Process();
+
+        // Desired state of led. Called from any thread; takes effect on the next motion tick.
+        void Set(int led, int r, int g, int b);
+        void Blink(int led, int r, int g, int b, unsigned periodMs);
+        void Fade(int led, int r, int g, int b, unsigned ms);
+        void Random(int led, unsigned periodMs);
+
+        void PrintStats();
+
+    private:
+
+        enum LED_EFFECTS { EFFECT_SOLID, EFFECT_BLINK, EFFECT_FADE, EFFECT_RANDOM };
+
+        struct Led{
+            int address;            //control table address of the color word
+            int effect;
+            int from[3], to[3];     //rgb: start and end of a fade, the color otherwise
+            unsigned startTick;     //tick the effect started at
+            unsigned periodTicks;   //blink or random period, fade duration
+            int shown[3];           //rgb rendered on the last tick
+            int written;            //color word last written, -1 if none
+        };
+
+        CM730 *mCM730;
+        pthread_mutex_t lock;       //guards leds against the state machine
+        Led leds[LED_COUNT];
+        volatile unsigned tick;     //motion ticks since start, counted by Process() only
+        int nextLed;                //first LED to look at on the next tick: changed LEDs take turns
+        unsigned seed;
+
+        unsigned long nRequests, nWrites, nBusy;
+
+        void Start(int led, int effect, int r, int g, int b, unsigned ms);
+        void Render(Led &l);
+    };
+}
+
+#endif
@@ -0,0 +1,312 @@
+/*
+ * LogIngest.cpp
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Implementation for rebuilding a case base from demonstration logs.
+ * Last modified: 2026. 10. 18.
+ */
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <set>
+
+#include "LogIngest.h"
+
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+static double now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+//----------------------------------------------------------------------
+// Bounded scanning helpers. Mapped logs are not null-terminated.
+//----------------------------------------------------------------------
+static bool expect(const char *&p, const char *limit, const char *text){
+    unsigned n = strlen(text);
+    if((unsigned)(limit - p) < n || memcmp(p, text, n) != 0)
+        return false;
+    p += n;
+    return true;
+}
+
+static void skipSpaces(const char *&p, const char *limit){
+    while(p < limit && (*p == ' ' || *p == '\t'))
+        p++;
+}
+
+static bool readNumber(const char *&p, const char *limit, double *value){
+    char buf[32];
+    unsigned n = 0;
+
+    while(p+n < limit && n < sizeof(buf)-1 && strchr("+-.0123456789eE", p[n]))
+        n++;
+    if(n == 0)
+        return false;
+
+    memcpy(buf, p, n);
+    buf[n] = 0;
+    *value = strtod(buf, NULL);
+    p += n;
+    return true;
+}
+
+static bool readInt(const char *&p, const char *limit, int *value){
+    double v;
+    if(!readNumber(p, limit, &v))
+        return false;
+    *value = (int) v;
+    return true;
+}
+
+static bool nextLine(const char *&p, const char *limit){
+    const char *nl = (const char*) memchr(p, '\n', limit - p);
+    if(!nl)
+        return false;
+    p = nl + 1;
+    return true;
+}
+
+LogIngest::LogIngest(int numThreads){
+
+    nThreads = (numThreads > 0) ? numThreads : 1;
+    nBytes = 0;
+    nParsed = 0;
+    nDuplicates = 0;
+    nStored = 0;
+    parseTime = 0;
+    loadTime = 0;
+}
+
+LogIngest::~LogIngest(){
+
+}
+
+//Find the first line starting with "ID: " at or after p.
+const char* LogIngest::NextBlock(const char *p, const char *limit){
+
+    while(p < limit){
+        if(limit - p >= 4 && memcmp(p, "ID: ", 4) == 0)
+            return p;
+        const char *nl = (const char*) memchr(p, '\n', limit - p);
+        if(!nl)
+            break;
+        p = nl + 1;
+    }
+
+    return limit;
+}
+
+//Parse the case blocks starting in [begin, end). begin must be at a line start.
+int LogIngest::ParseBlocks(const char *begin, const char *end, const char *limit, caseVector &cases){
+
+    int parsed = 0;
+    const char *p = NextBlock(begin, end);
+
+    while(p < end){
+
+        const char *q = p;
+        int id = 0, level = 0, round = 0, enemy = 0, score = 0, x = 0, y = 0;
+        vector< float > location;
+        bool ok = expect(q, limit, "ID: ") && readInt(q, limit, &id) && nextLine(q, limit);
+
+        ok = ok && expect(q, limit, "Problem: level(") && readInt(q, limit, &level);
+        ok = ok && expect(q, limit, ") round(") && readInt(q, limit, &round);
+        ok = ok && expect(q, limit, ") enemy(") && readInt(q, limit, &enemy);
+        ok = ok && expect(q, limit, ") enemy locations (");
+
+        while(ok){
+            double lx, ly;
+            skipSpaces(q, limit);
+            if(expect(q, limit, ")"))
+                break;
+            ok = expect(q, limit, "(") && readNumber(q, limit, &lx) && expect(q, limit, ",") && readNumber(q, limit, &ly) && expect(q, limit, ")");
+            if(ok){
+                location.push_back(lx);
+                location.push_back(ly);
+            }
+        }
+
+        ok = ok && expect(q, limit, " score(") && readInt(q, limit, &score) && nextLine(q, limit);
+        skipSpaces(q, limit);
+        ok = ok && expect(q, limit, "Solution: x(") && readInt(q, limit, &x);
+        ok = ok && expect(q, limit, ") y(") && readInt(q, limit, &y);
+
+        if(ok && (int) location.size() == 2*enemy){
+
+            Problem *prob = new Problem();
+            prob->level = level;
+            prob->round = round;
+            prob->enemy = enemy;
+            prob->enemyLocation.swap(location);
+            prob->score = score;
+
+            Solution *sol = new Solution();
+            sol->xTouch = x;
+            sol->yTouch = y;
+
+            cases.push_back(new Case(prob, sol, id));
+            parsed++;
+        }
+
+        //Continue after the current "ID: " line
+        if(!nextLine(p, end))
+            break;
+        p = NextBlock(p, end);
+    }
+
+    return parsed;
+}
+
+//Problem and solution of c as bytes: equal keys for cases equal in every feature and in the solution.
+string LogIngest::ContentKey(const Case *c){
+
+    const Problem *p = c->mProblem;
+    int fields[6] = { p->level, p->round, p->enemy, p->score, c->mSolution->xTouch, c->mSolution->yTouch };
+
+    string key((const char*) fields, sizeof(fields));
+    if(!p->enemyLocation.empty())
+        key.append((const char*) &p->enemyLocation[0], p->enemyLocation.size() * sizeof(float));
+
+    return key;
+}
+
+void* LogIngest::Parse_thread(void *ptr){
+
+    Chunk *chunk = (Chunk*) ptr;
+
+    ParseBlocks(chunk->begin, chunk->end, chunk->limit, chunk->cases);
+
+    return NULL;
+}
+
+int LogIngest::Ingest(const vector< string > &files, CBRLfD *cbr){
+
+    vector< Chunk > chunks;
+    vector< std::pair< void*, size_t > > maps;
+
+    nBytes = 0;
+    nParsed = 0;
+    nDuplicates = 0;
+
+    double t0 = now();
+
+    //Map every file and split it into chunks aligned to "ID: " lines.
+    for(unsigned f=0; f<files.size(); f++){
+
+        int fd = open(files[f].c_str(), O_RDONLY);
+        struct stat st;
+
+        if(fd < 0 || fstat(fd, &st) < 0 || st.st_size == 0){
+            if(fd >= 0) close(fd);
+            cout << "Cannot read log " << files[f] << endl;
+            continue;
+        }
+
+        void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+
+        if(addr == MAP_FAILED){
+            cout << "Cannot map log " << files[f] << endl;
+            continue;
+        }
+
+        madvise(addr, st.st_size, MADV_SEQUENTIAL);
+        maps.push_back(std::make_pair(addr, (size_t) st.st_size));
+        nBytes += st.st_size;
+
+        const char *data = (const char*) addr;
+        const char *limit = data + st.st_size;
+        const char *begin = data;
+
+        for(int i=1; i<=nThreads; i++){
+            const char *end = limit;
+            if(i < nThreads){
+                end = data + st.st_size / nThreads * i;
+                nextLine(end, limit);
+                end = NextBlock(end, limit);
+            }
+            if(end <= begin)
+                continue;
+
+            Chunk chunk;
+            chunk.begin = begin;
+            chunk.end = end;
+            chunk.limit = limit;
+            chunks.push_back(chunk);
+
+            begin = end;
+        }
+    }
+
+    //Parse chunks in parallel, nThreads at a time.
+    for(unsigned i=0; i<chunks.size(); i+=nThreads){
+
+        vector< pthread_t > threads;
+
+        for(unsigned j=i; j<chunks.size() && j<i+nThreads; j++){
+            pthread_t t;
+            pthread_create(&t, NULL, Parse_thread, &chunks[j]);
+            threads.push_back(t);
+        }
+        for(unsigned j=0; j<threads.size(); j++)
+            pthread_join(threads[j], NULL);
+    }
+
+    for(unsigned i=0; i<maps.size(); i++)
+        munmap(maps[i].first, maps[i].second);
+
+    //Collect cases in log order, drop those already known and give the others IDs of this case base.
+    caseVector cases;
+    std::set< string > known;
+
+    for(unsigned i=0; i<cbr->casebase.size(); i++){
+        if(cbr->casebase[i]->mProblem && cbr->casebase[i]->mSolution)
+            known.insert(ContentKey(cbr->casebase[i]));
+    }
+
+    for(unsigned i=0; i<chunks.size(); i++)
+        nParsed += chunks[i].cases.size();
+
+    cases.reserve(nParsed);
+    for(unsigned i=0; i<chunks.size(); i++){
+        for(unsigned j=0; j<chunks[i].cases.size(); j++){
+            Case *c = chunks[i].cases[j];
+            if(!known.insert(ContentKey(c)).second){
+                delete c->mProblem;
+                delete c->mSolution;
+                delete c;
+                nDuplicates++;
+                continue;
+            }
+            c->robotID = cbr->nRobotID;
+            c->epoch = cbr->nEpoch;
+            c->ID = cbr->nIDGenerator++;
+            cases.push_back(c);
+        }
+    }
+
+    double t1 = now();
+
+    nStored = cbr->BulkLoad(cases);
+
+    //Cases left in cases were not stored
+    for(unsigned i=0; i<cases.size(); i++){
+        delete cases[i]->mProblem;
+        delete cases[i]->mSolution;
+        delete cases[i];
+    }
+
+    parseTime = t1 - t0;
+    loadTime = now() - t1;
+
+    return nStored;
+}
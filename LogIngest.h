@@ -0,0 +1,73 @@
+/*
+ * LogIngest.h
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Declarations for rebuilding a case base from demonstration logs.
+ * Last modified: 2026. 10. 18.
+ */
+
+/*
+ * Every retained demonstration is written to log_file.txt (LOG::write_log) as a case block:
+ *
+ *      ID: 1
+ *      Problem: level(3) round(1) enemy(4) enemy locations ((773.999,250.551) (823.29,16.7603) ) score(500)
+ *        Solution: x(65) y(123)
+ *
+ *  LogIngest memory-maps one or more logs, splits them into chunks aligned to "ID: " lines,
+ *  parses the chunks in parallel and bulk-loads the parsed cases into a CBRLfD case base.
+ *  Any other log line (packets, retrieval dumps) is skipped.
+ *
+ *  Logged IDs restart from 1 in every session, so ingested cases are given fresh IDs from the
+ *  receiving case base, in log order. Since the IDs are not a key, cases are deduplicated by
+ *  content first: a case equal in every feature and in its solution to a case of the receiving
+ *  case base, or to an earlier case of the logs, is skipped. Ingesting a log twice stores it once.
+ */
+
+#ifndef _LOGINGEST_MODULE_H_
+#define _LOGINGEST_MODULE_H_
+
+#include <pthread.h>
+#include <vector>
+#include <string>
+
+#include "CBRLfD_Simple.h"
+
+#define LOG_INGEST_THREADS  4
+
+class LogIngest{
+
+public:
+    LogIngest(int numThreads = LOG_INGEST_THREADS);
+    ~LogIngest();
+
+    // Parse case blocks of all files and bulk-load them into cbr. Returns the number of cases stored.
+    int Ingest(const vector< string > &files, CBRLfD *cbr);
+
+    // Parse the case blocks starting in [begin, end). A block may extend up to limit.
+    static int ParseBlocks(const char *begin, const char *end, const char *limit, caseVector &cases);
+
+    // Statistics of the last Ingest()
+    unsigned long nBytes;       //bytes mapped
+    int nParsed;                //case blocks parsed
+    int nDuplicates;            //case blocks skipped as equal to a known case
+    int nStored;                //cases stored in the case base
+    double parseTime;           //seconds spent mapping and parsing
+    double loadTime;            //seconds spent in CBRLfD::BulkLoad()
+
+private:
+
+    struct Chunk{
+        const char *begin;
+        const char *end;
+        const char *limit;
+        caseVector cases;
+    };
+
+    int nThreads;
+
+    static void *Parse_thread(void *ptr);
+    static string ContentKey(const Case *c);
+    static const char* NextBlock(const char *p, const char *limit);
+};
+
+#endif
@@ -0,0 +1,376 @@
+/*
+ * MotionPageCache.cpp
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Implementation of the motion page cache.
+ * Last modified: 2026. 10. 18.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <iostream>
+
+#include "MotionPageCache.h"
+#include "EventLoop.h"
+#include "MX28.h"
+
+using std::cout;
+using std::endl;
+
+MotionPageCache::MotionPageCache(){
+
+    memset(tables, 0, sizeof(tables));
+    active = tables[0];
+    nReaders[0] = nReaders[1] = 0;
+    lagIndex = -1;
+    for(int i=0; i<Action::MAXNUM_PAGE; i++)
+        bValid[i] = bDirty[i] = false;
+
+    editIndex = -1;
+    nEdits = 0;
+
+    fd = -1;
+    bRunning = false;
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&changed, NULL);
+
+    nStarts = nCommits = nEditsCommitted = nRejected = nReaderWaits = nWrites = nWriteErrors = 0;
+    commitSumUs = writeSumUs = 0;
+}
+
+MotionPageCache::~MotionPageCache(){
+
+    Stop();
+
+    pthread_mutex_destroy(&lock);
+    pthread_cond_destroy(&changed);
+}
+
+bool MotionPageCache::Load(const char *filename){
+
+    FILE *in = fopen(filename, "rb");
+    if(in == NULL){
+        cout << "Fail to open the motion file " << filename << endl;
+        return false;
+    }
+
+    size_t n = fread(tables[0], sizeof(Action::PAGE), Action::MAXNUM_PAGE, in);
+    fclose(in);
+
+    //Both tables start out the same; loaded before anything reads them
+    memcpy(tables[1], tables[0], sizeof(tables[0]));
+    active = tables[0];
+    lagIndex = -1;
+
+    path = filename;
+
+    int nInvalid = 0;
+    for(int i=0; i<Action::MAXNUM_PAGE; i++){
+        bValid[i] = i > 0 && i < (int) n && VerifyChecksum(&tables[0][i]);
+        if(i > 0 && !bValid[i])
+            nInvalid++;
+    }
+
+    cout << "Motion pages cached: " << Action::MAXNUM_PAGE - 1 - nInvalid << " (" << nInvalid << " left to the file)" << endl;
+
+    return true;
+}
+
+bool MotionPageCache::StartWriteBack(){
+
+    if(bRunning || path.empty())
+        return bRunning;
+
+    fd = open(path.c_str(), O_WRONLY);
+    if(fd < 0){
+        cout << "Fail to open the motion file for write-back " << path << endl;
+        return false;
+    }
+
+    bRunning = true;
+    if(pthread_create(&thread, NULL, WriteBack_thread, this) != 0){
+        cout << "Fail to start the motion page write-back thread" << endl;
+        bRunning = false;
+        close(fd);
+        fd = -1;
+        return false;
+    }
+
+    return true;
+}
+
+void MotionPageCache::Stop(){
+
+    if(!bRunning)
+        return;
+
+    pthread_mutex_lock(&lock);
+    bRunning = false;
+    pthread_cond_broadcast(&changed);
+    pthread_mutex_unlock(&lock);
+
+    pthread_join(thread, NULL);     //writes the pages left dirty first
+
+    close(fd);
+    fd = -1;
+}
+
+bool MotionPageCache::Start(int page){
+
+    if(page < 1 || page >= Action::MAXNUM_PAGE)
+        return false;
+
+    nStarts++;
+
+    //Action copies the page, so a later commit never changes a motion while it plays.
+    //Only this thread swaps the tables: the active one stays put while it is copied.
+    if(bValid[page])
+        return Action::GetInstance()->Start(page, &active[page]);
+
+    return Action::GetInstance()->Start(page);
+}
+
+bool MotionPageCache::GetPage(int index, Action::PAGE &page){
+
+    if(index < 1 || index >= Action::MAXNUM_PAGE || !bValid[index])
+        return false;
+
+    //Register as a reader of the active table. If a swap came in between, the table may be
+    //pending already and written to: let go and take the new active one.
+    Action::PAGE *table;
+    int t;
+    while(true){
+        table = Active();
+        t = TableOf(table);
+        __sync_fetch_and_add(&nReaders[t], 1);
+        if(table == Active())
+            break;
+        __sync_fetch_and_sub(&nReaders[t], 1);
+    }
+
+    page = table[index];
+
+    __sync_fetch_and_sub(&nReaders[t], 1);
+
+    return true;
+}
+
+//Time-based pages only: step time and pause are counted in control periods (MotionModule::TIME_UNIT),
+//scaled by the page speed the way Action scales them (time by speed/32, pause by 32/speed).
+//The pause after the last step is left out; the page has reached its posture by then.
+int MotionPageCache::PlayTimeMs(int index){
+
+    Action::PAGE page;
+
+    if(!GetPage(index, page) || page.header.schedule != Action::TIME_BASE_SCHEDULE || page.header.speed == 0)
+        return 0;
+
+    int steps = page.header.stepnum;
+    int units = 0;
+
+    if(steps > Action::MAXNUM_STEP)
+        steps = Action::MAXNUM_STEP;
+
+    for(int i=0; i<steps; i++){
+        units += page.step[i].time * page.header.speed / 32;
+        if(i+1 < steps)
+            units += page.step[i].pause * 32 / page.header.speed;
+    }
+
+    return units * MotionModule::TIME_UNIT;
+}
+
+bool MotionPageCache::BeginEdit(int page){
+
+    editIndex = -1;
+
+    if(page < 1 || page >= Action::MAXNUM_PAGE || !bValid[page]){
+        cout << "Invalid page index" << endl;
+        return false;
+    }
+
+    edit = active[page];
+    editIndex = page;
+    nEdits = 0;
+
+    return true;
+}
+
+bool MotionPageCache::SetJoint(int step, int id, int value){
+
+    if(editIndex < 0)
+        return false;
+
+    if(step < 0 || step >= Action::MAXNUM_STEP || id < 0 || id >= JointData::NUMBER_OF_JOINTS){
+        cout << "Invalid step index" << endl;
+        nRejected++;
+        return false;
+    }
+
+    if(value < 0 || value > MX28::MAX_VALUE){
+        cout << "Invalid value range" << endl;
+        nRejected++;
+        return false;
+    }
+
+    //Joints the page leaves out stay out
+    if(edit.step[step].position[id] & Action::INVALID_BIT_MASK)
+        return true;
+
+    edit.step[step].position[id] = value;
+    nEdits++;
+
+    return true;
+}
+
+bool MotionPageCache::SetTime(int step, int value){
+
+    if(editIndex < 0)
+        return false;
+
+    if(step < 0 || step >= Action::MAXNUM_STEP || value < 0 || value > 255){
+        cout << "Invalid step time" << endl;
+        nRejected++;
+        return false;
+    }
+
+    edit.step[step].time = value;
+    nEdits++;
+
+    return true;
+}
+
+bool MotionPageCache::Commit(){
+
+    if(editIndex < 0)
+        return false;
+
+    long long startUs = EventLoop::NowUs();
+
+    SetChecksum(&edit);
+
+    Action::PAGE *current = active;
+    Action::PAGE *pending = tables[1 - TableOf(current)];
+
+    //Readers of the pending table took it before the last swap and are copying a page: let them finish
+    volatile int *readers = &nReaders[TableOf(pending)];
+    if(__sync_fetch_and_add(readers, 0) != 0){
+        nReaderWaits++;
+        while(__sync_fetch_and_add(readers, 0) != 0)
+            sched_yield();
+    }
+
+    //Bring the pending table up to date with the last commit, then write this one and swap
+    if(lagIndex >= 0 && lagIndex != editIndex)
+        pending[lagIndex] = current[lagIndex];
+    pending[editIndex] = edit;
+    __sync_bool_compare_and_swap(&active, current, pending);
+    lagIndex = editIndex;
+
+    if(bRunning){
+        pthread_mutex_lock(&lock);
+        bDirty[editIndex] = true;
+        pthread_cond_signal(&changed);
+        pthread_mutex_unlock(&lock);
+    }
+
+    editIndex = -1;
+    nCommits++;
+    nEditsCommitted += nEdits;
+    commitSumUs += EventLoop::NowUs() - startUs;
+
+    return true;
+}
+
+//One write per page: Action loading a linked page meanwhile reads the page before or after it
+bool MotionPageCache::WritePage(int index, const Action::PAGE &page){
+
+    return pwrite(fd, &page, sizeof(Action::PAGE), (off_t) sizeof(Action::PAGE) * index) == (ssize_t) sizeof(Action::PAGE);
+}
+
+void *MotionPageCache::WriteBack_thread(void *ptr){
+
+    MotionPageCache *cache = (MotionPageCache*) ptr;
+    Action::PAGE page;
+
+    pthread_mutex_lock(&cache->lock);
+
+    while(true){
+
+        int index = -1;
+        for(int i=1; i<Action::MAXNUM_PAGE && index < 0; i++){
+            if(cache->bDirty[i])
+                index = i;
+        }
+
+        if(index < 0){
+            if(!cache->bRunning)
+                break;
+            pthread_cond_wait(&cache->changed, &cache->lock);
+            continue;
+        }
+
+        cache->bDirty[index] = false;
+        pthread_mutex_unlock(&cache->lock);
+
+        //Write a copy: the state machine may commit the page again meanwhile
+        long long startUs = EventLoop::NowUs();
+        bool bWritten = cache->GetPage(index, page) && cache->WritePage(index, page);
+        long long writeUs = EventLoop::NowUs() - startUs;
+
+        pthread_mutex_lock(&cache->lock);
+        if(bWritten){
+            cache->nWrites++;
+            cache->writeSumUs += writeUs;
+        }
+        else
+            cache->nWriteErrors++;
+    }
+
+    pthread_mutex_unlock(&cache->lock);
+
+    return NULL;
+}
+
+//Checksum of the motion file format: all bytes of a page add up to 0xff
+void MotionPageCache::SetChecksum(Action::PAGE *page){
+
+    unsigned char sum = 0;
+    unsigned char *pt = (unsigned char*) page;
+
+    page->header.checksum = 0;
+    for(unsigned i=0; i<sizeof(Action::PAGE); i++)
+        sum += pt[i];
+
+    page->header.checksum = (unsigned char) (0xff - sum);
+}
+
+bool MotionPageCache::VerifyChecksum(const Action::PAGE *page){
+
+    unsigned char sum = 0;
+    const unsigned char *pt = (const unsigned char*) page;
+
+    for(unsigned i=0; i<sizeof(Action::PAGE); i++)
+        sum += pt[i];
+
+    return sum == 0xff;
+}
+
+void MotionPageCache::PrintStats(){
+
+    if(nCommits == 0)
+        return;
+
+    pthread_mutex_lock(&lock);
+    unsigned long writes = nWrites, errors = nWriteErrors;
+    long long writeUs = writeSumUs;
+    pthread_mutex_unlock(&lock);
+
+    cout << "Motion pages: " << nStarts << " played, " << nCommits << " commits of " << nEditsCommitted << " edits (avg " << commitSumUs / nCommits << " us), " << nRejected << " edits rejected, " << nReaderWaits << " waits for readers";
+    if(writes > 0 || errors > 0)
+        cout << ", " << writes << " written back (avg " << writeUs / (writes ? writes : 1) << " us), " << errors << " write errors";
+    cout << endl;
+}
@@ -0,0 +1,106 @@
+/*
+ * MotionPageCache.h
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Declarations of the motion page cache: double-buffered pages played from memory, edited in transactions, written back on a thread.
+ * Last modified: 2026. 10. 18.
+ */
+
+/*
+ * Editing a joint of a motion page used to stop the motion timer, load the page from the motion
+ * file, save it back and restart the timer, for every single joint. MotionPageCache reads the
+ * whole motion file once and keeps every page in memory. Edits of a page are a transaction:
+ *
+ *      BeginEdit(page)             copy of the page to edit
+ *      SetJoint(step, id, value)   joint position of a step (ignored for joints the page leaves out)
+ *      SetTime(step, value)        time of a step
+ *      Commit()                    all edits replace the page in one step
+ *
+ * Start(page) plays the page from memory (Action::Start(index, PAGE*)), so a committed edit is
+ * played without touching the motion file. With write-back enabled, committed pages are written
+ * to the motion file on a thread of their own, with one pwrite() per page through a file
+ * descriptor of their own, so that the edits persist and pages linked from another page
+ * (header.next, loaded from the file by Action) see them.
+ *
+ * The page table is double buffered: readers use the active table, Commit() writes the pending
+ * one and swaps them with an atomic pointer exchange. Action copies a page when it starts it, so
+ * a motion in play keeps the page it started with and the next Start() is the step boundary a
+ * commit takes effect at. Nothing stops the motion timer; the 8 ms control loop runs on while
+ * pages change. Edits, Commit() and Start() are made on the state machine thread; GetPage() may
+ * be called from any thread and never blocks the editor for longer than a page copy.
+ */
+
+#ifndef _MOTIONPAGECACHE_MODULE_H_
+#define _MOTIONPAGECACHE_MODULE_H_
+
+#include <pthread.h>
+#include <string>
+
+#include "Action.h"
+
+using namespace Robot;
+
+//----------------------------------------------------------------------
+//  MotionPageCache
+//----------------------------------------------------------------------
+class MotionPageCache{
+
+public:
+    MotionPageCache();
+    ~MotionPageCache();
+
+    // Read every page of the motion file. Pages failing their checksum are played from the file.
+    bool Load(const char *path);
+
+    // Write committed pages back to the motion file on a thread. Stop() writes what is left.
+    bool StartWriteBack();
+    void Stop();
+
+    // Play page from memory. Same as Action::Start(page) otherwise.
+    bool Start(int page);
+
+    // Copy of the active page. Any thread.
+    bool GetPage(int index, Action::PAGE &page);
+
+    // Time (msec) the active page takes to reach its last step, 0 if unknown. Any thread.
+    int PlayTimeMs(int index);
+
+    // Edit transaction of page. One at a time; a new BeginEdit() drops an uncommitted one.
+    bool BeginEdit(int page);
+    bool SetJoint(int step, int id, int value);
+    bool SetTime(int step, int value);
+    bool Commit();
+
+    void PrintStats();
+
+private:
+    Action::PAGE tables[2][Action::MAXNUM_PAGE];
+    Action::PAGE *volatile active;      //table readers use; the other one is pending
+    volatile int nReaders[2];           //readers of each table
+    int lagIndex;                       //page of the last commit, missing from the pending table
+    bool bValid[Action::MAXNUM_PAGE];
+    bool bDirty[Action::MAXNUM_PAGE];   //committed, not yet written back
+
+    int editIndex;                  //page of the transaction, -1 if none
+    Action::PAGE edit;
+    unsigned nEdits;                //edits of the transaction
+
+    std::string path;
+    int fd;                         //motion file, write-back only
+    pthread_t thread;
+    volatile bool bRunning;
+    pthread_mutex_t lock;           //guards bDirty and the write-back counters
+    pthread_cond_t changed;
+
+    unsigned long nStarts, nCommits, nEditsCommitted, nRejected, nReaderWaits, nWrites, nWriteErrors;
+    long long commitSumUs, writeSumUs;
+
+    int TableOf(Action::PAGE *table){ return table == tables[0] ? 0 : 1; }
+    Action::PAGE *Active(){ return __sync_val_compare_and_swap(&active, (Action::PAGE*) NULL, (Action::PAGE*) NULL); }     //atomic load
+    bool WritePage(int index, const Action::PAGE &page);
+    static void SetChecksum(Action::PAGE *page);
+    static bool VerifyChecksum(const Action::PAGE *page);
+    static void *WriteBack_thread(void *ptr);
+};
+
+#endif
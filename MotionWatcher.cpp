@@ -0,0 +1,40 @@
+/*
+ * MotionWatcher.cpp
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Implementation of the motion-completion notifier.
+ * Last modified: 2026. 10. 18.
+ */
+
+#include "Action.h"
+#include "MotionWatcher.h"
+#include "EventLoop.h"
+
+using namespace Robot;
+
+MotionWatcher* MotionWatcher::mWatcher = new MotionWatcher();
+
+MotionWatcher::MotionWatcher(){
+    
+    notifyfd = EventLoop::CreateNotifier();
+    bWasRunning = false;
+    
+    //Watch only: never drive a joint
+    m_Joint.SetEnableBody(false);
+}
+
+void MotionWatcher::Initialize(){
+    
+    bWasRunning = false;
+}
+
+//Called every motion tick on the motion timer thread
+void MotionWatcher::Process(){
+    
+    bool bRunning = Action::GetInstance()->IsRunning();
+    
+    if(bWasRunning && !bRunning)
+        EventLoop::Notify(notifyfd);
+    
+    bWasRunning = bRunning;
+}
@@ -0,0 +1,49 @@
+/*
+ * MotionWatcher.h
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Declarations of the motion-completion notifier.
+ * Last modified: 2026. 10. 18.
+ */
+
+/*
+ * MotionWatcher is a motion module without joints. MotionManager calls its Process() every motion
+ * tick (MotionModule::TIME_UNIT) on the motion timer thread, where it notices the end of an Action
+ * page and signals an eventfd that the state machine's event loop waits on.
+ *
+ * A notification may be stale (a new page may have started since), so handlers check
+ * Action::IsRunning() before acting on it.
+ */
+
+#ifndef _MOTIONWATCHER_MODULE_H_
+#define _MOTIONWATCHER_MODULE_H_
+
+#include "MotionModule.h"
+
+namespace Robot
+{
+    class MotionWatcher : public MotionModule{
+        
+    public:
+        
+        //Return MotionWatcher instance
+        static MotionWatcher* GetInstance() { return mWatcher; }
+        
+        void Initialize();
+        void Process();
+        
+        //eventfd signalled when an Action page finishes
+        int GetFd() { return notifyfd; }
+        
+    private:
+        
+        MotionWatcher();
+        
+        static MotionWatcher *mWatcher;
+        
+        int notifyfd;
+        bool bWasRunning;
+    };
+}
+
+#endif
@@ -0,0 +1,107 @@
+/*
+ * PacketBatch.cpp
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Implementation of batched reception of tablet packets.
+ * Last modified: 2026. 10. 18.
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include "EventLoop.h"
+#include "PacketBatch.h"
+
+PacketBatch::PacketBatch(){
+
+    memset(msgs, 0, sizeof(msgs));
+
+    for(int i=0; i<PACKET_BATCH; i++){
+        iov[i].iov_base = slots[i].text;
+        iov[i].iov_len = PACKET_SIZE - 1;
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = &slots[i].from;
+        msgs[i].msg_hdr.msg_control = control[i];
+    }
+
+    nReceived = 0;
+    nBatches = 0;
+    nSize = 0;
+}
+
+int PacketBatch::Receive(int sockfd, TabletProtocol *protocol, PacketCapture *capture, int max){
+
+    if(max > PACKET_BATCH)
+        max = PACKET_BATCH;
+
+    for(int i=0; i<max; i++){
+        msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+        msgs[i].msg_hdr.msg_controllen = sizeof(control[i]);
+    }
+
+    nSize = recvmmsg(sockfd, msgs, max, MSG_DONTWAIT, NULL);
+    if(nSize <= 0){
+        nSize = 0;
+        return 0;
+    }
+
+    long long stamp = EventLoop::NowUs();
+    long long offset = 0;        //CLOCK_MONOTONIC - CLOCK_REALTIME of kernel timestamps, computed once a batch
+
+    for(int i=0; i<nSize; i++){
+
+        ReceivedPacket &r = slots[i];
+        r.stamp = stamp;
+        r.size = msgs[i].msg_len;
+        r.text[r.size] = 0;
+        r.kernelStamp = 0;
+
+        for(struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msgs[i].msg_hdr); cmsg; cmsg = CMSG_NXTHDR(&msgs[i].msg_hdr, cmsg)){
+            if(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS){
+                struct timespec ts;
+                memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                if(offset == 0){
+                    struct timespec now;
+                    clock_gettime(CLOCK_REALTIME, &now);
+                    offset = stamp - ((long long) now.tv_sec * 1000000 + now.tv_nsec / 1000);
+                }
+                r.kernelStamp = (long long) ts.tv_sec * 1000000 + ts.tv_nsec / 1000 + offset;
+            }
+        }
+
+        if(capture)
+            capture->Record(CAPTURE_INBOUND, stamp, r.text, r.size);
+
+        r.bFrame = TabletProtocol::IsFrame(r.text, r.size);
+        r.bParsed = false;
+        r.parsedStamp = stamp;
+        if(!protocol)
+            continue;
+
+        r.bParsed = protocol->Receive(r.text, r.size, &r.packet);
+        r.parsedStamp = EventLoop::NowUs();
+
+        //Keep the text form for printing and logging
+        if(r.bFrame)
+            r.size = TabletProtocol::FormatPacket(r.packet, r.text, PACKET_SIZE);
+    }
+
+    nReceived += nSize;
+    nBatches++;
+
+    return nSize;
+}
+
+bool PacketBatch::EnableTimestamps(int sockfd){
+
+    int on = 1;
+    return setsockopt(sockfd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) == 0;
+}
+
+bool PacketBatch::Supersedes(const ReceivedPacket &next, const ReceivedPacket &p){
+
+    return p.bParsed && next.bParsed
+        && p.packet.kind == PACKET_STATE && next.packet.kind == PACKET_STATE
+        && p.packet.round == next.packet.round;
+}
@@ -0,0 +1,83 @@
+/*
+ * PacketBatch.h
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Declarations of batched reception of tablet packets.
+ * Last modified: 2026. 10. 18.
+ */
+
+/*
+ * The tablet streams task-status packets much faster than the robot acts on them. When the state
+ * machine falls behind, PacketBatch drains up to PACKET_BATCH queued datagrams with one recvmmsg()
+ * call and parses them all (keeping the protocol's sequence tracking in order). Supersedes() tells
+ * the consumer which ones it may skip, looking at the packet received right after:
+ *
+ *  - Of a run of consecutive state packets with the same round state, only the latest counts.
+ *    The score and enemy locations it carries supersede the earlier ones.
+ *  - Touch packets are never superseded, and they end a run, so every state the user touched in
+ *    stays visible.
+ *  - Unparsed packets are never superseded, so that they are reported.
+ *
+ * Without a protocol (one socket serving several tablets, each with its own sequence tracking),
+ * datagrams are left raw and unparsed.
+ */
+
+#ifndef _PACKETBATCH_MODULE_H_
+#define _PACKETBATCH_MODULE_H_
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "TabletPacket.h"
+#include "TabletProtocol.h"
+#include "PacketCapture.h"
+
+#define PACKET_BATCH    16      // max datagrams per recvmmsg() call
+
+//One received datagram
+struct ReceivedPacket{
+    char text[PACKET_SIZE];     //datagram (binary frames are formatted to text), null-terminated
+    int size;                   //text length
+    struct sockaddr_in from;
+    TabletPacket packet;
+    bool bParsed;
+    bool bFrame;                //received as a binary frame
+    long long stamp;            //time (usec, CLOCK_MONOTONIC) the datagram was received
+    long long kernelStamp;      //time (usec, CLOCK_MONOTONIC) the kernel received it, 0 without EnableTimestamps()
+    long long parsedStamp;      //time (usec, CLOCK_MONOTONIC) it was parsed
+};
+
+//----------------------------------------------------------------------
+//  PacketBatch
+//----------------------------------------------------------------------
+class PacketBatch{
+
+public:
+    PacketBatch();
+
+    // Receive up to max datagrams queued on sockfd without blocking, recording them to capture if given.
+    // protocol may be NULL to leave the datagrams unparsed. Returns the number received.
+    int Receive(int sockfd, TabletProtocol *protocol, PacketCapture *capture = 0, int max = PACKET_BATCH);
+
+    // Have the kernel timestamp the datagrams of sockfd on receipt (SO_TIMESTAMPNS).
+    static bool EnableTimestamps(int sockfd);
+
+    int Size(){ return nSize; }
+    ReceivedPacket& Get(int i){ return slots[i]; }
+
+    // True if the state packet p is superseded by the packet received right after it.
+    static bool Supersedes(const ReceivedPacket &next, const ReceivedPacket &p);
+
+    unsigned long nReceived;    //datagrams received
+    unsigned long nBatches;     //recvmmsg() calls returning datagrams
+
+private:
+    ReceivedPacket slots[PACKET_BATCH];
+    struct mmsghdr msgs[PACKET_BATCH];
+    struct iovec iov[PACKET_BATCH];
+    char control[PACKET_BATCH][CMSG_SPACE(sizeof(struct timespec))];
+    int nSize;
+};
+
+#endif
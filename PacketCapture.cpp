@@ -0,0 +1,139 @@
+/*
+ * PacketCapture.cpp
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Implementation of the capture of tablet datagrams to a binary file.
+ * Last modified: 2026. 10. 18.
+ */
+
+#include <string.h>
+#include <arpa/inet.h>
+#include <iostream>
+
+#include "PacketCapture.h"
+
+using std::cout;
+using std::endl;
+
+static void put16(unsigned char *p, unsigned short v){
+    v = htons(v);
+    memcpy(p, &v, 2);
+}
+
+static void put32(unsigned char *p, unsigned int v){
+    v = htonl(v);
+    memcpy(p, &v, 4);
+}
+
+static unsigned short get16(const unsigned char *p){
+    unsigned short v;
+    memcpy(&v, p, 2);
+    return ntohs(v);
+}
+
+static unsigned int get32(const unsigned char *p){
+    unsigned int v;
+    memcpy(&v, p, 4);
+    return ntohl(v);
+}
+
+PacketCapture::PacketCapture(){
+
+    fp = NULL;
+    nRecords = 0;
+
+    pthread_mutex_init(&mutex, NULL);
+}
+
+PacketCapture::~PacketCapture(){
+
+    Close();
+
+    pthread_mutex_destroy(&mutex);
+}
+
+bool PacketCapture::Open(const char *path){
+
+    unsigned char header[CAPTURE_HEADER_SIZE] = { 'A', 'D', 'C', 'P', CAPTURE_VERSION, 0, 0, 0 };
+
+    Close();
+
+    fp = fopen(path, "wb");
+    if(!fp){
+        cout << "Cannot open capture file " << path << endl;
+        return false;
+    }
+
+    if(fwrite(header, 1, sizeof(header), fp) != sizeof(header)){
+        cout << "Cannot write capture file " << path << endl;
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void PacketCapture::Close(){
+
+    pthread_mutex_lock(&mutex);
+
+    if(fp){
+        fclose(fp);
+        fp = NULL;
+    }
+
+    pthread_mutex_unlock(&mutex);
+}
+
+void PacketCapture::Record(int direction, long long stamp, const void *data, int size){
+
+    unsigned char header[CAPTURE_RECORD_SIZE];
+
+    if(size < 0)
+        return;
+    if(size > CAPTURE_MAX_DATA)
+        size = CAPTURE_MAX_DATA;
+
+    put32(header, (unsigned int) (stamp >> 32));
+    put32(header+4, (unsigned int) stamp);
+    header[8] = (unsigned char) direction;
+    header[9] = 0;
+    put16(header+10, (unsigned short) size);
+
+    pthread_mutex_lock(&mutex);
+
+    if(fp){
+        fwrite(header, 1, sizeof(header), fp);
+        fwrite(data, 1, size, fp);
+        nRecords++;
+    }
+
+    pthread_mutex_unlock(&mutex);
+}
+
+bool PacketCapture::ReadHeader(FILE *in){
+
+    unsigned char header[CAPTURE_HEADER_SIZE];
+
+    if(fread(header, 1, sizeof(header), in) != sizeof(header))
+        return false;
+
+    return memcmp(header, "ADCP", 4) == 0 && header[4] == CAPTURE_VERSION;
+}
+
+bool PacketCapture::ReadRecord(FILE *in, CaptureRecord *r){
+
+    unsigned char header[CAPTURE_RECORD_SIZE];
+
+    if(fread(header, 1, sizeof(header), in) != sizeof(header))
+        return false;
+
+    r->stamp = ((long long) get32(header) << 32) | get32(header+4);
+    r->direction = header[8];
+    r->size = get16(header+10);
+
+    if(r->size > CAPTURE_MAX_DATA)
+        return false;
+
+    return fread(r->data, 1, r->size, in) == (size_t) r->size;
+}
@@ -0,0 +1,71 @@
+/*
+ * PacketCapture.h
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Declarations of the capture of tablet datagrams to a binary file.
+ * Last modified: 2026. 10. 18.
+ */
+
+/*
+ * Every datagram received from and sent to the tablet is appended to a capture file as it was on
+ * the wire, with its CLOCK_MONOTONIC time stamp, so that a session can be replayed (ReplayCapture).
+ * The receiver and the sender thread record concurrently; records are written under a mutex.
+ *
+ *  File header (8 bytes):      'A' 'D' 'C' 'P', u8 version, u8 0, u16 0
+ *  Record (12 bytes + data):   u32 stamp (usec) high, u32 stamp low, u8 direction, u8 0, u16 size, data
+ *
+ * All integers are in network byte order.
+ */
+
+#ifndef _PACKETCAPTURE_MODULE_H_
+#define _PACKETCAPTURE_MODULE_H_
+
+#include <stdio.h>
+#include <pthread.h>
+
+#define CAPTURE_VERSION         1
+#define CAPTURE_HEADER_SIZE     8
+#define CAPTURE_RECORD_SIZE     12      // record header, without data
+#define CAPTURE_MAX_DATA        1000    // same as PACKET_SIZE
+
+enum CAPTURE_DIRECTIONS {
+    CAPTURE_INBOUND,        //tablet to robot
+    CAPTURE_OUTBOUND        //robot to tablet
+};
+
+//One captured datagram
+struct CaptureRecord{
+    long long stamp;        //usec, CLOCK_MONOTONIC of the capturing robot
+    int direction;
+    int size;
+    unsigned char data[CAPTURE_MAX_DATA];
+};
+
+//----------------------------------------------------------------------
+//  PacketCapture
+//----------------------------------------------------------------------
+class PacketCapture{
+
+public:
+    PacketCapture();
+    ~PacketCapture();
+
+    bool Open(const char *path);
+    void Close();
+    bool IsOpen(){ return fp != NULL; }
+
+    // Append a datagram. Safe to call from any thread.
+    void Record(int direction, long long stamp, const void *data, int size);
+
+    unsigned long nRecords;
+
+    // Reading captures back. ReadHeader() must come first; ReadRecord() returns false at the end.
+    static bool ReadHeader(FILE *in);
+    static bool ReadRecord(FILE *in, CaptureRecord *r);
+
+private:
+    FILE *fp;
+    pthread_mutex_t mutex;
+};
+
+#endif
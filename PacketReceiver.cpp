@@ -0,0 +1,164 @@
+/*
+ * PacketReceiver.cpp
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Implementation of the network receiver thread feeding tablet packets to the state machine.
+ * Last modified: 2026. 10. 18.
+ */
+
+#include <unistd.h>
+#include <poll.h>
+#include <iostream>
+
+#include "EventLoop.h"
+#include "PacketReceiver.h"
+
+using std::cout;
+using std::endl;
+
+PacketReceiver::PacketReceiver(){
+
+    mProtocol = NULL;
+    mCapture = NULL;
+    sockfd = -1;
+    notifyfd = EventLoop::CreateNotifier();
+    spacefd = EventLoop::CreateNotifier();
+    nWaiting = 0;
+    bRunning = false;
+    bCounted = false;
+
+    nPackets = 0;
+    nSkipped = 0;
+    nFull = 0;
+    maxDepth = 0;
+    depthSum = 0;
+    waitSumUs = 0;
+    waitMaxUs = 0;
+}
+
+PacketReceiver::~PacketReceiver(){
+
+    Stop();
+
+    if(notifyfd >= 0)
+        close(notifyfd);
+    if(spacefd >= 0)
+        close(spacefd);
+}
+
+bool PacketReceiver::Start(int fd, TabletProtocol *protocol){
+
+    if(bRunning || notifyfd < 0 || spacefd < 0)
+        return false;
+
+    sockfd = fd;
+    mProtocol = protocol;
+
+    bRunning = true;
+    if(pthread_create(&thread_t, NULL, Receiver_thread, this) != 0){
+        cout << "Cannot start packet receiver" << endl;
+        bRunning = false;
+        return false;
+    }
+
+    return true;
+}
+
+void PacketReceiver::Stop(){
+
+    if(!bRunning)
+        return;
+
+    bRunning = false;
+    pthread_join(thread_t, NULL);
+}
+
+ReceivedPacket* PacketReceiver::Next(){
+
+    ReceivedPacket *r = queue.Peek();
+
+    if(r && !bCounted){
+
+        long long wait = EventLoop::NowUs() - r->stamp;
+        unsigned depth = queue.Size();
+
+        waitSumUs += wait;
+        if(wait > waitMaxUs)
+            waitMaxUs = wait;
+
+        depthSum += depth;
+        if(depth > maxDepth)
+            maxDepth = depth;
+
+        bCounted = true;
+    }
+
+    return r;
+}
+
+void PacketReceiver::Pop(bool bSkipped){
+
+    queue.Pop();
+    bCounted = false;
+
+    //Wake the producer if it waits for this record (the exchange orders the pop before the check)
+    if(__sync_bool_compare_and_swap(&nWaiting, 1, 0))
+        EventLoop::Notify(spacefd);
+
+    nPackets++;
+    if(bSkipped)
+        nSkipped++;
+}
+
+void PacketReceiver::PrintStats(){
+
+    if(nPackets == 0)
+        return;
+
+    cout << "Received " << nPackets << " packets (" << nSkipped << " superseded): queue depth avg " << (double) depthSum / nPackets << " max " << maxDepth
+         << ", wait avg " << waitSumUs / (long long) nPackets << " us max " << waitMaxUs << " us, queue full " << nFull << " times" << endl;
+}
+
+void* PacketReceiver::Receiver_thread(void *ptr){
+
+    PacketReceiver *pRecv = (PacketReceiver*) ptr;
+
+    struct pollfd pfd, sfd;
+    pfd.fd = pRecv->sockfd;
+    pfd.events = POLLIN;
+    sfd.fd = pRecv->spacefd;
+    sfd.events = POLLIN;
+
+    while(pRecv->bRunning){
+
+        //Full: leave the datagrams in the socket buffer until the state machine pops a record.
+        //Announce the wait before looking again, so that a Pop() in between is not missed.
+        if(pRecv->queue.Free() == 0){
+            __sync_fetch_and_or(&pRecv->nWaiting, 1);
+            if(pRecv->queue.Free() == 0){
+                pRecv->nFull++;
+                poll(&sfd, 1, RECEIVER_POLL_MS);
+                EventLoop::Drain(pRecv->spacefd);
+            }
+            __sync_fetch_and_and(&pRecv->nWaiting, 0);
+            continue;
+        }
+
+        if(poll(&pfd, 1, RECEIVER_POLL_MS) <= 0)
+            continue;
+
+        //No more datagrams than free records: each one received is queued right away
+        unsigned space = pRecv->queue.Free();
+        int n = pRecv->batch.Receive(pRecv->sockfd, pRecv->mProtocol, pRecv->mCapture, space < PACKET_BATCH ? space : PACKET_BATCH);
+
+        for(int i=0; i<n; i++){
+            *pRecv->queue.Reserve() = pRecv->batch.Get(i);
+            pRecv->queue.Publish();
+        }
+
+        if(n > 0)
+            EventLoop::Notify(pRecv->notifyfd);
+    }
+
+    return NULL;
+}
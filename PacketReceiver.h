@@ -0,0 +1,85 @@
+/*
+ * PacketReceiver.h
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Declarations of the network receiver thread feeding tablet packets to the state machine.
+ * Last modified: 2026. 10. 18.
+ */
+
+/*
+ * The receiver thread waits on the tablet socket, receives and parses packets in batches, stamps
+ * them, and pushes them as fixed-size records into a wait-free SPSC queue. An eventfd wakes the
+ * event loop, whose thread consumes the records with Next() and Pop(). A touch is received while
+ * the state machine is busy retrieving or planning, instead of waiting in the socket buffer.
+ *
+ * Metrics, kept by the consumer: queue depth seen by each record and its wait from reception to
+ * handling. The producer receives no more datagrams than the queue has free records for, and
+ * counts how often it found the queue full. It then sleeps in poll() on an eventfd that Pop()
+ * signals, leaving the datagrams in the socket buffer, so no packet is lost and no time is spent
+ * polling for space.
+ */
+
+#ifndef _PACKETRECEIVER_MODULE_H_
+#define _PACKETRECEIVER_MODULE_H_
+
+#include <pthread.h>
+
+#include "PacketBatch.h"
+#include "SpscQueue.h"
+
+#define RECEIVER_QUEUE_SIZE     64      // records, power of two
+#define RECEIVER_POLL_MS        20      // receiver thread checks for Stop() this often
+
+//----------------------------------------------------------------------
+//  PacketReceiver
+//----------------------------------------------------------------------
+class PacketReceiver{
+
+public:
+    PacketReceiver();
+    ~PacketReceiver();
+
+    // Receive from sockfd on a new thread. The thread runs protocol->Receive() for every datagram.
+    bool Start(int sockfd, TabletProtocol *protocol);
+    void Stop();
+
+    // Record the received datagrams to capture (NULL stops recording).
+    void SetCapture(PacketCapture *capture){ mCapture = capture; }
+
+    int GetFd(){ return notifyfd; }     //readable when records were queued
+
+    // Consumer: first queued record (NULL if none), with its wait and depth accounted.
+    ReceivedPacket* Next();
+    // Consumer: record queued after the one returned by Next(), NULL if none yet.
+    ReceivedPacket* Following(){ return queue.Peek(1); }
+    // Consumer: release the record returned by Next().
+    void Pop(bool bSkipped = false);
+
+    void PrintStats();
+
+    //Metrics
+    unsigned long nPackets;             //records consumed
+    unsigned long nSkipped;             //records released without handling
+    unsigned long nFull;                //times the producer waited for space
+    unsigned maxDepth;
+    unsigned long long depthSum;
+    long long waitSumUs, waitMaxUs;
+
+private:
+    SpscQueue< ReceivedPacket, RECEIVER_QUEUE_SIZE > queue;
+    PacketBatch batch;
+    TabletProtocol *mProtocol;
+    PacketCapture * volatile mCapture;
+
+    int sockfd;
+    int notifyfd;
+    int spacefd;                        //readable when Pop() freed a record the producer waits for
+    volatile int nWaiting;              //1 while the producer waits for space
+    pthread_t thread_t;
+    volatile bool bRunning;
+    bool bCounted;                      //Next() accounted the first record
+
+    static void *Receiver_thread(void *ptr);
+};
+
+#endif
@@ -0,0 +1,309 @@
+/*
+ * PreAim.cpp
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Implementation of aiming on a worker thread.
+ * Last modified: 2026. 10. 18.
+ */
+
+#include <unistd.h>
+#include <iostream>
+
+#include "PreAim.h"
+#include "EventLoop.h"
+
+using std::cout;
+using std::endl;
+
+PreAim::PreAim(){
+
+    mCBR = NULL;
+    mAim = NULL;
+    bRunning = false;
+    notifyfd = -1;
+
+    pthread_mutex_init(&caseLock, NULL);
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&changed, NULL);
+
+    bPending = bPendingDecision = false;
+    bWorking = bWorkingDecision = false;
+    bCancel = false;
+    cancelUs = 0;
+    bPlanned = bDecided = false;
+    generation = 0;
+
+    nSpeculated = nHit = nTakenOver = nMiss = nEmpty = nCancelled = 0;
+    leadSumUs = 0;
+}
+
+PreAim::~PreAim(){
+
+    Stop();
+
+    if(notifyfd >= 0)
+        close(notifyfd);
+
+    pthread_mutex_destroy(&caseLock);
+    pthread_mutex_destroy(&lock);
+    pthread_cond_destroy(&changed);
+}
+
+bool PreAim::Start(CBRLfD *cbr, AimFunction aim){
+
+    mCBR = cbr;
+    mAim = aim;
+
+    notifyfd = EventLoop::CreateNotifier();
+
+    bRunning = true;
+    if(pthread_create(&thread, NULL, PreAim_thread, this) != 0){
+        cout << "Fail to start the pre-aim thread" << endl;
+        bRunning = false;
+        return false;
+    }
+
+    return true;
+}
+
+void PreAim::Stop(){
+
+    if(!bRunning)
+        return;
+
+    pthread_mutex_lock(&lock);
+    bRunning = false;
+    bCancel = true;
+    cancelUs = EventLoop::NowUs();
+    pthread_cond_broadcast(&changed);
+    pthread_mutex_unlock(&lock);
+
+    pthread_join(thread, NULL);
+}
+
+void PreAim::Speculate(const Problem *p){
+
+    if(!bRunning)
+        return;
+
+    pthread_mutex_lock(&lock);
+
+    //Layouts repeat while the round is being set up: plan each once
+    bool bKnown = (bPlanned && SameProblem(&planned, p)) || (bWorking && SameProblem(&working, p)) ||
+                  (bPending && SameProblem(&pending, p));
+
+    if(!bKnown && !bPendingDecision){
+        pending = *p;
+        bPending = true;
+        nSpeculated++;
+        pthread_cond_broadcast(&changed);
+    }
+
+    pthread_mutex_unlock(&lock);
+}
+
+bool PreAim::Decide(const Problem *p, AimPlan &result){
+
+    //Without the worker, decide right here
+    if(!bRunning){
+        Problem copy = *p;
+        Plan(copy, result, NULL);
+        return true;
+    }
+
+    pthread_mutex_lock(&lock);
+
+    bool bHit = bPlanned && SameProblem(&planned, p);
+    bPlanned = false;
+    bDecided = false;
+
+    if(bHit){
+        result = plan;
+        leadSumUs += EventLoop::NowUs() - plan.readyUs;
+        nHit++;
+    }
+    else if(bWorking && !bCancel && SameProblem(&working, p)){
+        //The worker is ahead of a retrieval started now: its plan becomes the decision
+        bWorkingDecision = true;
+        bPending = bPendingDecision = false;
+        nTakenOver++;
+    }
+    else{
+        //What is waiting was for another layout
+        pending = *p;
+        bPending = bPendingDecision = true;
+        nMiss++;
+        pthread_cond_broadcast(&changed);
+    }
+
+    pthread_mutex_unlock(&lock);
+
+    return bHit;
+}
+
+bool PreAim::TakeDecision(AimPlan &result){
+
+    EventLoop::Drain(notifyfd);
+
+    pthread_mutex_lock(&lock);
+
+    bool bTaken = bDecided;
+    if(bDecided){
+        result = decision;
+        bDecided = false;
+    }
+
+    pthread_mutex_unlock(&lock);
+
+    return bTaken;
+}
+
+void PreAim::Cancel(long long stamp){
+
+    pthread_mutex_lock(&lock);
+
+    //A waiting decision never started: it is given up right here
+    if(bPending && bPendingDecision && !bWorking){
+        preemption.Record(EventLoop::NowUs() - stamp);
+        nCancelled++;
+    }
+
+    bPending = bPendingDecision = false;
+    bPlanned = bDecided = false;
+
+    if(bWorking && !bCancel){
+        bCancel = true;
+        cancelUs = stamp;
+    }
+
+    pthread_mutex_unlock(&lock);
+}
+
+void PreAim::LockCases(){
+
+    pthread_mutex_lock(&caseLock);
+}
+
+void PreAim::UnlockCases(bool bChanged){
+
+    if(bChanged){
+        pthread_mutex_lock(&lock);
+        generation++;
+        bPlanned = false;
+        pthread_mutex_unlock(&lock);
+    }
+
+    pthread_mutex_unlock(&caseLock);
+}
+
+void PreAim::PrintStats(){
+
+    pthread_mutex_lock(&lock);
+
+    if(nSpeculated + nMiss > 0)
+        cout << "Pre-aimed " << nSpeculated << " layouts: " << nHit << " decided ahead, " << nTakenOver << " taken over in progress, " << nMiss << " decided from scratch, "
+             << nEmpty << " without cases, ready " << (nHit ? leadSumUs / (long long) nHit : 0) << " us ahead on average" << endl;
+
+    if(nCancelled > 0)
+        cout << "Cancelled " << nCancelled << " aiming tasks: preemption latency p50 " << preemption.Percentile(0.5) << " us p99 " << preemption.Percentile(0.99)
+             << " us max " << preemption.Max() << " us" << endl;
+
+    pthread_mutex_unlock(&lock);
+}
+
+//Equal problems retrieve the same cases: every feature of Distance() is compared.
+bool PreAim::SameProblem(const Problem *p1, const Problem *p2){
+
+    return p1->level == p2->level && p1->round == p2->round && p1->enemy == p2->enemy &&
+           p1->score == p2->score && p1->enemyLocation == p2->enemyLocation;
+}
+
+//Retrieve, reuse and map the aim of p. Returns the case base generation planned on.
+unsigned PreAim::Plan(Problem &p, AimPlan &result, const volatile bool *cancel){
+
+    pthread_mutex_lock(&caseLock);
+
+    pthread_mutex_lock(&lock);
+    unsigned gen = generation;
+    pthread_mutex_unlock(&lock);
+
+    //A retrieval trace is recorded only by the tracing retrieval, which writes Case::distance
+    vector< float > distances;
+    caseVector retrieved = mCBR->GetTrace() ? mCBR->RetrieveNearest(&p, PREAIM_NEAREST, cancel) :
+                                              mCBR->RetrieveNearest(&p, PREAIM_NEAREST, distances, cancel);
+    result.retrievedUs = EventLoop::NowUs();
+
+    result.bRetrieved = retrieved.size() > 0;
+    result.xTouch = result.yTouch = 0;
+    if(result.bRetrieved){
+        Solution *sol = mCBR->Reuse(retrieved);
+        result.xTouch = sol->xTouch;
+        result.yTouch = sol->yTouch;
+        delete sol;
+    }
+    result.reusedUs = EventLoop::NowUs();
+
+    pthread_mutex_unlock(&caseLock);
+
+    result.joints.clear();
+    if(result.bRetrieved)
+        result.joints = mAim(result.xTouch, result.yTouch);
+    result.readyUs = EventLoop::NowUs();
+
+    return gen;
+}
+
+void *PreAim::PreAim_thread(void *ptr){
+
+    PreAim *pAim = (PreAim*) ptr;
+
+    while(1){
+
+        pthread_mutex_lock(&pAim->lock);
+        while(pAim->bRunning && !pAim->bPending)
+            pthread_cond_wait(&pAim->changed, &pAim->lock);
+
+        if(!pAim->bRunning){
+            pthread_mutex_unlock(&pAim->lock);
+            break;
+        }
+
+        Problem p = pAim->pending;
+        pAim->working = p;
+        pAim->bWorkingDecision = pAim->bPendingDecision;
+        pAim->bPending = pAim->bPendingDecision = false;
+        pAim->bWorking = true;
+        pAim->bCancel = false;
+        pthread_mutex_unlock(&pAim->lock);
+
+        AimPlan plan;
+        unsigned gen = pAim->Plan(p, plan, &pAim->bCancel);
+
+        pthread_mutex_lock(&pAim->lock);
+
+        pAim->bWorking = false;
+        if(pAim->bCancel){
+            //Given up: the cancellation may have come in after the last check, which counts as well
+            pAim->preemption.Record(plan.readyUs - pAim->cancelUs);
+            pAim->nCancelled++;
+        }
+        else if(pAim->bWorkingDecision){
+            //Decisions are delivered with or without cases: self training is decided by the caller
+            pAim->decision = plan;
+            pAim->bDecided = true;
+            EventLoop::Notify(pAim->notifyfd);
+        }
+        else if(!plan.bRetrieved)
+            pAim->nEmpty++;
+        else if(gen == pAim->generation){
+            pAim->planned = p;
+            pAim->plan = plan;
+            pAim->bPlanned = true;
+        }
+
+        pthread_cond_broadcast(&pAim->changed);
+        pthread_mutex_unlock(&pAim->lock);
+    }
+
+    return NULL;
+}
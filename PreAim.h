@@ -0,0 +1,120 @@
+/*
+ * PreAim.h
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Declarations of aiming on a worker thread: speculative and cancellable retrieval, reuse and aim joints.
+ * Last modified: 2026. 10. 18.
+ */
+
+/*
+ * The enemy layout of a round is known before the round opens: trans_new_round and state_end_round
+ * packets carry it while the robot is still sitting down. PreAim retrieves, reuses and maps the aim
+ * to joint targets on a worker thread, so that the state machine never blocks on a decision:
+ *
+ *      Speculate(p)    layout seen: plan for p on the worker (the latest request replaces a waiting one)
+ *      Decide(p, plan) round opened: true if the plan was made for exactly p (level, round, enemy,
+ *                      enemy locations, score) on the current case base. Otherwise p becomes the
+ *                      decision task of the worker (a speculation of p in progress is taken over)
+ *                      and its plan is delivered through GetFd() and TakeDecision().
+ *      Cancel(stamp)   the user took over: abort the task in progress. The worker checks the
+ *                      cancellation flag every RETRIEVE_CANCEL_STRIDE cases; the time from stamp
+ *                      (e.g. receipt of the usertouch) to the worker giving up is the preemption latency.
+ *
+ * The worker reads the case base with CBRLfD::RetrieveNearest(), which writes nothing shared.
+ * The thread owning the case base wraps every change of it in LockCases()/UnlockCases(), which
+ * keeps the worker out meanwhile and discards speculative plans made on the old case base.
+ * With a retrieval trace enabled the worker records it, so it is read under LockCases() as well.
+ */
+
+#ifndef _PREAIM_MODULE_H_
+#define _PREAIM_MODULE_H_
+
+#include <pthread.h>
+#include <vector>
+
+#include "CBRLfD_Simple.h"
+#include "DecisionLatency.h"
+
+#define PREAIM_NEAREST      4       // cases used by Reuse()
+
+//Joint targets of an aim point, e.g. shoulder pitch and roll. Must be safe to call from the worker.
+typedef std::vector< int > (*AimFunction)(int x, int y);
+
+//Solution and joint targets planned for a problem
+struct AimPlan{
+    bool bRetrieved;            //false if the case base had no case: nothing was planned
+    int xTouch, yTouch;
+    std::vector< int > joints;  //AimFunction of (xTouch, yTouch)
+    long long retrievedUs;      //when retrieval finished (CLOCK_MONOTONIC)
+    long long reusedUs;         //when reuse finished (CLOCK_MONOTONIC)
+    long long readyUs;          //when the plan was ready (CLOCK_MONOTONIC)
+};
+
+//----------------------------------------------------------------------
+//  PreAim
+//----------------------------------------------------------------------
+class PreAim{
+
+public:
+    PreAim();
+    ~PreAim();
+
+    bool Start(CBRLfD *cbr, AimFunction aim);
+    void Stop();
+
+    // Plan for problem p on the worker. p is copied. Ignored while a decision is waiting.
+    void Speculate(const Problem *p);
+
+    // Decide the confirmed problem p. Returns true with its plan if it was planned ahead (or if the
+    // worker is not running); otherwise false, and the plan follows through TakeDecision(). p is copied.
+    bool Decide(const Problem *p, AimPlan &plan);
+
+    // Decision delivered. Call when GetFd() is readable. Returns false if there is none (e.g. cancelled).
+    int GetFd(){ return notifyfd; }
+    bool TakeDecision(AimPlan &plan);
+
+    // Abort the decision or speculation in progress and drop the waiting ones.
+    // stamp (usec, CLOCK_MONOTONIC) is when the reason for it arrived.
+    void Cancel(long long stamp);
+
+    // Guard a change of the case base. bChanged discards the speculative plans made before it.
+    void LockCases();
+    void UnlockCases(bool bChanged);
+
+    void PrintStats();
+
+    static bool SameProblem(const Problem *p1, const Problem *p2);
+
+private:
+    CBRLfD *mCBR;
+    AimFunction mAim;
+
+    pthread_t thread;
+    volatile bool bRunning;
+    int notifyfd;                   //worker -> event loop: decision delivered
+    pthread_mutex_t caseLock;       //held by the worker while it reads the case base
+    pthread_mutex_t lock;           //guards the fields below
+    pthread_cond_t changed;
+
+    Problem pending;                //waiting for the worker
+    bool bPending, bPendingDecision;
+    Problem working;                //being planned
+    bool bWorking, bWorkingDecision;
+    volatile bool bCancel;          //cancellation flag of the task being planned
+    long long cancelUs;
+    Problem planned;                //speculative plan ready for it
+    bool bPlanned;
+    AimPlan plan;
+    bool bDecided;                  //decision plan waiting for TakeDecision()
+    AimPlan decision;
+    unsigned generation;            //case base changes; speculative plans of older generations are discarded
+
+    unsigned long nSpeculated, nHit, nTakenOver, nMiss, nEmpty, nCancelled;
+    long long leadSumUs;            //plan ready to decision, summed over hits
+    LatencyHistogram preemption;    //cancellation reason to worker given up (usec)
+
+    unsigned Plan(Problem &p, AimPlan &plan, const volatile bool *cancel);
+    static void *PreAim_thread(void *ptr);
+};
+
+#endif
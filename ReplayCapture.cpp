@@ -0,0 +1,287 @@
+/*
+ * ReplayCapture.cpp
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Replays a capture of tablet datagrams (AngryDarwin -c) into a running robot stack
+ *  and reports its decision rate and latency.
+ *
+ *  The inbound datagrams of the capture are sent to the robot over UDP, paced by their time stamps
+ *  at 1x or Nx, while the commands of the robot are received in place of the tablet (start the
+ *  robot with -T 127.0.0.1). The replay is open-loop: the tablet's reactions are the captured ones.
+ *  At maximum speed the replay is paced by the robot instead: the next datagram is sent once the
+ *  robot replied to the previous one, or REPLAY_REPLY_MS after it if it did not.
+ *
+ *  Decisions are touch commands (text or binary; a binary retransmit counts once). Moves, releases,
+ *  full touches and acknowledgements are not. Latency is measured from the last datagram sent
+ *  before a touch command to the command; the same measure is computed on the capture for comparison.
+ *
+ *      ./ReplayCapture [-x speed | -m] [-r robot_ip[:port]] [-p listen_port] [-w drain_ms] capture.bin
+ *
+ * Last modified: 2026. 10. 18.
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <vector>
+#include <algorithm>
+
+#include "EventLoop.h"
+#include "PacketCapture.h"
+#include "TabletProtocol.h"
+
+using std::vector;
+
+#define REPLAY_ROBOT_PORT   12345       // FROM_TABLET_PORT of the robot
+#define REPLAY_LISTEN_PORT  8888        // TO_TABLET_PORT of the robot
+#define REPLAY_DRAIN_MS     2000        // keep listening after the last datagram
+#define REPLAY_REPLY_MS     20          // maximum speed: send the next datagram if no reply came by then
+
+static long long Percentile(vector< long long > &v, double p){
+
+    if(v.empty())
+        return 0;
+
+    unsigned i = (unsigned) (p * (v.size() - 1) + 0.5);
+    std::nth_element(v.begin(), v.begin() + i, v.end());
+
+    return v[i];
+}
+
+//Touch command of the robot, in either protocol. Binary frames return their sequence number in seq.
+static bool IsTouch(const unsigned char *buf, int size, bool *bSeq, unsigned *seq){
+
+    int cmd, x, y;
+
+    *bSeq = false;
+    if(TabletProtocol::DecodeCommandFrame(buf, size, &cmd, &x, &y, seq)){
+        *bSeq = true;
+        return cmd == CMD_TOUCH;
+    }
+
+    return TabletProtocol::ParseCommand((const char*) buf, size, &cmd, &x, &y) && cmd == CMD_TOUCH;
+}
+
+//Sequence number of the last touch command counted. The robot restarts its sequence numbers
+//when the tablet sends FRAME_HELLO, and so does the count.
+struct TouchSeq{
+    bool bAny;
+    unsigned last;
+    TouchSeq(){ Reset(); }
+    void Reset(){ bAny = false; last = 0; }
+};
+
+static bool IsHello(const unsigned char *buf, int size){
+    return TabletProtocol::IsFrame((const char*) buf, size) && buf[3] == FRAME_HELLO;
+}
+
+//Touch command not counted yet: binary retransmits repeat a sequence number already counted
+static bool IsNewTouch(const unsigned char *buf, int size, TouchSeq &touch){
+
+    bool bSeq;
+    unsigned seq;
+
+    if(!IsTouch(buf, size, &bSeq, &seq))
+        return false;
+    if(!bSeq)
+        return true;
+    if(touch.bAny && (int) (seq - touch.last) <= 0)
+        return false;
+
+    touch.bAny = true;
+    touch.last = seq;
+    return true;
+}
+
+static void PrintLatency(const char *name, vector< long long > &lat){
+
+    if(lat.empty()){
+        printf("%-8s no touch commands\n", name);
+        return;
+    }
+
+    printf("%-8s %6u touches, latency p50 %7.1f p90 %7.1f p99 %7.1f max %7.1f ms\n", name, (unsigned) lat.size(),
+           Percentile(lat, 0.5) / 1000.0, Percentile(lat, 0.9) / 1000.0, Percentile(lat, 0.99) / 1000.0,
+           *std::max_element(lat.begin(), lat.end()) / 1000.0);
+}
+
+int main(int argc, char *argv[])
+{
+    double speed = 1.0;
+    const char *robotIP = "127.0.0.1";
+    int robotPort = REPLAY_ROBOT_PORT;
+    int listenPort = REPLAY_LISTEN_PORT;
+    int drainMs = REPLAY_DRAIN_MS;
+    int opt;
+
+    while((opt = getopt(argc, argv, "x:mr:p:w:")) != -1){
+        switch(opt){
+            case 'x': speed = atof(optarg); break;
+            case 'm': speed = 0; break;
+            case 'r':{
+                char *colon = strchr(optarg, ':');
+                if(colon){
+                    *colon = 0;
+                    robotPort = atoi(colon + 1);
+                }
+                robotIP = optarg;
+                break;
+            }
+            case 'p': listenPort = atoi(optarg); break;
+            case 'w': drainMs = atoi(optarg); break;
+            default:
+                printf("usage: %s [-x speed | -m] [-r robot_ip[:port]] [-p listen_port] [-w drain_ms] capture.bin\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if(optind >= argc || speed < 0){
+        printf("usage: %s [-x speed | -m] [-r robot_ip[:port]] [-p listen_port] [-w drain_ms] capture.bin\n", argv[0]);
+        return 1;
+    }
+
+    //Load the capture
+    FILE *in = fopen(argv[optind], "rb");
+    if(!in || !PacketCapture::ReadHeader(in)){
+        printf("%s is not a capture file\n", argv[optind]);
+        return 1;
+    }
+
+    vector< CaptureRecord > inbound;
+    vector< long long > captured;       //latencies of the captured touch commands
+    TouchSeq touch;
+    CaptureRecord r;
+    long long lastIn = -1, first = -1, last = 0;
+    unsigned nOut = 0;
+
+    while(PacketCapture::ReadRecord(in, &r)){
+
+        if(first < 0)
+            first = r.stamp;
+        last = r.stamp;
+
+        if(r.direction == CAPTURE_INBOUND){
+            inbound.push_back(r);
+            lastIn = r.stamp;
+            if(IsHello(r.data, r.size))
+                touch.Reset();
+        }
+        else{
+            nOut++;
+            if(lastIn >= 0 && IsNewTouch(r.data, r.size, touch))
+                captured.push_back(r.stamp - lastIn);
+        }
+    }
+    fclose(in);
+
+    printf("%u inbound, %u outbound datagrams over %.1f s\n", (unsigned) inbound.size(), nOut, (last - first) / 1e6);
+    if(inbound.empty())
+        return 1;
+
+    //Sockets: to the robot, and in place of the tablet
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    int listenfd = socket(AF_INET, SOCK_DGRAM, 0);
+
+    struct sockaddr_in robot, local;
+    memset(&robot, 0, sizeof(robot));
+    robot.sin_family = AF_INET;
+    robot.sin_addr.s_addr = inet_addr(robotIP);
+    robot.sin_port = htons(robotPort);
+
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(listenPort);
+
+    if(bind(listenfd, (struct sockaddr *)&local, sizeof(local)) < 0){
+        printf("Cannot listen on port %d\n", listenPort);
+        return 1;
+    }
+
+    //Replay
+    vector< long long > replayed;
+    struct pollfd pfd;
+    pfd.fd = listenfd;
+    pfd.events = POLLIN;
+
+    unsigned next = 0;
+    long long start = EventLoop::NowUs();
+    long long lastSent = -1, lastCommand = start;
+    long long end = 0;
+    bool bAwaiting = false;             //maximum speed: no reply to the last datagram yet
+    unsigned char buf[CAPTURE_MAX_DATA];
+
+    touch.Reset();
+
+    while(true){
+
+        long long now = EventLoop::NowUs();
+
+        //Send the datagrams that are due
+        while(next < inbound.size()){
+            long long due;
+            if(speed > 0)
+                due = start + (long long) ((inbound[next].stamp - inbound[0].stamp) / speed);
+            else
+                due = bAwaiting ? lastSent + REPLAY_REPLY_MS * 1000 : now;
+            if(due > now)
+                break;
+            sendto(sockfd, inbound[next].data, inbound[next].size, 0, (struct sockaddr *)&robot, sizeof(robot));
+            lastSent = EventLoop::NowUs();
+            if(IsHello(inbound[next].data, inbound[next].size))
+                touch.Reset();
+            next++;
+            if(speed == 0){
+                bAwaiting = true;
+                break;
+            }
+        }
+
+        if(next == inbound.size() && end == 0)
+            end = now + (long long) drainMs * 1000;
+        if(end && now >= end)
+            break;
+
+        //Wait for a command until the next datagram is due
+        int timeout;
+        if(next < inbound.size()){
+            long long due = speed > 0 ? start + (long long) ((inbound[next].stamp - inbound[0].stamp) / speed) : lastSent + REPLAY_REPLY_MS * 1000;
+            timeout = (int) ((due - now + 999) / 1000);
+        }
+        else
+            timeout = (int) ((end - now) / 1000);
+
+        if(poll(&pfd, 1, timeout > 0 ? timeout : 0) > 0){
+            int n = recv(listenfd, buf, sizeof(buf), MSG_DONTWAIT);
+            if(n > 0){
+                bAwaiting = false;
+                if(IsNewTouch(buf, n, touch)){
+                    lastCommand = EventLoop::NowUs();
+                    if(lastSent >= 0)
+                        replayed.push_back(lastCommand - lastSent);
+                }
+            }
+        }
+    }
+
+    double seconds = (lastCommand - start) / 1e6;
+
+    if(speed > 0)
+        printf("replayed at %gx in %.1f s\n", speed, seconds);
+    else
+        printf("replayed at maximum speed in %.1f s\n", seconds);
+
+    PrintLatency("captured", captured);
+    PrintLatency("replayed", replayed);
+    printf("%.1f decisions/s\n", seconds > 0 ? replayed.size() / seconds : 0.0);
+
+    close(sockfd);
+    close(listenfd);
+
+    return 0;
+}
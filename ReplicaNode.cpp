@@ -0,0 +1,89 @@
+/*
+ * ReplicaNode.cpp
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Stand-alone case-base replication node for exercising CaseReplicator
+ *  without robot hardware. Run several nodes on loopback, e.g.
+ *
+ *      ./ReplicaNode -r 1 -p 12401 -P 127.0.0.1:12402 -P 127.0.0.1:12403 -n 100
+ *      ./ReplicaNode -r 2 -p 12402 -P 127.0.0.1:12401 -P 127.0.0.1:12403 -n 100
+ *      ./ReplicaNode -r 3 -p 12403 -P 127.0.0.1:12401 -P 127.0.0.1:12402 -n 100
+ *
+ *  Every node stores n synthetic cases of its own, and prints its case-base size once per second.
+ *  All nodes converge to (number of nodes * n) cases.
+ * Last modified: 2026. 10. 18.
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "CBRLfD_Simple.h"
+#include "Replication.h"
+
+using std::string;
+using std::vector;
+
+int main(int argc, char *argv[])
+{
+    int robotID = 1;
+    int port = REPLICA_PORT;
+    int numCases = 100;
+    int seconds = 10;
+    vector< string > peers;
+    int opt;
+
+    while((opt = getopt(argc, argv, "r:p:P:n:t:")) != -1){
+        switch(opt){
+            case 'r': robotID = atoi(optarg); break;
+            case 'p': port = atoi(optarg); break;
+            case 'P': peers.push_back(optarg); break;
+            case 'n': numCases = atoi(optarg); break;
+            case 't': seconds = atoi(optarg); break;
+            default:
+                printf("usage: %s [-r robot_id] [-p port] [-P peer_ip:port ...] [-n cases] [-t seconds]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    CBRLfD cbr(robotID);
+    CaseReplicator replicator(robotID, cbr.nEpoch, port);
+
+    for(unsigned i=0; i<peers.size(); i++){
+        vector< string > addr;
+        boost::algorithm::split( addr, peers[i], boost::is_any_of(":") );
+        if(addr.size() == 2)
+            replicator.AddPeer(addr[0].c_str(), atoi(addr[1].c_str()));
+    }
+
+    if(!replicator.Start())
+        return 1;
+
+    cbr.SetListener(&replicator);
+    srand(time(NULL) + robotID);
+
+    for(int t=0; t<seconds*10; t++){
+
+        //Store a share of the local cases every 100 ms
+        for(int i=0; i<numCases/10 + 1 && cbr.nIDGenerator <= numCases; i++){
+            int enemy = rand() % 4 + 1;
+            vector< float > location;
+            for(int j=0; j<enemy; j++){
+                location.push_back(700 + rand() % 250);
+                location.push_back(rand() % 260);
+            }
+            cbr.BuildCase(rand() % 5 + 1, rand() % 4 + 1, enemy, location, rand() % 20000, rand() % 200, rand() % 200 + 95);
+        }
+
+        usleep(100000);
+        replicator.MergePending(&cbr);
+
+        if(t % 10 == 9)
+            printf("robot %d: case-base size %u (local %u)\n", robotID, (unsigned) cbr.casebase.size(), replicator.LogSize());
+    }
+
+    replicator.Stop();
+
+    return 0;
+}
@@ -0,0 +1,446 @@
+/*
+ * Replication.cpp
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Implementation for live case-base replication between robots.
+ * Last modified: 2026. 10. 18.
+ */
+
+#include <unistd.h>
+#include <string.h>
+#include <poll.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "Replication.h"
+
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+//----------------------------------------------------------------------
+// Byte-order helpers for record encoding.
+//----------------------------------------------------------------------
+static void put16(unsigned char *p, unsigned short v){
+    v = htons(v);
+    memcpy(p, &v, 2);
+}
+
+static void put32(unsigned char *p, unsigned int v){
+    v = htonl(v);
+    memcpy(p, &v, 4);
+}
+
+static unsigned short get16(const unsigned char *p){
+    unsigned short v;
+    memcpy(&v, p, 2);
+    return ntohs(v);
+}
+
+static unsigned int get32(const unsigned char *p){
+    unsigned int v;
+    memcpy(&v, p, 4);
+    return ntohl(v);
+}
+
+static void putHeader(unsigned char *p, int type, int robotID, unsigned epoch, unsigned seq){
+    p[0] = 'C';
+    p[1] = 'R';
+    p[2] = REPLICA_VERSION;
+    p[3] = (unsigned char) type;
+    put16(p+4, (unsigned short) robotID);
+    put32(p+6, epoch);
+    put32(p+10, seq);
+}
+
+#define HEADER_SIZE     14
+#define DELTA_SIZE      (HEADER_SIZE + 16)
+
+CaseReplicator::CaseReplicator(int robotID, unsigned epoch, int port){
+
+    nRobotID = robotID;
+    nEpoch = epoch;
+    nPort = port;
+    sockfd = -1;
+    bRunning = false;
+
+    pthread_mutex_init(&mutex, NULL);
+}
+
+CaseReplicator::~CaseReplicator(){
+
+    Stop();
+
+    for(unsigned i=0; i<inbox.size(); i++){
+        delete inbox[i]->mProblem;
+        delete inbox[i]->mSolution;
+        delete inbox[i];
+    }
+
+    pthread_mutex_destroy(&mutex);
+}
+
+void CaseReplicator::AddPeer(const char *ip, int port){
+
+    Peer peer;
+
+    bzero(&peer.addr, sizeof(peer.addr));
+    peer.addr.sin_family = AF_INET;
+    peer.addr.sin_addr.s_addr = inet_addr(ip);
+    peer.addr.sin_port = htons(port);
+    peer.acked = 0;
+    peer.sent = 0;
+    peer.lastProgress = NowMs();
+
+    peers.push_back(peer);
+}
+
+bool CaseReplicator::Start(){
+
+    struct sockaddr_in addr;
+
+    sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+
+    bzero(&addr, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(nPort);
+
+    if(bind(sockfd, (struct sockaddr *)&addr, sizeof(addr)) < 0){
+        cout << "Fail to bind replication port " << nPort << endl;
+        close(sockfd);
+        sockfd = -1;
+        return false;
+    }
+
+    bRunning = true;
+    pthread_create(&thread_t, NULL, Replication_thread, this);
+
+    return true;
+}
+
+void CaseReplicator::Stop(){
+
+    if(!bRunning)
+        return;
+
+    bRunning = false;
+    pthread_join(thread_t, NULL);
+
+    close(sockfd);
+    sockfd = -1;
+}
+
+//Append a local case to the outbound log. Called by CBRLfD on the thread owning it.
+void CaseReplicator::OnRetain(Case *c){
+
+    unsigned char buf[REPLICA_MAX_RECORD];
+
+    pthread_mutex_lock(&mutex);
+
+    int size = EncodeDelta(c, outLog.size(), buf);
+    if(size > 0)
+        outLog.push_back(string((const char*) buf, size));
+    else
+        cout << "Case " << c->ID << " is too large to replicate" << endl;
+
+    pthread_mutex_unlock(&mutex);
+}
+
+//Merge received cases into cbr. Must be called by the thread owning cbr.
+int CaseReplicator::MergePending(CBRLfD *cbr){
+
+    caseVector received;
+    int merged = 0;
+
+    pthread_mutex_lock(&mutex);
+    received.swap(inbox);
+    pthread_mutex_unlock(&mutex);
+
+    for(unsigned i=0; i<received.size(); i++){
+        if(cbr->Merge(received[i]))
+            merged++;
+        else{
+            delete received[i]->mProblem;
+            delete received[i]->mSolution;
+            delete received[i];
+        }
+    }
+
+    return merged;
+}
+
+unsigned CaseReplicator::LogSize(){
+
+    pthread_mutex_lock(&mutex);
+    unsigned size = outLog.size();
+    pthread_mutex_unlock(&mutex);
+
+    return size;
+}
+
+//----------------------------------------------------------------------
+// Record encoding and decoding (see Replication.h for the layout)
+//----------------------------------------------------------------------
+int CaseReplicator::EncodeDelta(const Case *c, unsigned seq, unsigned char *buf){
+
+    const Problem *p = c->mProblem;
+    const Solution *s = c->mSolution;
+
+    int enemy = p->enemyLocation.size() / 2;
+    int size = DELTA_SIZE + 8*enemy;
+
+    if(size > REPLICA_MAX_RECORD || enemy > 255)
+        return 0;
+
+    putHeader(buf, REC_DELTA, c->robotID, c->epoch, seq);
+
+    unsigned char *q = buf + HEADER_SIZE;
+    put32(q, c->ID);
+    q[4] = (unsigned char) p->level;
+    q[5] = (unsigned char) p->round;
+    q[6] = (unsigned char) enemy;
+    q[7] = 0;
+    put32(q+8, (unsigned int) p->score);
+    put16(q+12, (unsigned short) s->xTouch);
+    put16(q+14, (unsigned short) s->yTouch);
+    q += 16;
+
+    for(int i=0; i<2*enemy; i++){
+        unsigned int v;
+        memcpy(&v, &p->enemyLocation[i], 4);
+        put32(q, v);
+        q += 4;
+    }
+
+    return size;
+}
+
+Case* CaseReplicator::DecodeDelta(const unsigned char *buf, int size, unsigned *seq){
+
+    if(size < DELTA_SIZE || buf[3] != REC_DELTA)
+        return NULL;
+
+    const unsigned char *q = buf + HEADER_SIZE;
+    int enemy = q[6];
+
+    if(size != DELTA_SIZE + 8*enemy)
+        return NULL;
+
+    Problem *p = new Problem();
+    p->level = q[4];
+    p->round = q[5];
+    p->enemy = enemy;
+    p->score = (int) get32(q+8);
+
+    Solution *s = new Solution();
+    s->xTouch = (short) get16(q+12);
+    s->yTouch = (short) get16(q+14);
+
+    q += 16;
+    for(int i=0; i<2*enemy; i++){
+        unsigned int v = get32(q);
+        float f;
+        memcpy(&f, &v, 4);
+        p->enemyLocation.push_back(f);
+        q += 4;
+    }
+
+    *seq = get32(buf+10);
+
+    return new Case(p, s, get32(buf+HEADER_SIZE), get16(buf+4), get32(buf+6));
+}
+
+//----------------------------------------------------------------------
+// Replication thread: receives records, and sends deltas, heartbeats and retransmissions.
+//----------------------------------------------------------------------
+void* CaseReplicator::Replication_thread(void *ptr){
+
+    CaseReplicator *pRep = (CaseReplicator*) ptr;
+
+    unsigned char buf[REPLICA_MAX_RECORD];
+    struct sockaddr_in from;
+    socklen_t len;
+    struct pollfd pfd;
+    long long lastHeartbeat = 0;
+
+    pfd.fd = pRep->sockfd;
+    pfd.events = POLLIN;
+
+    while(pRep->bRunning){
+
+        if(poll(&pfd, 1, 20) > 0){
+            len = sizeof(from);
+            int n = recvfrom(pRep->sockfd, buf, sizeof(buf), MSG_DONTWAIT, (struct sockaddr *)&from, &len);
+            if(n >= HEADER_SIZE && buf[0] == 'C' && buf[1] == 'R' && buf[2] == REPLICA_VERSION)
+                pRep->Receive(buf, n, from);
+        }
+
+        long long now = NowMs();
+
+        pRep->SendPending(now);
+
+        if(now - lastHeartbeat >= REPLICA_HEARTBEAT_MS){
+            unsigned size = pRep->LogSize();
+            for(unsigned i=0; i<pRep->peers.size(); i++)
+                pRep->SendControl(REC_HEARTBEAT, pRep->nEpoch, size, pRep->peers[i].addr);
+            lastHeartbeat = now;
+        }
+    }
+
+    return NULL;
+}
+
+void CaseReplicator::Receive(const unsigned char *buf, int size, const struct sockaddr_in &from){
+
+    int type = buf[3];
+    int robot = get16(buf+4);
+    unsigned epoch = get32(buf+6);
+    unsigned seq = get32(buf+10);
+
+    pthread_mutex_lock(&mutex);
+
+    switch(type){
+
+        case REC_DELTA:{
+
+            Origin *origin = FindOrigin(robot, epoch);
+            if(origin == NULL)
+                break;
+
+            //Accept records in log order only. Anything beyond the expected position is a gap.
+            unsigned &next = origin->next;
+
+            if(seq == next && inbox.size() < REPLICA_INBOX_MAX){
+                unsigned s;
+                Case *c = DecodeDelta(buf, size, &s);
+                if(c){
+                    inbox.push_back(c);
+                    next++;
+                }
+            }
+            else if(seq > next){
+                pthread_mutex_unlock(&mutex);
+                SendControl(REC_SYNC, epoch, next, from);
+                return;
+            }
+
+            unsigned ack = next;
+            pthread_mutex_unlock(&mutex);
+            SendControl(REC_ACK, epoch, ack, from);
+            return;
+        }
+
+        case REC_HEARTBEAT:{
+
+            Origin *origin = FindOrigin(robot, epoch);
+            if(origin == NULL)
+                break;
+
+            //Origin has cases we have not seen: ask for catch-up.
+            unsigned next = origin->next;
+            pthread_mutex_unlock(&mutex);
+
+            if(seq > next)
+                SendControl(REC_SYNC, epoch, next, from);
+            return;
+        }
+
+        case REC_ACK:
+        case REC_SYNC:{
+
+            //Positions in the log of an earlier incarnation of this robot mean nothing to this one
+            if(epoch != nEpoch)
+                break;
+
+            Peer *peer = FindPeer(from);
+            if(seq > outLog.size())
+                seq = outLog.size();
+
+            if(peer && type == REC_ACK && seq > peer->acked){
+                peer->acked = seq;
+                peer->lastProgress = NowMs();
+                if(peer->sent < peer->acked)
+                    peer->sent = peer->acked;
+            }
+            else if(peer && type == REC_SYNC){
+                //Peer missed records or restarted: resend from the requested position.
+                peer->acked = seq;
+                peer->sent = seq;
+                peer->lastProgress = NowMs();
+            }
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&mutex);
+}
+
+//Send outbound log records to every peer within its window.
+void CaseReplicator::SendPending(long long now){
+
+    pthread_mutex_lock(&mutex);
+
+    for(unsigned i=0; i<peers.size(); i++){
+
+        Peer &peer = peers[i];
+
+        //No acknowledgement progress: go back to the last acknowledged record.
+        if(peer.sent > peer.acked && now - peer.lastProgress > REPLICA_RETRANSMIT_MS){
+            peer.sent = peer.acked;
+            peer.lastProgress = now;
+        }
+
+        while(peer.sent < outLog.size() && peer.sent - peer.acked < REPLICA_WINDOW){
+            const string &rec = outLog[peer.sent];
+            sendto(sockfd, rec.data(), rec.size(), 0, (struct sockaddr *)&peer.addr, sizeof(peer.addr));
+            peer.sent++;
+        }
+    }
+
+    pthread_mutex_unlock(&mutex);
+}
+
+void CaseReplicator::SendControl(int type, unsigned epoch, unsigned seq, const struct sockaddr_in &to){
+
+    unsigned char buf[HEADER_SIZE];
+
+    putHeader(buf, type, nRobotID, epoch, seq);
+    sendto(sockfd, buf, HEADER_SIZE, 0, (struct sockaddr *)&to, sizeof(to));
+}
+
+//Log state of robot in epoch. A newer epoch means the robot restarted: its new log starts at 0.
+//Returns NULL for records of an earlier epoch, still in flight from before the restart.
+CaseReplicator::Origin* CaseReplicator::FindOrigin(int robot, unsigned epoch){
+
+    bool bKnown = expected.count(robot) > 0;
+    Origin &origin = expected[robot];
+
+    if(!bKnown || epoch > origin.epoch){
+        origin.epoch = epoch;
+        origin.next = 0;
+    }
+    else if(epoch < origin.epoch)
+        return NULL;
+
+    return &origin;
+}
+
+CaseReplicator::Peer* CaseReplicator::FindPeer(const struct sockaddr_in &addr){
+
+    for(unsigned i=0; i<peers.size(); i++)
+        if(peers[i].addr.sin_addr.s_addr == addr.sin_addr.s_addr && peers[i].addr.sin_port == addr.sin_port)
+            return &peers[i];
+
+    return NULL;
+}
+
+long long CaseReplicator::NowMs(){
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (long long) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
@@ -0,0 +1,128 @@
+/*
+ * Replication.h
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Declarations for live case-base replication between robots.
+ * Last modified: 2026. 10. 18.
+ */
+
+/*
+ * Every robot streams the cases it stores locally to its peers as compact binary delta records
+ * over UDP, and merges the records it receives from its peers into its own case base.
+ *
+ *  - Cases are identified by (robotID, epoch, ID), so receiving a record twice is harmless.
+ *  - Each robot keeps an outbound log of its own cases. Records carry their log position (seq).
+ *  - The log lives as long as the process. A restarted robot starts a new log under a new epoch;
+ *      a peer seeing a newer epoch of a robot expects that robot's log from position 0 again.
+ *  - Peers acknowledge the next log position they expect. A robot never has more than
+ *      REPLICA_WINDOW unacknowledged records in flight to a peer (backpressure), and goes back
+ *      to the last acknowledged position when acknowledgements stop (go-back-N).
+ *  - A peer that detects a gap, or that (re)joins late, asks for catch-up from a log position.
+ *  - Records are received on the replication thread but merged into the case base only by
+ *      the thread owning CBRLfD, through MergePending().
+ */
+
+#ifndef _REPLICATION_MODULE_H_
+#define _REPLICATION_MODULE_H_
+
+#include <pthread.h>
+#include <netinet/in.h>
+#include <map>
+#include <vector>
+#include <string>
+
+#include "CBRLfD_Simple.h"
+
+#define REPLICA_VERSION         2
+#define REPLICA_PORT            12400   // default replication port
+#define REPLICA_WINDOW          64      // max unacknowledged records in flight per peer
+#define REPLICA_INBOX_MAX       1024    // max received cases waiting for MergePending()
+#define REPLICA_RETRANSMIT_MS   200     // go back to the last acknowledged record after this silence
+#define REPLICA_HEARTBEAT_MS    1000    // log-size announcement period
+#define REPLICA_MAX_RECORD      512     // max size of an encoded record in bytes
+
+//----------------------------------------------------------------------
+//  Replication record types
+//
+//  Header (14 bytes, network byte order)
+//      u8 'C', u8 'R', u8 version, u8 type, u16 robotID, u32 epoch, u32 seq
+//
+//  REC_DELTA       robotID = origin, epoch = origin's epoch, seq = position in origin's log
+//                  u32 case ID, u8 level, u8 round, u8 enemy, u8 reserved,
+//                  i32 score, i16 xTouch, i16 yTouch, f32 enemyLocation[2*enemy]
+//  REC_ACK         robotID = sender, epoch = receiver's epoch, seq = next log position the sender expects from the receiver
+//  REC_SYNC        robotID = sender, epoch = receiver's epoch, seq = log position the receiver should resend from
+//  REC_HEARTBEAT   robotID = origin, epoch = origin's epoch, seq = size of origin's log
+//----------------------------------------------------------------------
+enum REPLICA_RECORD_TYPES {
+    REC_DELTA = 1,
+    REC_ACK,
+    REC_SYNC,
+    REC_HEARTBEAT
+};
+
+//----------------------------------------------------------------------
+//  CaseReplicator
+//      Replicates the cases stored in one CBRLfD instance to a set of peers,
+//      and collects the cases replicated by those peers.
+//----------------------------------------------------------------------
+class CaseReplicator : public CaseListener{
+
+public:
+    CaseReplicator(int robotID, unsigned epoch, int port);     //epoch: CBRLfD::nEpoch of the local case base
+    ~CaseReplicator();
+
+    void AddPeer(const char *ip, int port);     //Add a peer robot. Call before Start().
+    bool Start();                               //Bind the replication socket and start the replication thread.
+    void Stop();                                //Stop the replication thread.
+
+    void OnRetain(Case *c);                     //Append a local case to the outbound log (CaseListener).
+    int MergePending(CBRLfD *cbr);              //Merge received cases into cbr. Returns the number of new cases.
+
+    unsigned LogSize();                         //Number of local cases in the outbound log.
+
+    // Record encoding. Returns the encoded size, or 0 if the case does not fit.
+    static int EncodeDelta(const Case *c, unsigned seq, unsigned char *buf);
+    // Record decoding. Returns a new case, or NULL if the record is malformed.
+    static Case* DecodeDelta(const unsigned char *buf, int size, unsigned *seq);
+
+private:
+
+    struct Peer{
+        struct sockaddr_in addr;
+        unsigned acked;         //next log position the peer expects
+        unsigned sent;          //next log position to send
+        long long lastProgress; //time (ms) of the last acknowledgement progress
+    };
+
+    struct Origin{
+        unsigned epoch;         //latest epoch seen from the robot
+        unsigned next;          //next log position expected in that epoch
+    };
+
+    int nRobotID;
+    unsigned nEpoch;
+    int nPort;
+    int sockfd;
+
+    pthread_t thread_t;
+    volatile bool bRunning;
+    pthread_mutex_t mutex;
+
+    vector< Peer > peers;
+    vector< string > outLog;                    //encoded REC_DELTA records of local cases, in log order
+    std::map< int, Origin > expected;           //next log position expected from each origin robot
+    caseVector inbox;                           //decoded cases waiting for MergePending()
+
+    static void *Replication_thread(void *ptr);
+
+    void Receive(const unsigned char *buf, int size, const struct sockaddr_in &from);
+    void SendPending(long long now);
+    void SendControl(int type, unsigned epoch, unsigned seq, const struct sockaddr_in &to);
+    Origin* FindOrigin(int robot, unsigned epoch);
+    Peer* FindPeer(const struct sockaddr_in &addr);
+
+    static long long NowMs();
+};
+
+#endif
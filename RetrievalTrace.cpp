@@ -0,0 +1,91 @@
+/*
+ * RetrievalTrace.cpp
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Implementation for structured tracing of case retrieval.
+ * Last modified: 2026. 10. 18.
+ */
+
+#include <sstream>
+
+#include "RetrievalTrace.h"
+#include "Log.h"
+
+using std::string;
+using std::vector;
+using std::stringstream;
+using std::endl;
+
+RetrievalTrace::RetrievalTrace(unsigned capacity, const vector< string > &features){
+
+    ring.resize(capacity > 0 ? capacity : 1);
+    featureNames = features;
+    nSeq = 0;
+}
+
+RetrievalTrace::~RetrievalTrace(){
+
+}
+
+TraceRecord* RetrievalTrace::Next(){
+
+    TraceRecord *r = &ring[nSeq % ring.size()];
+    r->seq = nSeq;
+
+    return r;
+}
+
+void RetrievalTrace::Commit(){
+    nSeq++;
+}
+
+unsigned RetrievalTrace::Size(){
+    return (nSeq < ring.size()) ? nSeq : ring.size();
+}
+
+const TraceRecord* RetrievalTrace::Get(unsigned i){
+
+    unsigned long first = nSeq - Size();
+
+    return &ring[(first + i) % ring.size()];
+}
+
+void RetrievalTrace::Clear(){
+    nSeq = 0;
+}
+
+string RetrievalTrace::Format(const TraceRecord *r){
+
+    stringstream sstm;
+
+    sstm << "[Retrieval " << r->seq << "] Given Problem: level(" << r->level << ") round(" << r->round << ") enemy(" << r->enemy << ") enemy locations (";
+
+    for (int i=0; i < r->enemy && i < TRACE_MAX_ENEMY; i++)
+        sstm << "(" << r->enemyLocation[2*i] << "," << r->enemyLocation[2*i+1] << ") ";
+
+    sstm << ") score(" << r->score << ")" << endl;
+    sstm << "  scanned " << r->scanned << " cases in " << r->elapsedNs / 1000.0 << " us" << endl;
+
+    for(int i=0; i < r->k; i++){
+        const TraceEntry &e = r->top[i];
+
+        sstm << "  #" << i << " Case " << e.robotID << "." << e.ID << " Distance " << e.distance << " =";
+        for(unsigned f=0; f < featureNames.size() && f < TRACE_MAX_FEATURES; f++)
+            sstm << (f ? " + " : " ") << featureNames[f] << " " << e.contribution[f];
+        sstm << "  Solution: x(" << e.xTouch << ") y(" << e.yTouch << ")" << endl;
+    }
+
+    return sstm.str();
+}
+
+void RetrievalTrace::Dump(){
+
+    for(unsigned i=0; i < Size(); i++)
+        LOG::write_log(Format(Get(i)));
+}
+
+void RetrievalTrace::DumpLast(){
+
+    if(Size() > 0)
+        LOG::write_log(Format(Get(Size()-1)));
+}
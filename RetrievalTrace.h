@@ -0,0 +1,84 @@
+/*
+ * RetrievalTrace.h
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Declarations for structured tracing of case retrieval.
+ * Last modified: 2026. 10. 18.
+ */
+
+/*
+ * A TraceRecord describes one Retrieve() call: the given problem, the number of cases scanned,
+ *  the time spent, and the nearest TRACE_TOP_K cases with the weighted contribution of every
+ *  feature to their distance. Records are written into a ring buffer allocated once by
+ *  CBRLfD::EnableTrace(). While tracing is disabled, Retrieve() pays a single branch.
+ *  The buffer is dumped on demand (Dump(), DumpLast()), away from the retrieval path.
+ */
+
+#ifndef _RETRIEVALTRACE_MODULE_H_
+#define _RETRIEVALTRACE_MODULE_H_
+
+#include <vector>
+#include <string>
+
+#define TRACE_TOP_K         4       // nearest cases recorded per retrieval (cases used by Reuse())
+#define TRACE_MAX_FEATURES  8       // max case features recorded per case
+#define TRACE_MAX_ENEMY     8       // max enemy locations recorded per problem
+#define TRACE_CAPACITY      64      // default number of records kept
+
+//----------------------------------------------------------------------
+//  TraceEntry: one of the nearest cases of a retrieval.
+//----------------------------------------------------------------------
+struct TraceEntry{
+    int robotID;
+    int ID;
+    float distance;
+    float contribution[TRACE_MAX_FEATURES];     //weight * feature distance. Sums to distance.
+    int xTouch;
+    int yTouch;
+};
+
+//----------------------------------------------------------------------
+//  TraceRecord: one retrieval.
+//----------------------------------------------------------------------
+struct TraceRecord{
+    unsigned long seq;              //retrieval sequence number
+    int level;                      //given problem
+    int round;
+    int enemy;
+    int score;
+    float enemyLocation[2*TRACE_MAX_ENEMY];
+    unsigned scanned;               //number of cases scanned
+    long long elapsedNs;            //time spent in Retrieve()
+    int k;                          //number of valid entries in top
+    TraceEntry top[TRACE_TOP_K];
+};
+
+//----------------------------------------------------------------------
+//  RetrievalTrace
+//      Preallocated ring buffer of TraceRecords. Not thread-safe: written and dumped by the
+//      thread owning the CBRLfD instance.
+//----------------------------------------------------------------------
+class RetrievalTrace{
+
+public:
+    RetrievalTrace(unsigned capacity, const std::vector< std::string > &features);
+    ~RetrievalTrace();
+
+    TraceRecord* Next();                    //Slot for the next record. Valid until Commit().
+    void Commit();                          //Publish the record returned by Next().
+
+    unsigned Size();                        //Number of records held (at most capacity).
+    const TraceRecord* Get(unsigned i);     //i-th oldest record held.
+
+    std::string Format(const TraceRecord *r);   //Human-readable form of a record.
+    void Dump();                            //Write all held records to the log, oldest first.
+    void DumpLast();                        //Write the newest record to the log.
+    void Clear();
+
+private:
+    std::vector< TraceRecord > ring;
+    std::vector< std::string > featureNames;
+    unsigned long nSeq;                     //number of committed records
+};
+
+#endif
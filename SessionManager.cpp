@@ -0,0 +1,695 @@
+/*
+ * SessionManager.cpp
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Implementation of the multi-session game server.
+ * Last modified: 2026. 10. 18.
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include <iostream>
+
+#include "SessionManager.h"
+#include "LogIngest.h"
+
+using std::cout;
+using std::endl;
+
+enum SESSION_TIMERS { TIMER_HOLD, TIMER_SETTLE, TIMER_REPORT, TIMER_SWEEP };
+
+//Build problem description from a task-status packet (AngryDarwin::buildProblem())
+static Problem* BuildProblem(const TabletPacket &packet){
+
+    Problem *p = new Problem();
+
+    p->level = packet.level;
+    p->round = 5 - packet.lives;
+    p->enemy = packet.enemy;
+    p->enemyLocation.assign(packet.enemyLocation, packet.enemyLocation + 2*packet.enemy);
+    p->score = packet.score;
+
+    return p;
+}
+
+//Build solution from a touch-event packet (AngryDarwin::buildSolution())
+static Solution* BuildSolution(const TabletPacket &packet){
+
+    Solution *s = new Solution();
+
+    s->xTouch = packet.touch[0];
+    s->yTouch = packet.touch[1];
+
+    return s;
+}
+
+//Delete a case that did not make it into a case base
+static void DeleteCase(Case *c){
+
+    if(!c)
+        return;
+
+    delete c->mProblem;
+    delete c->mSolution;
+    delete c;
+}
+
+//----------------------------------------------------------------------
+//  SessionCaseBase
+//----------------------------------------------------------------------
+SessionCaseBase::SessionCaseBase(int robotID) : mCBR(robotID){
+
+    pthread_rwlock_init(&lock, NULL);
+}
+
+SessionCaseBase::~SessionCaseBase(){
+
+    pthread_rwlock_destroy(&lock);
+}
+
+int SessionCaseBase::Load(const vector< string > &logs){
+
+    LogIngest ingest;
+
+    pthread_rwlock_wrlock(&lock);
+    int stored = ingest.Ingest(logs, &mCBR);
+    pthread_rwlock_unlock(&lock);
+
+    return stored;
+}
+
+Solution* SessionCaseBase::Decide(Problem *p){
+
+    vector< float > distances;
+    Solution *sol = NULL;
+
+    pthread_rwlock_rdlock(&lock);
+
+    //Reuse() never looks past the nearest 4 cases
+    caseVector result = mCBR.RetrieveNearest(p, 4, distances);
+    if(result.size() > 0)
+        sol = mCBR.Reuse(result);
+
+    pthread_rwlock_unlock(&lock);
+
+    return sol;
+}
+
+bool SessionCaseBase::Retain(Case *c){
+
+    pthread_rwlock_wrlock(&lock);
+
+    unsigned size = mCBR.casebase.size();
+
+    //REVISE: the case gets the next ID of this case base
+    c->ID = mCBR.nIDGenerator;
+    c->robotID = mCBR.nRobotID;
+    c->epoch = mCBR.nEpoch;
+    delete mCBR.Revise(c->mProblem, c->mSolution);     //only the ID is kept
+
+    //RETAIN
+    mCBR.Retain(c);
+    bool bStored = mCBR.casebase.size() > size;
+
+    pthread_rwlock_unlock(&lock);
+
+    return bStored;
+}
+
+unsigned SessionCaseBase::Size(){
+
+    pthread_rwlock_rdlock(&lock);
+    unsigned size = mCBR.casebase.size();
+    pthread_rwlock_unlock(&lock);
+
+    return size;
+}
+
+//----------------------------------------------------------------------
+//  GameSession
+//----------------------------------------------------------------------
+GameSession::GameSession(SessionManager *manager, const struct sockaddr_in &from, SessionCaseBase *cases, bool bOwn)
+    : mSettle(manager->Scaled(ROUND_SETTLE_MS), manager->Scaled(ROUND_SETTLE_MAX_MS), &manager->settleStats),
+      holdTimer(this, TIMER_HOLD), settleTimer(this, TIMER_SETTLE){
+
+    mManager = manager;
+    mCases = cases;
+    bOwnCases = bOwn;
+    addr = from;
+    lastPacketMs = EventLoop::NowMs();
+    bOffered = false;
+
+    state = SESSION_READY;
+    generation = 0;
+    bDeciding = false;
+    bRoundOver = false;
+    curCase = NULL;
+    xCoord = yCoord = 0;
+}
+
+GameSession::~GameSession(){
+
+    mManager->Timers()->Cancel(&holdTimer);
+    mManager->Timers()->Cancel(&settleTimer);
+
+    DeleteCase(curCase);
+
+    if(bOwnCases)
+        delete mCases;
+}
+
+void GameSession::OnPacket(ReceivedPacket &r){
+
+    lastPacketMs = r.stamp / 1000;
+
+    //Offer the binary protocol once, on the first packet of the tablet
+    if(mManager->BinaryOffered() && !bOffered){
+        char offer[PACKET_SIZE];
+        mManager->SendTo(addr, offer, mProtocol.Offer(offer));
+        bOffered = true;
+    }
+
+    if(!mProtocol.Receive(r.text, r.size, &packet))
+        return;
+
+    switch(state){
+
+        case SESSION_READY:
+        case SESSION_GAME_END:{
+
+            if(packet.kind == PACKET_USERTOUCH){
+                if(state == SESSION_READY)
+                    Demonstrate();
+            }
+            else if(packet.round == ROUND_NEW){
+
+                mSettle.NextRound(r.stamp);
+
+                //Hand the problem to the worker pool. OnDecision() moves on to SESSION_AIM.
+                generation++;
+                bDeciding = true;
+                state = SESSION_DECIDING;
+                mManager->Submit(this, generation, BuildProblem(packet), r.stamp);
+            }
+            else if(state == SESSION_READY && !bRoundOver && ((packet.round == ROUND_END) || (packet.round == ROUND_TRANS_CALL)))
+                state = SESSION_ROUND_END;
+            else if(packet.round == ROUND_END_GAME)
+                state = SESSION_GAME_END;
+            break;
+        }
+        case SESSION_DECIDING:
+        case SESSION_AIM:{
+
+            if(packet.kind == PACKET_USERTOUCH)
+                Demonstrate();
+            break;
+        }
+        case SESSION_SHOOT:{
+
+            if(packet.kind == PACKET_USERTOUCH)
+                Demonstrate();
+            else if(packet.round == ROUND_AIMING_SHOT){
+                Send(CMD_RELEASE, xCoord, yCoord);
+                state = SESSION_ROUND_END;
+            }
+            else if(packet.round == ROUND_END)
+                state = SESSION_ROUND_END;
+            break;
+        }
+        case SESSION_ROUND_END:{
+
+            if(packet.kind == PACKET_STATE){
+
+                //Delay until the score stays the same for the settle window or the max wait passes, as the robot does
+                if(packet.round == ROUND_END){
+                    mManager->Timers()->Arm(&settleTimer, mSettle.Update(packet.score, r.stamp));
+                    settlePacket = packet;
+                }
+                else if(mSettle.IsSettling() || (packet.round == ROUND_END_GAME))
+                    FinishRound(packet, SETTLE_STATUS);
+            }
+            else if(mSettle.IsSettling())
+                FinishRound(settlePacket, SETTLE_TOUCH);
+            break;
+        }
+    }
+
+    if(packet.kind == PACKET_STATE){
+        if((packet.round != ROUND_END) && (packet.round != ROUND_TRANS_CALL))
+            bRoundOver = false;
+        prevStatePacket = packet;
+    }
+}
+
+//A usertouch at the sling: record the user's shot as the case of this round
+void GameSession::Demonstrate(){
+
+    int x = packet.touch[2];
+    int y = packet.touch[3];
+
+    if((x > xHighLimit) || (x < xLowLimit) || (y > yHighLimit) || (y < yLowLimit))
+        return;
+
+    DeleteCase(curCase);
+    curCase = new Case(BuildProblem(prevStatePacket), BuildSolution(packet), 0);
+
+    generation++;       //a pending decision is of no use any more
+    mManager->Timers()->Cancel(&holdTimer);
+    mManager->nDemonstrations++;
+
+    state = SESSION_ROUND_END;
+}
+
+//Decision of the worker pool, on the event loop thread
+void GameSession::OnDecision(SessionJob *job){
+
+    bDeciding = false;
+
+    if(job->generation != generation || state != SESSION_DECIDING){
+        delete job->problem;
+        delete job->solution;
+        return;
+    }
+
+    bool bSelfTrain = (job->solution == NULL);
+
+    if(bSelfTrain){
+        //No case retrieved: self training
+        Solution *sol = new Solution();
+        sol->xTouch = xCoord = rand() % 200;
+        sol->yTouch = yCoord = rand() % 200 + 95;
+
+        DeleteCase(curCase);
+        curCase = new Case(job->problem, sol, 0);
+    }
+    else{
+        xCoord = job->solution->xTouch;
+        yCoord = job->solution->yTouch;
+        delete job->problem;
+        delete job->solution;
+    }
+
+    Send(CMD_TOUCH, xCoord, yCoord);
+    mManager->RecordDecision(job->stamp, bSelfTrain);
+
+    mManager->Timers()->Arm(&holdTimer, mManager->Scaled(AIM_HOLD_MS));
+    state = SESSION_AIM;
+}
+
+void GameSession::OnTimer(Timer *timer){
+
+    if(timer == &holdTimer && state == SESSION_AIM)
+        state = SESSION_SHOOT;
+    else if(timer == &settleTimer){
+
+        //The deadline is only missed by timer granularity
+        long long now = EventLoop::NowUs();
+        int reason = mSettle.SettledBy(now);
+
+        if(reason != SETTLE_NONE)
+            FinishRound(settlePacket, reason);
+        else if(mSettle.IsSettling())
+            mManager->Timers()->Arm(&settleTimer, mSettle.Update(settlePacket.score, now));
+    }
+}
+
+//Round is over: revise and retain the recorded case, and proceed to the next round.
+void GameSession::FinishRound(const TabletPacket &p, int reason){
+
+    mSettle.Finish(reason, EventLoop::NowUs());
+    bRoundOver = true;
+    mManager->Timers()->Cancel(&settleTimer);
+    mManager->nRounds++;
+
+    if(curCase){
+        curCase->mProblem->score = p.score - curCase->mProblem->score;
+
+        if(mCases->Retain(curCase))
+            mManager->nRetained++;
+        else
+            DeleteCase(curCase);
+        curCase = NULL;
+    }
+
+    if(p.enemy == 0 || p.lives == 0)
+        state = SESSION_GAME_END;
+    else
+        state = SESSION_READY;
+
+    Send(CMD_FULLTOUCH, 400, 100);
+}
+
+void GameSession::Send(int cmd, int x, int y){
+
+    char buf[PACKET_SIZE];
+    int size = mProtocol.EncodeCommand(cmd, x, y, buf);
+
+    mManager->SendTo(addr, buf, size);
+}
+
+//----------------------------------------------------------------------
+//  SessionManager
+//----------------------------------------------------------------------
+SessionManager::SessionManager(int robotID) : reportTimer(this, TIMER_REPORT), sweepTimer(this, TIMER_SWEEP){
+
+    sockfd = -1;
+    notifyfd = -1;
+    mTimers = NULL;
+    mShared = NULL;
+
+    nWorkers = SESSION_WORKERS;
+    bSharedCases = true;
+    bBinary = false;
+    mSpeed = 1.0;
+    nMaxSessions = SESSION_MAX;
+    nLatencyBoundMs = SESSION_LATENCY_MS;
+    nRobotID = robotID;
+    bStop = false;
+    bRunning = false;
+
+    pthread_mutex_init(&jobLock, NULL);
+    pthread_cond_init(&jobReady, NULL);
+    pthread_mutex_init(&doneLock, NULL);
+
+    nRounds = nDemonstrations = nRetained = 0;
+    nDecisions = nSelfTrain = nOverBound = 0;
+    latencyMaxUs = 0;
+    reportMs = 0;
+    nOpened = nClosed = nRejected = nTotalDecisions = 0;
+}
+
+SessionManager::~SessionManager(){
+
+    //Stop the workers before the sessions and case bases they use go away
+    if(bRunning){
+        pthread_mutex_lock(&jobLock);
+        bRunning = false;
+        pthread_cond_broadcast(&jobReady);
+        pthread_mutex_unlock(&jobLock);
+
+        for(unsigned i=0; i<workers.size(); i++)
+            pthread_join(workers[i], NULL);
+    }
+
+    while(!jobs.empty()){
+        delete jobs.front()->problem;
+        delete jobs.front();
+        jobs.pop_front();
+    }
+    while(!done.empty()){
+        delete done.front()->problem;
+        delete done.front()->solution;
+        delete done.front();
+        done.pop_front();
+    }
+
+    for(std::map< unsigned long long, GameSession* >::iterator it = sessions.begin(); it != sessions.end(); it++)
+        delete it->second;
+
+    if(mTimers){
+        mTimers->Cancel(&reportTimer);
+        mTimers->Cancel(&sweepTimer);
+        delete mTimers;
+    }
+
+    if(mShared)
+        delete mShared;
+
+    if(sockfd >= 0)
+        close(sockfd);
+    if(notifyfd >= 0)
+        close(notifyfd);
+
+    pthread_mutex_destroy(&jobLock);
+    pthread_cond_destroy(&jobReady);
+    pthread_mutex_destroy(&doneLock);
+}
+
+bool SessionManager::Start(int port){
+
+    struct sockaddr_in addr;
+
+    sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+
+    bzero(&addr, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+
+    if(bind(sockfd, (struct sockaddr *)&addr, sizeof(addr)) < 0){
+        cout << "Fail to bind session port " << port << endl;
+        close(sockfd);
+        sockfd = -1;
+        return false;
+    }
+
+    //Queue bursts of many tablets in the socket rather than dropping them
+    int rcvbuf = 4 * 1024 * 1024;
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    if(bSharedCases){
+        mShared = new SessionCaseBase(nRobotID);
+        if(mLogs.size() > 0)
+            cout << "Loaded " << mShared->Load(mLogs) << " cases into the shared case base" << endl;
+    }
+
+    notifyfd = EventLoop::CreateNotifier();
+    mTimers = new TimerWheel(EventLoop::NowMs());
+
+    if(!mLoop.Add(sockfd, this) || !mLoop.Add(notifyfd, this))
+        return false;
+
+    bRunning = true;
+    for(int i=0; i<nWorkers; i++){
+        pthread_t t;
+        if(pthread_create(&t, NULL, Worker_thread, this) == 0)
+            workers.push_back(t);
+    }
+
+    return true;
+}
+
+void SessionManager::Run(int seconds){
+
+    reportMs = EventLoop::NowMs();
+    mTimers->Arm(&reportTimer, SESSION_REPORT_MS, SESSION_REPORT_MS);
+    mTimers->Arm(&sweepTimer, SESSION_IDLE_MS / 2, SESSION_IDLE_MS / 2);
+
+    long long endMs = seconds > 0 ? EventLoop::NowMs() + seconds * 1000LL : 0;
+
+    while(!bStop && (endMs == 0 || EventLoop::NowMs() < endMs)){
+
+        //Wait for packets and decisions until the next timer is due
+        long long next = mTimers->NextDeadline();
+        long long wait = next ? next - EventLoop::NowMs() : 1000;
+        if(wait < 0)
+            wait = 0;
+
+        if(mLoop.Poll((int) wait) < 0)
+            break;
+        mTimers->Advance(EventLoop::NowMs());
+    }
+}
+
+void SessionManager::OnEvent(int fd){
+
+    //Fire due timers first, so that timers armed by the sessions count from now
+    mTimers->Advance(EventLoop::NowMs());
+
+    if(fd == sockfd)
+        HandlePackets();
+    else if(fd == notifyfd)
+        HandleDecisions();
+}
+
+void SessionManager::OnTimer(Timer *timer){
+
+    if(timer == &reportTimer)
+        Report();
+    else if(timer == &sweepTimer)
+        CloseIdleSessions();
+}
+
+//Drain the socket and dispatch every datagram to the session of its source
+void SessionManager::HandlePackets(){
+
+    int n;
+
+    do{
+        n = mBatch.Receive(sockfd, NULL);
+
+        for(int i=0; i<n; i++){
+            ReceivedPacket &r = mBatch.Get(i);
+
+            GameSession *session = FindSession(r.from);
+            if(session)
+                session->OnPacket(r);
+        }
+    } while(n == PACKET_BATCH);
+}
+
+void SessionManager::HandleDecisions(){
+
+    EventLoop::Drain(notifyfd);
+
+    std::deque< SessionJob* > decided;
+
+    pthread_mutex_lock(&doneLock);
+    decided.swap(done);
+    pthread_mutex_unlock(&doneLock);
+
+    for(unsigned i=0; i<decided.size(); i++){
+        decided[i]->session->OnDecision(decided[i]);
+        delete decided[i];
+    }
+}
+
+GameSession* SessionManager::FindSession(const struct sockaddr_in &from){
+
+    unsigned long long key = ((unsigned long long) ntohl(from.sin_addr.s_addr) << 16) | ntohs(from.sin_port);
+
+    std::map< unsigned long long, GameSession* >::iterator it = sessions.find(key);
+    if(it != sessions.end())
+        return it->second;
+
+    if(sessions.size() >= nMaxSessions){
+        nRejected++;
+        return NULL;
+    }
+
+    SessionCaseBase *cases = mShared;
+    if(!cases){
+        cases = new SessionCaseBase(nRobotID);
+        if(mLogs.size() > 0)
+            cases->Load(mLogs);
+    }
+
+    GameSession *session = new GameSession(this, from, cases, !mShared);
+    sessions[key] = session;
+    nOpened++;
+
+    return session;
+}
+
+//Close sessions whose tablet went silent. A session waiting for a decision is kept until it arrives.
+void SessionManager::CloseIdleSessions(){
+
+    long long now = EventLoop::NowMs();
+
+    std::map< unsigned long long, GameSession* >::iterator it = sessions.begin();
+    while(it != sessions.end()){
+        if(!it->second->IsDeciding() && now - it->second->lastPacketMs > SESSION_IDLE_MS){
+            delete it->second;
+            sessions.erase(it++);
+            nClosed++;
+        }
+        else
+            it++;
+    }
+}
+
+void SessionManager::Submit(GameSession *session, unsigned generation, Problem *problem, long long stamp){
+
+    SessionJob *job = new SessionJob();
+    job->session = session;
+    job->generation = generation;
+    job->problem = problem;
+    job->solution = NULL;
+    job->stamp = stamp;
+
+    pthread_mutex_lock(&jobLock);
+    jobs.push_back(job);
+    pthread_cond_signal(&jobReady);
+    pthread_mutex_unlock(&jobLock);
+}
+
+void SessionManager::SendTo(const struct sockaddr_in &addr, const char *buf, int size){
+
+    sendto(sockfd, buf, size, 0, (const struct sockaddr *)&addr, sizeof(addr));
+}
+
+void SessionManager::RecordDecision(long long stamp, bool bSelfTrain){
+
+    long long latency = EventLoop::NowUs() - stamp;
+
+    nDecisions++;
+    nTotalDecisions++;
+    if(bSelfTrain)
+        nSelfTrain++;
+    if(latency > nLatencyBoundMs * 1000LL)
+        nOverBound++;
+    if(latency > latencyMaxUs)
+        latencyMaxUs = latency;
+    if(latencies.size() < SESSION_SAMPLES)
+        latencies.push_back(latency);
+}
+
+//Print the sessions, decision rate and decision latency percentiles since the last report
+void SessionManager::Report(){
+
+    long long now = EventLoop::NowMs();
+    double seconds = (now - reportMs) / 1000.0;
+    double p50 = 0, p99 = 0;
+
+    if(latencies.size() > 0){
+        unsigned i50 = latencies.size() / 2, i99 = latencies.size() * 99 / 100;
+        std::nth_element(latencies.begin(), latencies.begin() + i50, latencies.end());
+        p50 = latencies[i50] / 1000.0;
+        std::nth_element(latencies.begin(), latencies.begin() + i99, latencies.end());
+        p99 = latencies[i99] / 1000.0;
+    }
+
+    unsigned cases = 0;
+    if(mShared)
+        cases = mShared->Size();
+    else
+        for(std::map< unsigned long long, GameSession* >::iterator it = sessions.begin(); it != sessions.end(); it++)
+            cases += it->second->GetCases()->Size();
+
+    printf("%u sessions (%lu opened, %lu closed, %lu rejected), %lu decisions (%.0f/s, %lu self-training), latency p50 %.2f p99 %.2f max %.2f ms, %lu over %d ms, %lu rounds, %lu demonstrations, %lu retained, %u cases\n",
+           (unsigned) sessions.size(), nOpened, nClosed, nRejected, nDecisions, seconds > 0 ? nDecisions / seconds : 0.0, nSelfTrain,
+           p50, p99, latencyMaxUs / 1000.0, nOverBound, nLatencyBoundMs, nRounds, nDemonstrations, nRetained, cases);
+    fflush(stdout);
+    settleStats.Print();
+
+    latencies.clear();
+    nDecisions = nSelfTrain = nOverBound = 0;
+    latencyMaxUs = 0;
+    reportMs = now;
+}
+
+//Worker thread: retrieve and reuse for the submitted problems
+void *SessionManager::Worker_thread(void *ptr){
+
+    SessionManager *pMgr = (SessionManager*) ptr;
+
+    while(1){
+
+        pthread_mutex_lock(&pMgr->jobLock);
+        while(pMgr->bRunning && pMgr->jobs.empty())
+            pthread_cond_wait(&pMgr->jobReady, &pMgr->jobLock);
+
+        if(!pMgr->bRunning){
+            pthread_mutex_unlock(&pMgr->jobLock);
+            break;
+        }
+
+        SessionJob *job = pMgr->jobs.front();
+        pMgr->jobs.pop_front();
+        pthread_mutex_unlock(&pMgr->jobLock);
+
+        job->solution = job->session->GetCases()->Decide(job->problem);
+
+        pthread_mutex_lock(&pMgr->doneLock);
+        pMgr->done.push_back(job);
+        pthread_mutex_unlock(&pMgr->doneLock);
+
+        EventLoop::Notify(pMgr->notifyfd);
+    }
+
+    return NULL;
+}
@@ -0,0 +1,222 @@
+/*
+ * SessionManager.h
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Declarations of the multi-session game server: one decision state machine per tablet.
+ * Last modified: 2026. 10. 18.
+ */
+
+/*
+ * SessionManager serves many tablets from one UDP socket. Every source address gets its own
+ * GameSession, a headless copy of the Angry Darwin round state machine (no robot body: the
+ * aiming and shooting motions are replaced by their hold times):
+ *
+ *      READY       state_new_round: the problem is handed to the worker pool        -> DECIDING
+ *      DECIDING    retrieved and reused solution (or a self-training shot): "touch"  -> AIM
+ *      AIM         AIM_HOLD_MS later                                                 -> SHOOT
+ *      SHOOT       state_aiming_shot: "release"                                      -> ROUND_END
+ *      ROUND_END   score settled (SettleDetector): revise, retain, "fulltouch"       -> READY / GAME_END
+ *
+ * A usertouch at the sling during READY, DECIDING, AIM or SHOOT records a demonstration, as on the robot.
+ *
+ *  - All sessions share one EventLoop and TimerWheel on the thread calling Run().
+ *  - Retrieve and Reuse run on a pool of worker threads; results come back through a notifier.
+ *  - The case base is either shared by all sessions (readers retrieve concurrently under a
+ *    read lock, Retain takes the write lock) or private to every session.
+ *  - Decision latency is measured from the receipt of the state_new_round packet to the
+ *    sending of "touch", and reported every SESSION_REPORT_MS against a latency bound.
+ */
+
+#ifndef _SESSIONMANAGER_MODULE_H_
+#define _SESSIONMANAGER_MODULE_H_
+
+#include <pthread.h>
+#include <netinet/in.h>
+#include <deque>
+#include <map>
+#include <vector>
+#include <string>
+
+#include "CBRLfD_Simple.h"
+#include "EventLoop.h"
+#include "TimerWheel.h"
+#include "TabletPacket.h"
+#include "TabletProtocol.h"
+#include "PacketBatch.h"
+#include "GameConstants.h"
+#include "SettleDetector.h"
+
+#define SESSION_PORT            12345   // FROM_TABLET_PORT of the robot
+#define SESSION_WORKERS         4       // worker threads for retrieval and reuse
+#define SESSION_MAX             4096    // sessions open at once; packets of further tablets are dropped
+#define SESSION_IDLE_MS         30000   // a session without packets for this long is closed
+#define SESSION_REPORT_MS       5000
+#define SESSION_LATENCY_MS      20      // decision latency bound
+#define SESSION_SAMPLES         65536   // latency samples kept per report
+
+class GameSession;
+class SessionManager;
+
+//----------------------------------------------------------------------
+//  SessionCaseBase
+//      CBRLfD case base guarded by a reader-writer lock.
+//----------------------------------------------------------------------
+class SessionCaseBase{
+
+public:
+    SessionCaseBase(int robotID);
+    ~SessionCaseBase();
+
+    int Load(const vector< string > &logs);     //Ingest demonstration logs. Returns the number of cases stored.
+
+    // Retrieve the nearest cases and reuse their solutions (read lock). NULL if the case base is empty.
+    Solution* Decide(Problem *p);
+
+    // Revise and retain c (write lock). Returns false if c was not stored; it stays the caller's then.
+    bool Retain(Case *c);
+
+    unsigned Size();
+
+private:
+    CBRLfD mCBR;
+    pthread_rwlock_t lock;
+};
+
+//One decision handed to the worker pool
+struct SessionJob{
+    GameSession *session;
+    unsigned generation;        //session generation at submission; stale results are dropped
+    Problem *problem;
+    Solution *solution;         //set by the worker, NULL if no case was retrieved
+    long long stamp;            //receipt (usec) of the packet that asked for the decision
+};
+
+//----------------------------------------------------------------------
+//  GameSession
+//      Round state machine of one tablet. Runs on the event loop thread.
+//----------------------------------------------------------------------
+class GameSession : public TimerHandler{
+
+public:
+    GameSession(SessionManager *manager, const struct sockaddr_in &addr, SessionCaseBase *cases, bool bOwnCases);
+    ~GameSession();
+
+    void OnPacket(ReceivedPacket &r);
+    void OnDecision(SessionJob *job);
+    virtual void OnTimer(Timer *timer);
+
+    bool IsDeciding(){ return bDeciding; }
+    SessionCaseBase* GetCases(){ return mCases; }
+
+    struct sockaddr_in addr;
+    long long lastPacketMs;
+
+private:
+    enum SESSION_STATES { SESSION_READY, SESSION_DECIDING, SESSION_AIM, SESSION_SHOOT, SESSION_ROUND_END, SESSION_GAME_END };
+
+    SessionManager *mManager;
+    SessionCaseBase *mCases;
+    bool bOwnCases;
+    TabletProtocol mProtocol;
+    bool bOffered;
+
+    int state;
+    unsigned generation;
+    bool bDeciding;             //a job of this session is in the worker pool
+    TabletPacket packet, prevStatePacket, settlePacket;
+    SettleDetector mSettle;
+    bool bRoundOver;            //round finished: its late end-of-round packets are ignored
+    Case *curCase;              //demonstration or self-training shot of this round
+    int xCoord, yCoord;
+    Timer holdTimer, settleTimer;
+
+    void Demonstrate();
+    void FinishRound(const TabletPacket &p, int reason);
+    void Send(int cmd, int x, int y);
+};
+
+//----------------------------------------------------------------------
+//  SessionManager
+//----------------------------------------------------------------------
+class SessionManager : public EventHandler, public TimerHandler{
+
+public:
+    SessionManager(int robotID = 1);
+    ~SessionManager();
+
+    // Options, set before Start()
+    void SetWorkers(int n){ nWorkers = n; }
+    void SetSharedCases(bool bShared){ bSharedCases = bShared; }
+    void SetLogs(const vector< string > &logs){ mLogs = logs; }
+    void SetSpeed(double speed){ mSpeed = speed; }          //divides the hold and settle times
+    void SetMaxSessions(unsigned n){ nMaxSessions = n; }
+    void SetLatencyBound(int ms){ nLatencyBoundMs = ms; }
+    void EnableBinaryProtocol(){ bBinary = true; }
+
+    bool Start(int port);           //Bind port and start the workers.
+    void Run(int seconds);          //Serve for seconds (0: until Stop()).
+    void Stop(){ bStop = true; }
+    void Report();
+
+    virtual void OnEvent(int fd);
+    virtual void OnTimer(Timer *timer);
+
+    // Used by the sessions
+    TimerWheel* Timers(){ return mTimers; }
+    unsigned Scaled(unsigned ms){ return (unsigned) (ms / mSpeed) + 1; }
+    bool BinaryOffered(){ return bBinary; }
+    void Submit(GameSession *session, unsigned generation, Problem *problem, long long stamp);
+    void SendTo(const struct sockaddr_in &addr, const char *buf, int size);
+    void RecordDecision(long long stamp, bool bSelfTrain);
+
+    unsigned long nRounds;
+    unsigned long nDemonstrations;
+    unsigned long nRetained;
+    SettleStats settleStats;            //of all sessions
+
+private:
+    int sockfd;
+    int notifyfd;                       //worker pool -> event loop
+    EventLoop mLoop;
+    TimerWheel *mTimers;
+    Timer reportTimer, sweepTimer;
+    PacketBatch mBatch;
+
+    std::map< unsigned long long, GameSession* > sessions;     //by source (address << 16 | port)
+    SessionCaseBase *mShared;
+    vector< string > mLogs;
+
+    int nWorkers;
+    bool bSharedCases;
+    bool bBinary;
+    double mSpeed;
+    unsigned nMaxSessions;
+    int nLatencyBoundMs;
+    int nRobotID;
+    volatile bool bStop;
+
+    // Worker pool
+    vector< pthread_t > workers;
+    volatile bool bRunning;
+    pthread_mutex_t jobLock;
+    pthread_cond_t jobReady;
+    std::deque< SessionJob* > jobs;     //submitted, guarded by jobLock
+    pthread_mutex_t doneLock;
+    std::deque< SessionJob* > done;     //decided, guarded by doneLock
+
+    // Statistics since the last report
+    vector< long long > latencies;
+    unsigned long nDecisions, nSelfTrain, nOverBound;
+    long long latencyMaxUs;
+    long long reportMs;
+    unsigned long nOpened, nClosed, nRejected, nTotalDecisions;
+
+    static void *Worker_thread(void *ptr);
+
+    void HandlePackets();
+    void HandleDecisions();
+    GameSession* FindSession(const struct sockaddr_in &from);
+    void CloseIdleSessions();
+};
+
+#endif
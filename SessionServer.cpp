@@ -0,0 +1,103 @@
+/*
+ * SessionServer.cpp
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Multi-session game server: serves many tablets at once with one decision
+ *  state machine per tablet (SessionManager), without robot hardware.
+ *
+ *      ./SessionServer [-p port] [-j workers] [-i] [-l log_file ...] [-x speed] [-n max_sessions]
+ *                      [-L latency_bound_ms] [-b] [-d seconds] [-r robot_id]
+ *
+ *  -i gives every session its own case base instead of one shared by all sessions.
+ *  -x divides the aiming hold and settle times, to match TabletSimulator -x.
+ *  Capacity run with simulated tablets:
+ *
+ *      ./SessionServer -l log_file.txt -x 20 -d 30 &
+ *      ./TabletSimulator -g 500 -x 20 -d 30
+ *
+ *  Prints sessions, decisions per second and decision latency percentiles every 5 seconds.
+ * Last modified: 2026. 10. 18.
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <signal.h>
+
+#include "SessionManager.h"
+
+using std::string;
+using std::vector;
+
+static SessionManager *pManager = NULL;
+
+static void StopSignal(int sig){
+    if(pManager)
+        pManager->Stop();
+}
+
+int main(int argc, char *argv[])
+{
+    int port = SESSION_PORT;
+    int workers = SESSION_WORKERS;
+    bool bShared = true;
+    vector< string > logs;
+    double speed = 1.0;
+    int maxSessions = SESSION_MAX;
+    int bound = SESSION_LATENCY_MS;
+    bool bBinary = false;
+    int seconds = 0;
+    int robotID = 1;
+    int opt;
+
+    while((opt = getopt(argc, argv, "p:j:il:x:n:L:bd:r:")) != -1){
+        switch(opt){
+            case 'p': port = atoi(optarg); break;
+            case 'j': workers = atoi(optarg); break;
+            case 'i': bShared = false; break;
+            case 'l': logs.push_back(optarg); break;
+            case 'x': speed = atof(optarg); break;
+            case 'n': maxSessions = atoi(optarg); break;
+            case 'L': bound = atoi(optarg); break;
+            case 'b': bBinary = true; break;
+            case 'd': seconds = atoi(optarg); break;
+            case 'r': robotID = atoi(optarg); break;
+            default:
+                printf("usage: %s [-p port] [-j workers] [-i] [-l log_file ...] [-x speed] [-n max_sessions] [-L latency_bound_ms] [-b] [-d seconds] [-r robot_id]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if(workers < 1 || speed <= 0 || maxSessions < 1){
+        printf("workers, speed and max sessions must be positive\n");
+        return 1;
+    }
+
+    srand(time(NULL));
+
+    SessionManager manager(robotID);
+    manager.SetWorkers(workers);
+    manager.SetSharedCases(bShared);
+    manager.SetLogs(logs);
+    manager.SetSpeed(speed);
+    manager.SetMaxSessions(maxSessions);
+    manager.SetLatencyBound(bound);
+    if(bBinary)
+        manager.EnableBinaryProtocol();
+
+    if(!manager.Start(port))
+        return 1;
+
+    pManager = &manager;
+    signal(SIGINT, StopSignal);
+
+    printf("Serving tablets on port %d with %d workers, %s case base, %gx speed\n", port, workers, bShared ? "shared" : "per-session", speed);
+
+    manager.Run(seconds);
+    manager.Report();
+
+    pManager = NULL;
+
+    return 0;
+}
@@ -0,0 +1,123 @@
+/*
+ * SettleDetector.cpp
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Implementation of the end-of-round settle detector.
+ * Last modified: 2026. 10. 18.
+ */
+
+#include <iostream>
+
+#include "SettleDetector.h"
+
+using std::cout;
+using std::endl;
+
+SettleStats::SettleStats(){
+
+    for(int i=0; i<SETTLE_REASON_COUNT; i++)
+        nRounds[i] = 0;
+}
+
+void SettleStats::RecordFinish(int reason, long long gapUs){
+
+    nRounds[reason]++;
+    settleGap.Record(gapUs);
+}
+
+void SettleStats::Print(){
+
+    if(settleGap.Count() == 0)
+        return;
+
+    cout << "Settled " << settleGap.Count() << " rounds:";
+    for(int i=SETTLE_WINDOW; i<SETTLE_REASON_COUNT; i++)
+        cout << " " << nRounds[i] << " by " << SettleDetector::ReasonName(i) << (i + 1 < SETTLE_REASON_COUNT ? "," : "");
+    cout << endl;
+
+    cout << "  physics settled to round finished p50 " << settleGap.Percentile(0.5) / 1000 << " ms max " << settleGap.Max() / 1000 << " ms"
+         << ", to next round p50 " << roundGap.Percentile(0.5) / 1000 << " ms max " << roundGap.Max() / 1000 << " ms" << endl;
+}
+
+SettleDetector::SettleDetector(unsigned windowMs, unsigned maxMs, SettleStats *stats){
+
+    Configure(windowMs, maxMs);
+
+    bSettling = bFinished = false;
+    score = 0;
+    firstUs = changedUs = settledUs = 0;
+
+    bOwnStats = (stats == NULL);
+    mStats = bOwnStats ? new SettleStats() : stats;
+}
+
+SettleDetector::~SettleDetector(){
+
+    if(bOwnStats)
+        delete mStats;
+}
+
+void SettleDetector::Configure(unsigned windowMs, unsigned maxMs){
+
+    windowUs = windowMs * 1000;
+    maxUs = (maxMs > windowMs ? maxMs : windowMs) * 1000;      //the deadline never cuts the window short
+}
+
+unsigned SettleDetector::Update(int newScore, long long nowUs){
+
+    if(!bSettling){
+        bSettling = true;
+        firstUs = changedUs = nowUs;
+        score = newScore;
+    }
+    else if(newScore != score){
+        changedUs = nowUs;
+        score = newScore;
+    }
+
+    long long deadline = changedUs + windowUs;
+    if(deadline > firstUs + maxUs)
+        deadline = firstUs + maxUs;
+
+    return deadline > nowUs ? (unsigned) ((deadline - nowUs + 999) / 1000) : 0;
+}
+
+int SettleDetector::SettledBy(long long nowUs){
+
+    if(!bSettling)
+        return SETTLE_NONE;
+    if(nowUs - changedUs >= windowUs)
+        return SETTLE_WINDOW;
+    if(nowUs - firstUs >= maxUs)
+        return SETTLE_DEADLINE;
+
+    return SETTLE_NONE;
+}
+
+void SettleDetector::Finish(int reason, long long nowUs){
+
+    if(!bSettling)
+        return;
+
+    bSettling = false;
+    bFinished = true;
+    settledUs = changedUs;
+
+    mStats->RecordFinish(reason, nowUs - settledUs);
+}
+
+void SettleDetector::NextRound(long long nowUs){
+
+    if(!bFinished)
+        return;
+
+    bFinished = false;
+    mStats->RecordNextRound(nowUs - settledUs);
+}
+
+const char* SettleDetector::ReasonName(int reason){
+
+    static const char *names[SETTLE_REASON_COUNT] = { "none", "window", "deadline", "status", "touch" };
+
+    return (reason >= 0 && reason < SETTLE_REASON_COUNT) ? names[reason] : "unknown";
+}
@@ -0,0 +1,109 @@
+/*
+ * SettleDetector.h
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Declarations of the end-of-round settle detector: score stability over a time window, with a max deadline.
+ * Last modified: 2026. 10. 18.
+ */
+
+/*
+ * After state_end_round the game physics go on for a while and the score keeps changing.
+ * The round is settled when the score reported by the end-of-round packets has not changed for
+ * the settle window, or at the latest the max wait after the first of them, whatever the rate
+ * the tablet sends them at:
+ *
+ *      Update(score, now)      end-of-round packet. Returns the delay to the settle deadline,
+ *                              for a timer of the caller to finish the round at.
+ *      SettledBy(now)          SETTLE_WINDOW or SETTLE_DEADLINE once settled, SETTLE_NONE before.
+ *      Finish(reason, now)     round finished (also early, by another status packet or a touch).
+ *      NextRound(now)          the next round opened.
+ *
+ * The physics are taken to have settled at the last score change. Two gaps are measured from it:
+ * to the round being finished (what the window costs) and to the next round opening. They are
+ * recorded in SettleStats, which detectors of many games (SessionManager) may share.
+ * The detector never blocks and owns no timer; all times are CLOCK_MONOTONIC usec.
+ */
+
+#ifndef _SETTLEDETECTOR_MODULE_H_
+#define _SETTLEDETECTOR_MODULE_H_
+
+#include "DecisionLatency.h"
+#include "GameConstants.h"
+
+//How a round was finished
+enum SETTLE_REASONS {
+    SETTLE_NONE,
+    SETTLE_WINDOW,          //score stable for the window
+    SETTLE_DEADLINE,        //max wait reached with the score still changing
+    SETTLE_STATUS,          //another task status came first (e.g. trans_new_round)
+    SETTLE_TOUCH,           //the user touched the tablet
+    SETTLE_REASON_COUNT
+};
+
+//----------------------------------------------------------------------
+//  SettleStats
+//      Finished rounds by reason and the gaps from the physics settling.
+//----------------------------------------------------------------------
+class SettleStats{
+
+public:
+    SettleStats();
+
+    void RecordFinish(int reason, long long gapUs);
+    void RecordNextRound(long long gapUs){ roundGap.Record(gapUs); }
+
+    void Print();
+
+private:
+    unsigned long nRounds[SETTLE_REASON_COUNT];
+    LatencyHistogram settleGap;     //physics settled to round finished (usec)
+    LatencyHistogram roundGap;      //physics settled to next round (usec)
+};
+
+//----------------------------------------------------------------------
+//  SettleDetector
+//----------------------------------------------------------------------
+class SettleDetector{
+
+public:
+    // Records into stats if given (not owned), into stats of its own otherwise.
+    SettleDetector(unsigned windowMs = ROUND_SETTLE_MS, unsigned maxMs = ROUND_SETTLE_MAX_MS, SettleStats *stats = NULL);
+    ~SettleDetector();
+
+    void Configure(unsigned windowMs, unsigned maxMs);
+
+    // End-of-round score at now. Returns the delay (msec) until the round is settled if no score changes.
+    unsigned Update(int score, long long nowUs);
+    int SettledBy(long long nowUs);
+    bool IsSettling(){ return bSettling; }
+
+    // The round is over: record the gap since the physics settled. Does nothing unless settling.
+    void Finish(int reason, long long nowUs);
+    // Record the gap from the physics settling to the next round, once per finished round.
+    void NextRound(long long nowUs);
+    // Forget the round in progress without recording it.
+    void Reset(){ bSettling = false; }
+
+    void PrintStats(){ mStats->Print(); }
+
+    static const char* ReasonName(int reason);
+
+private:
+    unsigned windowUs, maxUs;
+
+    bool bSettling;
+    int score;
+    long long firstUs;          //first end-of-round packet
+    long long changedUs;        //last score change: the physics settled here if nothing changes any more
+
+    bool bFinished;             //round finished, next round not yet opened
+    long long settledUs;        //changedUs of the finished round
+
+    SettleStats *mStats;
+    bool bOwnStats;
+
+    SettleDetector(const SettleDetector&);
+    SettleDetector& operator=(const SettleDetector&);
+};
+
+#endif
@@ -0,0 +1,67 @@
+/*
+ * SpscQueue.h
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Wait-free single-producer/single-consumer ring of fixed-size records.
+ * Last modified: 2026. 10. 18.
+ */
+
+/*
+ * One thread produces, one thread consumes, and the queue itself never blocks or locks. A producer
+ * finding no free record decides how to wait for one (PacketReceiver sleeps on an eventfd):
+ *
+ *  - The producer fills the record returned by Reserve() in place and makes it visible with Publish().
+ *  - The consumer reads records with Peek() (Peek(1) looks one record ahead) and frees them with Pop().
+ *
+ * Head and tail are free-running counters; SIZE must be a power of two.
+ */
+
+#ifndef _SPSCQUEUE_MODULE_H_
+#define _SPSCQUEUE_MODULE_H_
+
+//----------------------------------------------------------------------
+//  SpscQueue
+//----------------------------------------------------------------------
+template < class T, unsigned SIZE >
+class SpscQueue{
+
+public:
+    SpscQueue(){ head = tail = 0; }
+
+    // Producer: free record to fill, NULL if the queue is full.
+    T* Reserve(){
+        if(tail - head >= SIZE)
+            return 0;
+        return &ring[tail & (SIZE - 1)];
+    }
+
+    // Producer: make the reserved record visible to the consumer.
+    void Publish(){
+        __sync_synchronize();       //record contents before the tail
+        tail = tail + 1;
+    }
+
+    // Consumer: i-th queued record, NULL if fewer are queued.
+    T* Peek(unsigned i = 0){
+        if(tail - head <= i)
+            return 0;
+        __sync_synchronize();       //tail before the record contents
+        return &ring[(head + i) & (SIZE - 1)];
+    }
+
+    // Consumer: free the first queued record.
+    void Pop(){
+        __sync_synchronize();       //done with the record before the producer may reuse it
+        head = head + 1;
+    }
+
+    unsigned Size(){ return tail - head; }
+    unsigned Free(){ return SIZE - (tail - head); }
+
+private:
+    T ring[SIZE];
+    volatile unsigned head;         //written by the consumer only
+    volatile unsigned tail;         //written by the producer only
+};
+
+#endif
@@ -0,0 +1,190 @@
+/*
+ * StateCheck.cpp
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Hardware-free check of the Angry Darwin round state machine.
+ *
+ *  Compiles the transition rules of GameStates.h on a stub handler whose actions only record
+ *  their names, prints the resulting state x event table, and walks event sequences of a game
+ *  through it: the state reached and the actions run must be the ones of the robot's design.
+ *  Transitions made by actions and timers (FinishRound(), HandleMotionDone()) are not in the
+ *  table and are not walked.
+ *
+ *      ./StateCheck [-q]
+ *
+ *  Returns non-zero on a failure.
+ * Last modified: 2026. 10. 18.
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <string>
+
+#include "GameStates.h"
+
+using std::string;
+
+static unsigned nFailures = 0;
+
+#define CHECK(cond, what)   do{ if(!(cond)){ nFailures++; printf("FAIL %s: %s\n", what, #cond); } }while(0)
+
+static const char *stateNames[STATE_COUNT] = {
+    "ROUND_READY", "AIM", "SHOOT", "ROUND_END", "GAME_END", "DEMONSTRATION", "SELF_TRAIN", "IDLE"
+};
+
+static const char *eventNames[EVENT_COUNT] = {
+    "unknown", "trans_new", "new_round", "aiming", "in_play", "end_round", "trans_call", "end_game", "demo", "touch"
+};
+
+//----------------------------------------------------------------------
+//  StubGame
+//      Actions of AngryDarwin that only record their names, separated by spaces.
+//----------------------------------------------------------------------
+class StubGame{
+
+public:
+    string trace;
+
+    void EnterRoundReady()  { Run("EnterRoundReady"); }
+    void Demonstrate()      { Run("Demonstrate"); }
+    void OpenRound()        { Run("OpenRound"); }
+    void SuspendIdle()      { Run("SuspendIdle"); }
+    void ResumeIdle()       { Run("ResumeIdle"); }
+    void Decide()           { Run("Decide"); }
+    void Shoot()            { Run("Shoot"); }
+    void InterruptShot()    { Run("InterruptShot"); }
+    void DemonstrateInShot(){ Run("DemonstrateInShot"); }
+    void EndRound()         { Run("EndRound"); }
+    void Settle()           { Run("Settle"); }
+    void EndRoundOnTouch()  { Run("EndRoundOnTouch"); }
+
+private:
+    void Run(const char *name){
+        if(!trace.empty())
+            trace += " ";
+        trace += name;
+    }
+};
+
+typedef StateTable< StubGame, STATE_COUNT, EVENT_COUNT > GameTable;
+
+static const GameTable table(GameRules< StubGame >::rules, GameRules< StubGame >::Count());
+
+//Dispatch events[0..n) from state. Returns the state reached; the actions run are left in game.trace.
+static int Walk(StubGame &game, int state, const int *events, int n){
+
+    game.trace.clear();
+
+    for(int i=0; i<n; i++){
+        int next = table.Dispatch(&game, state, events[i]);
+        if(next != FSM_SAME)
+            state = next;
+    }
+
+    return state;
+}
+
+static void CheckWalk(const char *what, int from, const int *events, int n, int to, const char *actions){
+
+    StubGame game;
+    int state = Walk(game, from, events, n);
+
+    if(state != to || game.trace != actions){
+        nFailures++;
+        printf("FAIL %s: reached %s running [%s], expected %s running [%s]\n", what, stateNames[state], game.trace.c_str(), stateNames[to], actions);
+    }
+}
+
+static void PrintTable(){
+
+    printf("%-14s", "");
+    for(int e=0; e<EVENT_COUNT; e++)
+        printf(" %-11s", eventNames[e]);
+    printf("\n");
+
+    for(int s=0; s<STATE_COUNT; s++){
+        printf("%-14s", stateNames[s]);
+        for(int e=0; e<EVENT_COUNT; e++){
+            int next = table.Next(s, e);
+            printf(" %-11s", next == FSM_SAME ? "." : stateNames[next]);
+        }
+        printf("\n");
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    bool bQuiet = false;
+    int opt;
+
+    while((opt = getopt(argc, argv, "q")) != -1){
+        switch(opt){
+            case 'q': bQuiet = true; break;
+            default:
+                printf("usage: %s [-q]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if(!bQuiet)
+        PrintTable();
+
+    //Every next state is a state
+    for(int s=0; s<STATE_COUNT; s++)
+        for(int e=0; e<EVENT_COUNT; e++){
+            int next = table.Next(s, e);
+            CHECK(next == FSM_SAME || (next >= 0 && next < STATE_COUNT), "next state in range");
+        }
+
+    //The table reaches every state of a game from ROUND_READY
+    bool reached[STATE_COUNT] = { false };
+    int queue[STATE_COUNT], head = 0, tail = 0;
+
+    reached[STATE_ROUND_READY] = true;
+    queue[tail++] = STATE_ROUND_READY;
+    while(head < tail){
+        int s = queue[head++];
+        for(int e=0; e<EVENT_COUNT; e++){
+            int next = table.Next(s, e);
+            if(next != FSM_SAME && !reached[next]){
+                reached[next] = true;
+                queue[tail++] = next;
+            }
+        }
+    }
+    CHECK(reached[STATE_AIM] && reached[STATE_SHOOT] && reached[STATE_ROUND_END] && reached[STATE_GAME_END], "game states reachable");
+
+    //A round played by the robot
+    int round[] = { EVENT_NEW_ROUND, EVENT_NEW_ROUND, EVENT_AIMING_SHOT };
+    CheckWalk("robot round", STATE_ROUND_READY, round, 3, STATE_ROUND_END, "EnterRoundReady OpenRound SuspendIdle Decide Shoot");
+
+    //The end of round settles; other task status of the ended round is handled by EndRound()
+    int end[] = { EVENT_SHOT_IN_PLAY, EVENT_END_ROUND };
+    CheckWalk("end of round", STATE_ROUND_END, end, 2, STATE_ROUND_END, "SuspendIdle EndRound SuspendIdle Settle");
+
+    //Demonstrations take over from any state of the round
+    int demo[] = { EVENT_DEMONSTRATION };
+    CheckWalk("demonstration when ready", STATE_ROUND_READY, demo, 1, STATE_ROUND_END, "EnterRoundReady Demonstrate");
+    CheckWalk("demonstration when aiming", STATE_AIM, demo, 1, STATE_ROUND_END, "SuspendIdle Demonstrate");
+    CheckWalk("demonstration in shot", STATE_SHOOT, demo, 1, STATE_ROUND_END, "DemonstrateInShot");
+    CheckWalk("demonstration after round", STATE_ROUND_END, demo, 1, STATE_ROUND_END, "SuspendIdle EndRoundOnTouch");
+
+    //Other touches interrupt a shot, and are ignored while aiming
+    int touch[] = { EVENT_TOUCH };
+    CheckWalk("touch in shot", STATE_SHOOT, touch, 1, STATE_SHOOT, "InterruptShot");
+    CheckWalk("touch when aiming", STATE_AIM, touch, 1, STATE_AIM, "SuspendIdle");
+
+    //A round ending before the shot
+    int early[] = { EVENT_END_ROUND };
+    CheckWalk("round ends in shot", STATE_SHOOT, early, 1, STATE_ROUND_END, "");
+    int call[] = { EVENT_TRANS_CALL };
+    CheckWalk("round called when ready", STATE_ROUND_READY, call, 1, STATE_ROUND_END, "EnterRoundReady");
+
+    //Game over, idle, and the next game
+    int game[] = { EVENT_END_GAME, EVENT_END_GAME, EVENT_TRANS_NEW };
+    CheckWalk("next game", STATE_ROUND_READY, game, 3, STATE_ROUND_READY, "EnterRoundReady ResumeIdle SuspendIdle");
+
+    printf("%s (%u failures)\n", nFailures ? "FAIL" : "PASS", nFailures);
+
+    return nFailures ? 1 : 0;
+}
@@ -0,0 +1,115 @@
+/*
+ * StateTable.h
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Table-driven finite-state machine: transition rules compiled into a dense state x event array.
+ * Last modified: 2026. 10. 18.
+ */
+
+/*
+ * A state machine is written down as a list of rules
+ *
+ *      { state, events, action, next state }
+ *
+ * where events is a mask of FSM_EVENT(e) bits, action a member function of the handler class H
+ * (or NULL) and next a state or FSM_SAME. StateTable compiles the list once into a dense
+ * NSTATES x NEVENTS array, so dispatching an event is one lookup:
+ *
+ *  - Rules are applied in order; a later rule overrides an earlier one for the same state and event,
+ *    so a rule for a whole class of events can be refined by the rules following it.
+ *  - A rule with no events (FSM_ALWAYS) gives the action run on every event of its state,
+ *    before the transition.
+ *  - Events without a rule leave the state unchanged.
+ *  - An action may change the state itself; its rule then has next state FSM_SAME.
+ *
+ * Next() reads the table without running actions, to walk the state machine offline.
+ */
+
+#ifndef _STATETABLE_MODULE_H_
+#define _STATETABLE_MODULE_H_
+
+#define FSM_SAME            (-1)        // next state: unchanged
+#define FSM_ALWAYS          0UL         // events: every event of the state, before the transition
+#define FSM_EVENT(e)        (1UL << (e))
+
+//----------------------------------------------------------------------
+//  StateTable
+//----------------------------------------------------------------------
+template < class H, int NSTATES, int NEVENTS >
+class StateTable{
+
+public:
+    typedef void (H::*Action)();
+
+    struct Rule{
+        int state;
+        unsigned long events;
+        Action action;
+        int next;
+    };
+
+    StateTable(const Rule *rules, int numRules){
+
+        for(int s=0; s<NSTATES; s++){
+            entry[s] = 0;
+            for(int e=0; e<NEVENTS; e++){
+                cells[s][e].action = 0;
+                cells[s][e].next = FSM_SAME;
+            }
+        }
+
+        for(int i=0; i<numRules; i++){
+            const Rule &r = rules[i];
+            if(r.state < 0 || r.state >= NSTATES)
+                continue;
+
+            if(r.events == FSM_ALWAYS){
+                entry[r.state] = r.action;
+                continue;
+            }
+
+            for(int e=0; e<NEVENTS; e++){
+                if(r.events & FSM_EVENT(e)){
+                    cells[r.state][e].action = r.action;
+                    cells[r.state][e].next = r.next;
+                }
+            }
+        }
+    }
+
+    // Run the actions of event in state on handler. Returns the next state, FSM_SAME if unchanged.
+    int Dispatch(H *handler, int state, int event) const{
+
+        if(state < 0 || state >= NSTATES || event < 0 || event >= NEVENTS)
+            return FSM_SAME;
+
+        if(entry[state])
+            (handler->*entry[state])();
+
+        const Cell &c = cells[state][event];
+        if(c.action)
+            (handler->*c.action)();
+
+        return c.next;
+    }
+
+    // Next state of event in state, FSM_SAME if unchanged or decided by the action.
+    int Next(int state, int event) const{
+
+        if(state < 0 || state >= NSTATES || event < 0 || event >= NEVENTS)
+            return FSM_SAME;
+
+        return cells[state][event].next;
+    }
+
+private:
+    struct Cell{
+        Action action;
+        int next;
+    };
+
+    Cell cells[NSTATES][NEVENTS];
+    Action entry[NSTATES];          //run on every event of the state
+};
+
+#endif
@@ -0,0 +1,240 @@
+/*
+ * TabletCodec.cpp
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Conformance check and size/speed comparison of the text and binary tablet protocols.
+ *
+ *  Every "state" and "usertouch" packet of a game log is parsed as text, encoded as a binary frame,
+ *  decoded again and formatted back to text, and all fields must survive both round trips.
+ *  Truncated frames, foreign versions and unknown types must be rejected, commands must round-trip
+ *  in both encodings, acks must reach the listener, and the sequence tracking must count dropped
+ *  and reordered frames.
+ *
+ *      ./TabletCodec [-l log_file.txt] [-i iterations]
+ *
+ *  Prints packet sizes and parse times of both encodings. Returns non-zero on a conformance failure.
+ * Last modified: 2026. 10. 18.
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "TabletProtocol.h"
+
+using std::string;
+using std::vector;
+
+static unsigned nFailures = 0;
+static volatile long sink;      // keeps results alive
+
+#define CHECK(cond, what)   do{ if(!(cond)){ nFailures++; printf("FAIL %s: %s\n", what, #cond); } }while(0)
+
+static double now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static bool SamePacket(const TabletPacket &a, const TabletPacket &b){
+
+    if(a.kind != b.kind)
+        return false;
+
+    if(a.kind == PACKET_USERTOUCH)
+        return memcmp(a.touch, b.touch, sizeof(a.touch)) == 0;
+
+    if(a.level != b.level || a.lives != b.lives || a.enemy != b.enemy || a.score != b.score || a.round != b.round)
+        return false;
+
+    for(int i=0; i<2*a.enemy; i++)
+        if(a.enemyLocation[i] != b.enemyLocation[i])
+            return false;
+
+    return true;
+}
+
+//Text -> binary -> packet -> text -> packet
+static void CheckRoundTrip(const string &line){
+
+    TabletPacket text, bin, back;
+    unsigned char frame[TABLET_FRAME_MAX];
+    char buf[PACKET_SIZE];
+    unsigned seq = 0;
+
+    if(!ParsePacket(line.c_str(), line.size(), &text))
+        return;
+
+    int size = TabletProtocol::EncodeFrame(text, 1234567, frame);
+    CHECK(size > 0 && size <= TABLET_FRAME_MAX, line.c_str());
+
+    int type = TabletProtocol::DecodeFrame(frame, size, &bin, &seq);
+    CHECK(type == (text.kind == PACKET_STATE ? FRAME_STATE : FRAME_USERTOUCH), line.c_str());
+    CHECK(seq == 1234567, line.c_str());
+    CHECK(SamePacket(text, bin), line.c_str());
+
+    int len = TabletProtocol::FormatPacket(bin, buf, sizeof(buf));
+    CHECK(ParsePacket(buf, len, &back) && SamePacket(text, back), line.c_str());
+
+    //Every truncation is rejected
+    for(int n=0; n<size; n++)
+        CHECK(TabletProtocol::DecodeFrame(frame, n, &back, &seq) == 0, "truncated frame");
+
+    //Foreign version and unknown type are rejected
+    frame[2] = TABLET_PROTO_VERSION + 1;
+    CHECK(TabletProtocol::DecodeFrame(frame, size, &back, &seq) == 0, "foreign version");
+    frame[2] = TABLET_PROTO_VERSION;
+    frame[3] = 99;
+    CHECK(TabletProtocol::DecodeFrame(frame, size, &back, &seq) == 0, "unknown type");
+}
+
+struct AckCounter : public AckListener{
+    unsigned nAcks, lastSeq;
+    AckCounter(){ nAcks = 0; lastSeq = ~0u; }
+    virtual void OnAck(unsigned seq){ nAcks++; lastSeq = seq; }
+};
+
+static void CheckCommands(){
+
+    char buf[PACKET_SIZE];
+    unsigned char frame[TABLET_FRAME_MAX];
+    int cmd, x, y;
+    unsigned seq;
+
+    for(int c=CMD_TOUCH; c<=CMD_MOVE; c++){
+
+        int len = TabletProtocol::FormatCommand(c, 142, -7, buf, sizeof(buf));
+        CHECK(TabletProtocol::ParseCommand(buf, len, &cmd, &x, &y) && cmd == c && x == 142 && y == -7, "text command");
+
+        int size = TabletProtocol::EncodeCommandFrame(c, 142, -7, 77, frame);
+        CHECK(TabletProtocol::DecodeCommandFrame(frame, size, &cmd, &x, &y, &seq) == FRAME_TOUCH + c, "binary command");
+        CHECK(cmd == c && x == 142 && y == -7 && seq == 77, "binary command fields");
+    }
+
+    //The robot sends text until the tablet says hello
+    TabletProtocol robot;
+    TabletPacket packet;
+
+    int len = robot.Offer(buf);
+    CHECK(len > 0 && strncmp(buf, "proto bin", 9) == 0, "offer");
+    len = robot.EncodeCommand(CMD_FULLTOUCH, 400, 100, buf);
+    CHECK(strncmp(buf, "fulltouch 400 100\n", len) == 0, "text before hello");
+
+    int size = TabletProtocol::EncodeHello(0, frame);
+    CHECK(!robot.Receive((const char*) frame, size, &packet) && robot.bBinary, "hello");
+    len = robot.EncodeCommand(CMD_TOUCH, 150, 190, buf);
+    CHECK(TabletProtocol::DecodeCommandFrame((unsigned char*) buf, len, &cmd, &x, &y, &seq) == FRAME_TOUCH && seq == 0, "binary after hello");
+
+    //Acks reach the listener and are not delivered as packets
+    AckCounter acks;
+    robot.SetAckListener(&acks);
+    size = TabletProtocol::EncodeAck(0, frame);
+    CHECK(!robot.Receive((const char*) frame, size, &packet) && acks.nAcks == 1 && acks.lastSeq == 0, "ack");
+    CHECK(TabletProtocol::DecodeFrame(frame, size - 1, &packet, &seq) == 0, "truncated ack");
+}
+
+static void CheckSequence(){
+
+    TabletProtocol robot;
+    TabletPacket state, touch, packet;
+    unsigned char frame[TABLET_FRAME_MAX];
+
+    const char *s = "state level1 4 2 0 state_new_round true 800 127 845 127";
+    const char *t = "usertouch 85 199 154 191";
+    ParsePacket(s, strlen(s), &state);
+    ParsePacket(t, strlen(t), &touch);
+
+    //seq 0, 1, 4 (2 and 3 dropped), 3 (stale state), 2 (late touch)
+    unsigned order[] = {0, 1, 4, 3, 2};
+    bool delivered[5];
+    for(int i=0; i<5; i++){
+        int size = TabletProtocol::EncodeFrame(i == 4 ? touch : state, order[i], frame);
+        delivered[i] = robot.Receive((const char*) frame, size, &packet);
+    }
+
+    CHECK(delivered[0] && delivered[1] && delivered[2], "in-order frames");
+    CHECK(!delivered[3], "stale state discarded");
+    CHECK(delivered[4], "late touch delivered");
+    CHECK(robot.nDropped == 2 && robot.nReordered == 2, "sequence counters");
+}
+
+int main(int argc, char *argv[])
+{
+    const char *logfile = "log_file.txt";
+    unsigned iterations = 200;
+    int opt;
+
+    while((opt = getopt(argc, argv, "l:i:")) != -1){
+        switch(opt){
+            case 'l': logfile = optarg; break;
+            case 'i': iterations = atoi(optarg); break;
+            default:
+                printf("usage: %s [-l log_file.txt] [-i iterations]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    //Packets of the game log
+    vector< string > lines;
+    std::ifstream infile(logfile);
+    string line;
+    TabletPacket packet;
+
+    while(getline(infile, line))
+        if(ParsePacket(line.c_str(), line.size(), &packet))
+            lines.push_back(line);
+
+    printf("%u packets from %s\n", (unsigned) lines.size(), logfile);
+
+    for(unsigned i=0; i<lines.size(); i++)
+        CheckRoundTrip(lines[i]);
+    CheckCommands();
+    CheckSequence();
+
+    //Size and parse time of both encodings
+    if(!lines.empty()){
+
+        vector< string > frames;
+        unsigned textBytes = 0, binBytes = 0;
+        for(unsigned i=0; i<lines.size(); i++){
+            unsigned char frame[TABLET_FRAME_MAX];
+            ParsePacket(lines[i].c_str(), lines[i].size(), &packet);
+            int size = TabletProtocol::EncodeFrame(packet, i, frame);
+            frames.push_back(string((char*) frame, size));
+            textBytes += lines[i].size();
+            binBytes += size;
+        }
+
+        long sum = 0;
+        double start = now();
+        for(unsigned n=0; n<iterations; n++)
+            for(unsigned i=0; i<lines.size(); i++){
+                ParsePacket(lines[i].data(), lines[i].size(), &packet);
+                sum += packet.score;
+            }
+        double textNs = (now() - start) * 1e9 / ((double) iterations * lines.size());
+
+        unsigned seq;
+        start = now();
+        for(unsigned n=0; n<iterations; n++)
+            for(unsigned i=0; i<frames.size(); i++){
+                TabletProtocol::DecodeFrame((const unsigned char*) frames[i].data(), frames[i].size(), &packet, &seq);
+                sum += packet.score;
+            }
+        double binNs = (now() - start) * 1e9 / ((double) iterations * frames.size());
+
+        printf("text:   %6.1f bytes/packet %8.1f ns/packet\n", textBytes / (double) lines.size(), textNs);
+        sink = sum;
+
+        printf("binary: %6.1f bytes/packet %8.1f ns/packet\n", binBytes / (double) frames.size(), binNs);
+    }
+
+    printf("%s (%u failures)\n", nFailures ? "FAIL" : "PASS", nFailures);
+
+    return nFailures ? 1 : 0;
+}
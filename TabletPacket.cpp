@@ -0,0 +1,171 @@
+/*
+ * TabletPacket.cpp
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Implementation for parsing task-status and touch-event packets from the tablet.
+ * Last modified: 2026. 10. 18.
+ */
+
+#include <string.h>
+
+#include "TabletPacket.h"
+
+static const char* ROUND_STATE_NAMES[] = {
+    "unknown",
+    "trans_new_round",
+    "state_new_round",
+    "state_aiming_shot",
+    "state_shot_in_play",
+    "state_end_round",
+    "trans_call_round",
+    "state_end_game"
+};
+
+#define NUM_ROUND_STATES    (int)(sizeof(ROUND_STATE_NAMES)/sizeof(ROUND_STATE_NAMES[0]))
+
+static const double POW10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18};
+
+static bool tokenEquals(const PacketToken &t, const char *s, int len){
+    return t.len == len && memcmp(t.str, s, len) == 0;
+}
+
+int TokenizePacket(const char *msg, int n, PacketToken *tokens, int max){
+
+    int count = 0;
+    int i = 0;
+
+    while(i < n && count < max){
+
+        while(i < n && (msg[i] == ' ' || msg[i] == '\t' || msg[i] == '\n' || msg[i] == '\r'))
+            i++;
+        if(i >= n || msg[i] == 0)
+            break;
+
+        tokens[count].str = msg + i;
+        while(i < n && msg[i] != ' ' && msg[i] != '\t' && msg[i] != '\n' && msg[i] != '\r' && msg[i] != 0)
+            i++;
+        tokens[count].len = msg + i - tokens[count].str;
+        count++;
+    }
+
+    return count;
+}
+
+int ParseInt(const char *str, int len){
+
+    int i = 0;
+    bool negative = false;
+    int value = 0;
+
+    if(i < len && (str[i] == '-' || str[i] == '+'))
+        negative = (str[i++] == '-');
+
+    for(; i < len && str[i] >= '0' && str[i] <= '9'; i++)
+        value = value * 10 + (str[i] - '0');
+
+    return negative ? -value : value;
+}
+
+float ParseFloat(const char *str, int len){
+
+    int i = 0;
+    bool negative = false;
+    unsigned long long mantissa = 0;
+    int digits = 0;             //significant digits kept in mantissa
+    int scale = 0;              //decimal exponent of mantissa
+
+    if(i < len && (str[i] == '-' || str[i] == '+'))
+        negative = (str[i++] == '-');
+
+    for(; i < len && str[i] >= '0' && str[i] <= '9'; i++){
+        if(digits < 18){
+            mantissa = mantissa * 10 + (str[i] - '0');
+            if(mantissa) digits++;
+        }
+        else
+            scale++;
+    }
+
+    if(i < len && str[i] == '.'){
+        for(i++; i < len && str[i] >= '0' && str[i] <= '9'; i++){
+            if(digits < 18){
+                mantissa = mantissa * 10 + (str[i] - '0');
+                if(mantissa) digits++;
+                scale--;
+            }
+        }
+    }
+
+    if(i < len && (str[i] == 'e' || str[i] == 'E'))
+        scale += ParseInt(str + i + 1, len - i - 1);
+
+    double value = (double) mantissa;
+    while(scale > 18){ value *= 1e18; scale -= 18; }
+    while(scale < -18){ value /= 1e18; scale += 18; }
+    value = (scale >= 0) ? value * POW10[scale] : value / POW10[-scale];
+
+    return (float) (negative ? -value : value);
+}
+
+const char* RoundStateName(int round){
+
+    if(round < 0 || round >= NUM_ROUND_STATES)
+        round = ROUND_UNKNOWN;
+
+    return ROUND_STATE_NAMES[round];
+}
+
+bool ParsePacket(const char *msg, int n, TabletPacket *packet){
+
+    PacketToken tok[PACKET_MAX_TOKENS];
+    int count = TokenizePacket(msg, n, tok, PACKET_MAX_TOKENS);
+
+    packet->kind = PACKET_UNKNOWN;
+
+    if(count == 0)
+        return false;
+
+    if(tokenEquals(tok[0], "state", 5)){
+
+        //state levelN lives enemies score round-state flag x1 y1 x2 y2 ...
+        if(count < 7 || tok[1].len < 6 || memcmp(tok[1].str, "level", 5) != 0)
+            return false;
+
+        packet->level = ParseInt(tok[1].str + 5, tok[1].len - 5);
+        packet->lives = ParseInt(tok[2].str, tok[2].len);
+        packet->enemy = ParseInt(tok[3].str, tok[3].len);
+        packet->score = ParseInt(tok[4].str, tok[4].len);
+
+        packet->round = ROUND_UNKNOWN;
+        for(int i=1; i<NUM_ROUND_STATES; i++){
+            if(tokenEquals(tok[5], ROUND_STATE_NAMES[i], strlen(ROUND_STATE_NAMES[i]))){
+                packet->round = i;
+                break;
+            }
+        }
+
+        if(packet->enemy < 0 || packet->enemy > PACKET_MAX_ENEMY || count < 7 + 2*packet->enemy)
+            return false;
+
+        for(int i=0; i < 2*packet->enemy; i++)
+            packet->enemyLocation[i] = ParseFloat(tok[7+i].str, tok[7+i].len);
+
+        packet->kind = PACKET_STATE;
+        return true;
+    }
+
+    if(tokenEquals(tok[0], "usertouch", 9)){
+
+        //usertouch x y x y
+        if(count < 5)
+            return false;
+
+        for(int i=0; i<4; i++)
+            packet->touch[i] = ParseInt(tok[1+i].str, tok[1+i].len);
+
+        packet->kind = PACKET_USERTOUCH;
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,96 @@
+/*
+ * TabletPacket.h
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Declarations for parsing task-status and touch-event packets from the tablet.
+ * Last modified: 2026. 10. 18.
+ */
+
+/*
+ * The tablet sends space-separated text packets:
+ *
+ *  state level4 4 3 0 state_new_round true 924.98382568359 152.1413269043 ...
+ *        level  lives enemies score round-state  flag  (x, y) location of every enemy
+ *
+ *  usertouch 85 199 154 191
+ *            x  y   x   y      (touch down and current touch point)
+ *
+ *  TokenizePacket() splits a packet in place into (pointer, length) views without allocating.
+ *  ParsePacket() tokenizes once, maps the packet kind and round state to enums and converts
+ *  every number with locale-independent parsers, so the state machine and buildProblem()
+ *  only read fields.
+ */
+
+#ifndef _TABLETPACKET_MODULE_H_
+#define _TABLETPACKET_MODULE_H_
+
+#define PACKET_SIZE         1000    // max packet size in bytes
+#define PACKET_MAX_TOKENS   64      // max tokens in a packet
+#define PACKET_MAX_ENEMY    16      // max enemy locations in a state packet
+
+//Packet kinds: first token of a packet
+enum PACKET_KINDS {
+    PACKET_UNKNOWN,
+    PACKET_STATE,           // "state"
+    PACKET_USERTOUCH        // "usertouch"
+};
+
+//Round states reported by the game (6th token of a state packet)
+enum ROUND_STATES {
+    ROUND_UNKNOWN,
+    ROUND_TRANS_NEW,        // "trans_new_round"
+    ROUND_NEW,              // "state_new_round"
+    ROUND_AIMING_SHOT,      // "state_aiming_shot"
+    ROUND_SHOT_IN_PLAY,     // "state_shot_in_play"
+    ROUND_END,              // "state_end_round"
+    ROUND_TRANS_CALL,       // "trans_call_round"
+    ROUND_END_GAME          // "state_end_game"
+};
+
+//Token view into a packet buffer. Not null-terminated.
+struct PacketToken{
+    const char *str;
+    int len;
+};
+
+//----------------------------------------------------------------------
+//  TabletPacket
+//      Fields of a parsed packet. Plain data: copying a packet never allocates.
+//----------------------------------------------------------------------
+struct TabletPacket{
+
+    int kind;                               //PACKET_KINDS
+
+    //PACKET_STATE
+    int level;
+    int lives;
+    int enemy;
+    int score;
+    int round;                              //ROUND_STATES
+    float enemyLocation[2*PACKET_MAX_ENEMY];
+
+    //PACKET_USERTOUCH
+    int touch[4];
+
+    TabletPacket(){
+        kind = PACKET_UNKNOWN;
+        level = lives = enemy = score = 0;
+        round = ROUND_UNKNOWN;
+        touch[0] = touch[1] = touch[2] = touch[3] = 0;
+    }
+};
+
+// Split msg[0..n) at spaces and tabs. Returns the number of tokens stored (at most max).
+int TokenizePacket(const char *msg, int n, PacketToken *tokens, int max);
+
+// Parse msg[0..n) into packet. Returns false (and kind PACKET_UNKNOWN) for malformed packets.
+bool ParsePacket(const char *msg, int n, TabletPacket *packet);
+
+// Locale-independent number conversion of a token.
+int ParseInt(const char *str, int len);
+float ParseFloat(const char *str, int len);
+
+// Name of a round state, as sent by the tablet.
+const char* RoundStateName(int round);
+
+#endif
@@ -0,0 +1,330 @@
+/*
+ * TabletProtocol.cpp
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Implementation of the compact binary tablet protocol and its negotiation.
+ * Last modified: 2026. 10. 18.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "TabletProtocol.h"
+
+#define STATE_SIZE      (TABLET_HEADER_SIZE + 8)    // state frame without enemy locations
+#define TOUCH_SIZE      (TABLET_HEADER_SIZE + 8)
+#define COMMAND_SIZE    (TABLET_HEADER_SIZE + 4)
+
+static const char* COMMAND_NAMES[] = { "touch", "release", "fulltouch", "move" };
+
+static void put16(unsigned char *p, unsigned short v){
+    v = htons(v);
+    memcpy(p, &v, 2);
+}
+
+static void put32(unsigned char *p, unsigned int v){
+    v = htonl(v);
+    memcpy(p, &v, 4);
+}
+
+static unsigned short get16(const unsigned char *p){
+    unsigned short v;
+    memcpy(&v, p, 2);
+    return ntohs(v);
+}
+
+static unsigned int get32(const unsigned char *p){
+    unsigned int v;
+    memcpy(&v, p, 4);
+    return ntohl(v);
+}
+
+static void putHeader(unsigned char *p, int type, unsigned seq){
+    p[0] = 'T';
+    p[1] = 'B';
+    p[2] = TABLET_PROTO_VERSION;
+    p[3] = (unsigned char) type;
+    put32(p+4, seq);
+}
+
+TabletProtocol::TabletProtocol(){
+
+    bBinary = false;
+    nDropped = 0;
+    nReordered = 0;
+
+    nSendSeq = 0;
+    bSendReset = 0;
+    nRecvSeq = 0;
+    bRecvSeq = false;
+    mAckListener = 0;
+}
+
+int TabletProtocol::Offer(char *buf){
+    return sprintf(buf, "proto bin %d\n", TABLET_PROTO_VERSION);
+}
+
+bool TabletProtocol::Receive(const char *buf, int size, TabletPacket *packet){
+
+    if(!IsFrame(buf, size))
+        return ParsePacket(buf, size, packet);
+
+    unsigned seq;
+    int type = DecodeFrame((const unsigned char*) buf, size, packet, &seq);
+
+    if(type == FRAME_HELLO){
+        __sync_lock_test_and_set(&bSendReset, 1);
+        bBinary = true;
+        nRecvSeq = 0;
+        bRecvSeq = true;
+        return false;
+    }
+
+    if(type == FRAME_ACK){
+        if(mAckListener)
+            mAckListener->OnAck(seq);
+        return false;
+    }
+
+    if(type == 0)
+        return false;
+
+    return CheckSequence(seq, type);
+}
+
+//Track the inbound sequence. Stale state frames are discarded; touch frames are always delivered.
+bool TabletProtocol::CheckSequence(unsigned seq, int type){
+
+    if(!bRecvSeq){
+        bRecvSeq = true;
+        nRecvSeq = seq + 1;
+        return true;
+    }
+
+    int diff = (int) (seq - nRecvSeq);
+
+    if(diff < 0){
+        nReordered++;
+        return type != FRAME_STATE;
+    }
+
+    nDropped += diff;
+    nRecvSeq = seq + 1;
+
+    return true;
+}
+
+int TabletProtocol::EncodeCommand(int cmd, int x, int y, char *buf, unsigned *seq){
+
+    if(__sync_lock_test_and_set(&bSendReset, 0))
+        nSendSeq = 0;
+
+    if(bBinary){
+        if(seq)
+            *seq = nSendSeq;
+        return EncodeCommandFrame(cmd, x, y, nSendSeq++, (unsigned char*) buf);
+    }
+
+    return FormatCommand(cmd, x, y, buf, PACKET_SIZE);
+}
+
+//----------------------------------------------------------------------
+// Frame encoding and decoding (see TabletProtocol.h for the layout)
+//----------------------------------------------------------------------
+bool TabletProtocol::IsFrame(const char *buf, int size){
+    return size >= TABLET_HEADER_SIZE && buf[0] == 'T' && buf[1] == 'B';
+}
+
+int TabletProtocol::EncodeHello(unsigned seq, unsigned char *buf){
+
+    putHeader(buf, FRAME_HELLO, seq);
+
+    return TABLET_HEADER_SIZE;
+}
+
+int TabletProtocol::EncodeAck(unsigned seq, unsigned char *buf){
+
+    putHeader(buf, FRAME_ACK, seq);
+
+    return TABLET_HEADER_SIZE;
+}
+
+int TabletProtocol::EncodeFrame(const TabletPacket &packet, unsigned seq, unsigned char *buf){
+
+    unsigned char *q = buf + TABLET_HEADER_SIZE;
+
+    if(packet.kind == PACKET_STATE){
+
+        if(packet.enemy < 0 || packet.enemy > PACKET_MAX_ENEMY)
+            return 0;
+
+        putHeader(buf, FRAME_STATE, seq);
+        q[0] = (unsigned char) packet.level;
+        q[1] = (unsigned char) packet.lives;
+        q[2] = (unsigned char) packet.round;
+        q[3] = (unsigned char) packet.enemy;
+        put32(q+4, (unsigned int) packet.score);
+        q += 8;
+
+        for(int i=0; i<2*packet.enemy; i++){
+            unsigned int v;
+            memcpy(&v, &packet.enemyLocation[i], 4);
+            put32(q, v);
+            q += 4;
+        }
+
+        return STATE_SIZE + 8*packet.enemy;
+    }
+
+    if(packet.kind == PACKET_USERTOUCH){
+
+        putHeader(buf, FRAME_USERTOUCH, seq);
+        for(int i=0; i<4; i++)
+            put16(q + 2*i, (unsigned short) packet.touch[i]);
+
+        return TOUCH_SIZE;
+    }
+
+    return 0;
+}
+
+int TabletProtocol::DecodeFrame(const unsigned char *buf, int size, TabletPacket *packet, unsigned *seq){
+
+    packet->kind = PACKET_UNKNOWN;
+
+    if(size < TABLET_HEADER_SIZE || buf[0] != 'T' || buf[1] != 'B' || buf[2] != TABLET_PROTO_VERSION)
+        return 0;
+
+    const unsigned char *q = buf + TABLET_HEADER_SIZE;
+    int type = buf[3];
+
+    *seq = get32(buf+4);
+
+    switch(type){
+
+        case FRAME_HELLO:
+        case FRAME_ACK:
+            return (size == TABLET_HEADER_SIZE) ? type : 0;
+
+        case FRAME_STATE:{
+
+            if(size < STATE_SIZE)
+                return 0;
+
+            int enemy = q[3];
+            if(enemy > PACKET_MAX_ENEMY || size != STATE_SIZE + 8*enemy || q[2] > ROUND_END_GAME)
+                return 0;
+
+            packet->level = q[0];
+            packet->lives = q[1];
+            packet->round = q[2];
+            packet->enemy = enemy;
+            packet->score = (int) get32(q+4);
+            q += 8;
+
+            for(int i=0; i<2*enemy; i++){
+                unsigned int v = get32(q);
+                memcpy(&packet->enemyLocation[i], &v, 4);
+                q += 4;
+            }
+
+            packet->kind = PACKET_STATE;
+            return type;
+        }
+
+        case FRAME_USERTOUCH:{
+
+            if(size != TOUCH_SIZE)
+                return 0;
+
+            for(int i=0; i<4; i++)
+                packet->touch[i] = (short) get16(q + 2*i);
+
+            packet->kind = PACKET_USERTOUCH;
+            return type;
+        }
+    }
+
+    return 0;
+}
+
+int TabletProtocol::EncodeCommandFrame(int cmd, int x, int y, unsigned seq, unsigned char *buf){
+
+    if(cmd < CMD_TOUCH || cmd > CMD_MOVE)
+        return 0;
+
+    putHeader(buf, FRAME_TOUCH + cmd, seq);
+    put16(buf + TABLET_HEADER_SIZE, (unsigned short) x);
+    put16(buf + TABLET_HEADER_SIZE + 2, (unsigned short) y);
+
+    return COMMAND_SIZE;
+}
+
+int TabletProtocol::DecodeCommandFrame(const unsigned char *buf, int size, int *cmd, int *x, int *y, unsigned *seq){
+
+    if(size != COMMAND_SIZE || buf[0] != 'T' || buf[1] != 'B' || buf[2] != TABLET_PROTO_VERSION)
+        return 0;
+
+    int type = buf[3];
+    if(type < FRAME_TOUCH || type > FRAME_MOVE)
+        return 0;
+
+    *cmd = type - FRAME_TOUCH;
+    *x = (short) get16(buf + TABLET_HEADER_SIZE);
+    *y = (short) get16(buf + TABLET_HEADER_SIZE + 2);
+    *seq = get32(buf+4);
+
+    return type;
+}
+
+//----------------------------------------------------------------------
+// Text equivalents
+//----------------------------------------------------------------------
+int TabletProtocol::FormatPacket(const TabletPacket &packet, char *buf, int size){
+
+    int len = 0;
+
+    if(packet.kind == PACKET_STATE){
+
+        len = snprintf(buf, size, "state level%d %d %d %d %s true", packet.level, packet.lives, packet.enemy, packet.score, RoundStateName(packet.round));
+
+        for(int i=0; i<2*packet.enemy && len < size; i++)
+            len += snprintf(buf + len, size - len, " %.9g", packet.enemyLocation[i]);
+    }
+    else if(packet.kind == PACKET_USERTOUCH)
+        len = snprintf(buf, size, "usertouch %d %d %d %d", packet.touch[0], packet.touch[1], packet.touch[2], packet.touch[3]);
+    else if(size > 0)
+        buf[0] = 0;
+
+    return (len < size) ? len : size - 1;
+}
+
+int TabletProtocol::FormatCommand(int cmd, int x, int y, char *buf, int size){
+
+    if(cmd < CMD_TOUCH || cmd > CMD_MOVE)
+        return 0;
+
+    int len = snprintf(buf, size, "%s %d %d\n", COMMAND_NAMES[cmd], x, y);
+
+    return (len < size) ? len : size - 1;
+}
+
+bool TabletProtocol::ParseCommand(const char *buf, int size, int *cmd, int *x, int *y){
+
+    PacketToken tok[4];
+
+    if(TokenizePacket(buf, size, tok, 4) != 3)
+        return false;
+
+    for(int i=CMD_TOUCH; i<=CMD_MOVE; i++){
+        if(tok[0].len == (int) strlen(COMMAND_NAMES[i]) && memcmp(tok[0].str, COMMAND_NAMES[i], tok[0].len) == 0){
+            *cmd = i;
+            *x = ParseInt(tok[1].str, tok[1].len);
+            *y = ParseInt(tok[2].str, tok[2].len);
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,129 @@
+/*
+ * TabletProtocol.h
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Declarations of the compact binary tablet protocol and its negotiation.
+ * Last modified: 2026. 10. 18.
+ */
+
+/*
+ * The text protocol (see TabletPacket.h) stays the default. The binary protocol carries the same
+ * fields in fixed-size frames with a sequence number, so dropped and reordered datagrams
+ * can be detected.
+ *
+ *  Negotiation:
+ *  - The robot offers the binary protocol with the text command "proto bin <version>\n".
+ *    Tablets that do not know the command ignore it and keep sending text.
+ *  - A tablet that accepts replies with a FRAME_HELLO frame and sends binary frames from then on.
+ *    The robot sends its commands as binary frames after receiving FRAME_HELLO.
+ *  - Both ends restart their sequence numbers at 0 with FRAME_HELLO.
+ *  - A tablet may acknowledge binary commands with FRAME_ACK. The robot retransmits unacknowledged
+ *    commands only to a tablet that has acknowledged one before (see CommandSender.h).
+ *  - Text and binary packets are told apart by the first two bytes, so the robot accepts either
+ *    at any time.
+ */
+
+#ifndef _TABLETPROTOCOL_MODULE_H_
+#define _TABLETPROTOCOL_MODULE_H_
+
+#include "TabletPacket.h"
+
+#define TABLET_PROTO_VERSION    1
+#define TABLET_FRAME_MAX        (TABLET_HEADER_SIZE + 8 + 8*PACKET_MAX_ENEMY)  // max frame size in bytes
+#define TABLET_HEADER_SIZE      8
+
+//----------------------------------------------------------------------
+//  Tablet frame types
+//
+//  Header (8 bytes, network byte order)
+//      u8 'T', u8 'B', u8 version, u8 type, u32 seq
+//
+//  FRAME_HELLO         (no payload) protocol accepted, version in the header
+//  FRAME_STATE         u8 level, u8 lives, u8 round (ROUND_STATES), u8 enemy,
+//                      i32 score, f32 enemyLocation[2*enemy]
+//  FRAME_USERTOUCH     i16 x, i16 y, i16 x, i16 y
+//  FRAME_TOUCH         i16 x, i16 y        (robot to tablet)
+//  FRAME_RELEASE       i16 x, i16 y        (robot to tablet)
+//  FRAME_FULLTOUCH     i16 x, i16 y        (robot to tablet)
+//  FRAME_MOVE          i16 x, i16 y        (robot to tablet) touch dragged to x, y
+//  FRAME_ACK           (no payload) command with the seq of the header received (tablet to robot)
+//----------------------------------------------------------------------
+enum TABLET_FRAME_TYPES {
+    FRAME_HELLO = 1,
+    FRAME_STATE,
+    FRAME_USERTOUCH,
+    FRAME_TOUCH,
+    FRAME_RELEASE,
+    FRAME_FULLTOUCH,
+    FRAME_MOVE,
+    FRAME_ACK
+};
+
+//Commands sent from robot to tablet
+enum TABLET_COMMANDS {
+    CMD_TOUCH,
+    CMD_RELEASE,
+    CMD_FULLTOUCH,
+    CMD_MOVE
+};
+
+//Receives the command acknowledgements of the tablet, on the thread calling Receive().
+class AckListener{
+public:
+    virtual ~AckListener(){}
+    virtual void OnAck(unsigned seq) = 0;
+};
+
+//----------------------------------------------------------------------
+//  TabletProtocol
+//      Protocol state of one robot-tablet link: negotiated mode, outbound sequence number
+//      and inbound sequence tracking. Receive() and EncodeCommand() may run on different threads.
+//----------------------------------------------------------------------
+class TabletProtocol{
+
+public:
+    TabletProtocol();
+
+    volatile bool bBinary;      //binary protocol accepted by the tablet
+    unsigned nDropped;          //frames missing from the inbound sequence
+    unsigned nReordered;        //frames received after a newer frame (stale states are discarded)
+
+    // Text offer of the binary protocol. Returns its size.
+    int Offer(char *buf);
+
+    // Decode a received text packet or binary frame into packet.
+    // Returns false for malformed packets, control frames and stale state frames.
+    bool Receive(const char *buf, int size, TabletPacket *packet);
+
+    // Encode a command in the negotiated protocol. Returns its size.
+    // seq is set to the sequence number of a binary frame and left alone for text.
+    int EncodeCommand(int cmd, int x, int y, char *buf, unsigned *seq = 0);
+
+    void SetAckListener(AckListener *listener){ mAckListener = listener; }
+
+    // Reference encoders and decoders. Encoders return the frame size (0 if it does not fit),
+    // decoders return the frame type (0 if the frame is malformed).
+    static bool IsFrame(const char *buf, int size);
+    static int EncodeHello(unsigned seq, unsigned char *buf);
+    static int EncodeAck(unsigned seq, unsigned char *buf);
+    static int EncodeFrame(const TabletPacket &packet, unsigned seq, unsigned char *buf);
+    static int DecodeFrame(const unsigned char *buf, int size, TabletPacket *packet, unsigned *seq);
+    static int EncodeCommandFrame(int cmd, int x, int y, unsigned seq, unsigned char *buf);
+    static int DecodeCommandFrame(const unsigned char *buf, int size, int *cmd, int *x, int *y, unsigned *seq);
+
+    // Text equivalents, as sent by the text protocol. Return the text length.
+    static int FormatPacket(const TabletPacket &packet, char *buf, int size);
+    static int FormatCommand(int cmd, int x, int y, char *buf, int size);
+    static bool ParseCommand(const char *buf, int size, int *cmd, int *x, int *y);
+
+private:
+    unsigned nSendSeq;          //next outbound sequence number
+    volatile int bSendReset;    //hello received: restart nSendSeq on the next command
+    unsigned nRecvSeq;          //next expected inbound sequence number
+    bool bRecvSeq;              //nRecvSeq is valid
+    AckListener *mAckListener;
+
+    bool CheckSequence(unsigned seq, int type);
+};
+
+#endif
@@ -0,0 +1,474 @@
+/*
+ * TabletSimulator.cpp
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Local tablet simulator speaking the game protocol, for end-to-end runs without
+ *  the tablet.
+ *
+ *  Each simulated game has its own UDP socket, bound to port + game index. It sends task-status
+ *  packets to the robot from that socket and receives the robot's commands on it. A game follows
+ *  the sequence of the real tablet:
+ *
+ *      trans_new_round, state_new_round ...    until "touch x y"
+ *      state_aiming_shot ...                   until "release x y" ("move x y" drags the finger)
+ *      usertouch x y 150 195, state_shot_in_play, state_end_round ...    until "fulltouch"
+ *      usertouch 400 100 400 100, next round (or state_end_game and a new game)
+ *
+ *  Scoring model: a shot released at r flies toward S + GAIN*(S - r), S being the sling; every
+ *  enemy within HIT_RADIUS of that point is destroyed for 5000 points. A round costs a life.
+ *  With -u, a simulated user demonstrates a good shot at the start of that share of rounds.
+ *
+ *  The binary protocol is accepted when the robot offers it; with -a, binary commands are
+ *  acknowledged. All games share one event loop and timer wheel, so thousands of concurrent
+ *  games run in one process. Start the robot with -T 127.0.0.1 to receive the commands of game 0.
+ *
+ *      ./TabletSimulator [-g games] [-r robot_ip[:port]] [-b bind_ip] [-p port] [-x speed]
+ *                        [-u demo_percent] [-a] [-d seconds] [-s seed]
+ *
+ *  Prints rounds per minute, hit rate and decision time (new round to touch) every 5 seconds.
+ * Last modified: 2026. 10. 18.
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <signal.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <vector>
+
+#include "EventLoop.h"
+#include "TimerWheel.h"
+#include "TabletProtocol.h"
+
+using std::vector;
+
+#define SIM_ROBOT_PORT      12345       // FROM_TABLET_PORT of the robot
+#define SIM_PORT            8888        // TO_TABLET_PORT of the robot, for game 0
+#define SIM_STATUS_MS       100         // status packets are repeated this often
+#define SIM_FLIGHT_MS       1500        // shot in play until the round ends
+#define SIM_GAME_OVER_MS    2000        // end of game until a new game
+#define SIM_REPORT_MS       5000
+
+#define SLING_X             150
+#define SLING_Y             195
+#define SHOT_GAIN           6.5f
+#define HIT_RADIUS          40.0f
+#define HIT_SCORE           5000
+#define START_LIVES         4
+
+enum SIM_TIMERS { TIMER_STATUS, TIMER_FLIGHT, TIMER_GAME, TIMER_REPORT };
+
+static volatile sig_atomic_t bStop = 0;
+
+static void StopSignal(int sig){
+    bStop = 1;
+}
+
+//----------------------------------------------------------------------
+//  Simulation parameters and totals, shared by all games
+//----------------------------------------------------------------------
+struct Simulation{
+    TimerWheel *timers;
+    struct sockaddr_in robot;
+    double speed;
+    int demoPercent;
+    bool bAck;
+
+    unsigned long rounds, games, shots, hits, demos, commands, malformed;
+    unsigned long decisions;
+    long long decisionSumUs, decisionMaxUs;
+
+    unsigned Scaled(unsigned ms){ return (unsigned) (ms / speed) + 1; }
+};
+
+//----------------------------------------------------------------------
+//  Game: one simulated tablet
+//----------------------------------------------------------------------
+class Game : public EventHandler, public TimerHandler{
+
+public:
+    Game(Simulation *sim, int fd);
+
+    void NewGame();
+    virtual void OnEvent(int fd);
+    virtual void OnTimer(Timer *timer);
+
+private:
+    enum PHASES { PHASE_NEW, PHASE_AIMING, PHASE_FLIGHT, PHASE_END, PHASE_GAME_OVER };
+
+    Simulation *mSim;
+    int sockfd;
+    int phase;
+    TabletPacket state;
+    Timer statusTimer, flightTimer, gameTimer;
+
+    bool bBinary;
+    unsigned nSendSeq;
+    int xRelease, yRelease;
+    long long roundStartUs;
+
+    void NewRound();
+    void SendState(int round);
+    void SendTouch(int x0, int y0, int x1, int y1);
+    void Send(const void *buf, int size);
+    void Command(int cmd, int x, int y);
+    void Shoot(int x, int y);
+};
+
+Game::Game(Simulation *sim, int fd) : statusTimer(this, TIMER_STATUS), flightTimer(this, TIMER_FLIGHT), gameTimer(this, TIMER_GAME){
+
+    mSim = sim;
+    sockfd = fd;
+    bBinary = false;
+    nSendSeq = 0;
+    xRelease = yRelease = 0;
+    roundStartUs = 0;
+}
+
+void Game::NewGame(){
+
+    state.kind = PACKET_STATE;
+    state.level = rand() % 4 + 1;
+    state.lives = START_LIVES;
+    state.score = 0;
+    state.enemy = rand() % 4 + 1;
+
+    for(int i=0; i<state.enemy; i++){
+        state.enemyLocation[2*i] = 700 + rand() % 250;
+        state.enemyLocation[2*i+1] = 20 + rand() % 240;
+    }
+
+    mSim->games++;
+    NewRound();
+}
+
+void Game::NewRound(){
+
+    phase = PHASE_NEW;
+    roundStartUs = EventLoop::NowUs();
+
+    SendState(ROUND_TRANS_NEW);
+    state.round = ROUND_NEW;
+    mSim->timers->Arm(&statusTimer, mSim->Scaled(SIM_STATUS_MS), mSim->Scaled(SIM_STATUS_MS));
+
+    //A user demonstrates: aim at the first enemy
+    if(rand() % 100 < mSim->demoPercent){
+        float tx = state.enemyLocation[0], ty = state.enemyLocation[1];
+        int x = (int) (SLING_X - (tx - SLING_X) / SHOT_GAIN);
+        int y = (int) (SLING_Y - (ty - SLING_Y) / SHOT_GAIN);
+        SendState(ROUND_NEW);
+        mSim->demos++;
+        Shoot(x, y);
+    }
+}
+
+void Game::SendState(int round){
+
+    unsigned char buf[PACKET_SIZE];
+    int size;
+
+    state.round = round;
+
+    if(bBinary)
+        size = TabletProtocol::EncodeFrame(state, nSendSeq++, buf);
+    else
+        size = TabletProtocol::FormatPacket(state, (char*) buf, sizeof(buf));
+
+    Send(buf, size);
+}
+
+void Game::SendTouch(int x0, int y0, int x1, int y1){
+
+    TabletPacket touch;
+    unsigned char buf[PACKET_SIZE];
+    int size;
+
+    touch.kind = PACKET_USERTOUCH;
+    touch.touch[0] = x0;
+    touch.touch[1] = y0;
+    touch.touch[2] = x1;
+    touch.touch[3] = y1;
+
+    if(bBinary)
+        size = TabletProtocol::EncodeFrame(touch, nSendSeq++, buf);
+    else
+        size = TabletProtocol::FormatPacket(touch, (char*) buf, sizeof(buf));
+
+    Send(buf, size);
+}
+
+void Game::Send(const void *buf, int size){
+    sendto(sockfd, buf, size, 0, (struct sockaddr *)&mSim->robot, sizeof(mSim->robot));
+}
+
+//Shot released at (x,y): echo it, fly, and score when the flight is over
+void Game::Shoot(int x, int y){
+
+    xRelease = x;
+    yRelease = y;
+
+    SendTouch(x, y, SLING_X, SLING_Y);
+    SendState(ROUND_SHOT_IN_PLAY);
+
+    phase = PHASE_FLIGHT;
+    mSim->shots++;
+    mSim->timers->Cancel(&statusTimer);
+    mSim->timers->Arm(&flightTimer, mSim->Scaled(SIM_FLIGHT_MS));
+}
+
+void Game::OnEvent(int fd){
+
+    char buf[PACKET_SIZE];
+    int cmd, x, y;
+    unsigned seq;
+
+    int n = recv(fd, buf, sizeof(buf) - 1, MSG_DONTWAIT);
+    if(n <= 0)
+        return;
+    buf[n] = 0;
+
+    if(TabletProtocol::IsFrame(buf, n)){
+
+        if(TabletProtocol::DecodeCommandFrame((const unsigned char*) buf, n, &cmd, &x, &y, &seq) == 0){
+            mSim->malformed++;
+            return;
+        }
+
+        if(mSim->bAck){
+            unsigned char ack[TABLET_HEADER_SIZE];
+            Send(ack, TabletProtocol::EncodeAck(seq, ack));
+        }
+    }
+    else if(strncmp(buf, "proto bin", 9) == 0){
+
+        //Accept the binary protocol
+        unsigned char hello[TABLET_HEADER_SIZE];
+        Send(hello, TabletProtocol::EncodeHello(0, hello));
+        bBinary = true;
+        nSendSeq = 1;
+        return;
+    }
+    else if(!TabletProtocol::ParseCommand(buf, n, &cmd, &x, &y)){
+        mSim->malformed++;
+        return;
+    }
+
+    mSim->commands++;
+    Command(cmd, x, y);
+}
+
+void Game::Command(int cmd, int x, int y){
+
+    switch(cmd){
+
+        case CMD_TOUCH:
+            if(phase == PHASE_NEW){
+                long long decision = EventLoop::NowUs() - roundStartUs;
+                mSim->decisions++;
+                mSim->decisionSumUs += decision;
+                if(decision > mSim->decisionMaxUs)
+                    mSim->decisionMaxUs = decision;
+
+                phase = PHASE_AIMING;
+                SendState(ROUND_AIMING_SHOT);
+            }
+            break;
+
+        case CMD_MOVE:
+            break;
+
+        case CMD_RELEASE:
+            if(phase == PHASE_AIMING)
+                Shoot(x, y);
+            break;
+
+        case CMD_FULLTOUCH:
+            if(phase == PHASE_END){
+                SendTouch(x, y, x, y);
+                mSim->timers->Cancel(&statusTimer);
+
+                if(state.lives == 0 || state.enemy == 0){
+                    phase = PHASE_GAME_OVER;
+                    SendState(ROUND_END_GAME);
+                    mSim->timers->Arm(&gameTimer, mSim->Scaled(SIM_GAME_OVER_MS));
+                }
+                else
+                    NewRound();
+            }
+            break;
+    }
+}
+
+void Game::OnTimer(Timer *timer){
+
+    switch(timer->id){
+
+        case TIMER_STATUS:
+            SendState(state.round);
+            break;
+
+        case TIMER_FLIGHT:{
+
+            //Scoring model
+            float tx = SLING_X + SHOT_GAIN * (SLING_X - xRelease);
+            float ty = SLING_Y + SHOT_GAIN * (SLING_Y - yRelease);
+
+            int left = 0;
+            for(int i=0; i<state.enemy; i++){
+                float dx = state.enemyLocation[2*i] - tx, dy = state.enemyLocation[2*i+1] - ty;
+                if(sqrtf(dx*dx + dy*dy) < HIT_RADIUS){
+                    state.score += HIT_SCORE;
+                    mSim->hits++;
+                }
+                else{
+                    state.enemyLocation[2*left] = state.enemyLocation[2*i];
+                    state.enemyLocation[2*left+1] = state.enemyLocation[2*i+1];
+                    left++;
+                }
+            }
+            state.enemy = left;
+            state.lives--;
+
+            phase = PHASE_END;
+            mSim->rounds++;
+            SendState(ROUND_END);
+            mSim->timers->Arm(&statusTimer, mSim->Scaled(SIM_STATUS_MS), mSim->Scaled(SIM_STATUS_MS));
+            break;
+        }
+        case TIMER_GAME:
+            NewGame();
+            break;
+    }
+}
+
+//----------------------------------------------------------------------
+//  Periodic report
+//----------------------------------------------------------------------
+class Reporter : public TimerHandler{
+public:
+    Simulation *mSim;
+    long long startMs;
+
+    void Report(){
+        double minutes = (EventLoop::NowMs() - startMs) / 60000.0;
+        printf("%lu rounds (%.0f/min), %lu games, %lu/%lu hits, %lu demonstrations, %lu commands (%lu malformed), decision avg %.1f max %.1f ms\n",
+               mSim->rounds, minutes > 0 ? mSim->rounds / minutes : 0.0, mSim->games, mSim->hits, mSim->shots, mSim->demos, mSim->commands, mSim->malformed,
+               mSim->decisions ? mSim->decisionSumUs / 1000.0 / mSim->decisions : 0.0, mSim->decisionMaxUs / 1000.0);
+        fflush(stdout);
+    }
+
+    virtual void OnTimer(Timer *timer){ Report(); }
+};
+
+int main(int argc, char *argv[])
+{
+    int numGames = 1;
+    const char *robotIP = "127.0.0.1";
+    int robotPort = SIM_ROBOT_PORT;
+    const char *bindIP = "0.0.0.0";
+    int port = SIM_PORT;
+    int seconds = 0;
+    unsigned seed = time(NULL);
+    int opt;
+
+    Simulation sim;
+    memset(&sim, 0, sizeof(sim));
+    sim.speed = 1.0;
+
+    while((opt = getopt(argc, argv, "g:r:b:p:x:u:ad:s:")) != -1){
+        switch(opt){
+            case 'g': numGames = atoi(optarg); break;
+            case 'r':{
+                char *colon = strchr(optarg, ':');
+                if(colon){
+                    *colon = 0;
+                    robotPort = atoi(colon + 1);
+                }
+                robotIP = optarg;
+                break;
+            }
+            case 'b': bindIP = optarg; break;
+            case 'p': port = atoi(optarg); break;
+            case 'x': sim.speed = atof(optarg); break;
+            case 'u': sim.demoPercent = atoi(optarg); break;
+            case 'a': sim.bAck = true; break;
+            case 'd': seconds = atoi(optarg); break;
+            case 's': seed = atoi(optarg); break;
+            default:
+                printf("usage: %s [-g games] [-r robot_ip[:port]] [-b bind_ip] [-p port] [-x speed] [-u demo_percent] [-a] [-d seconds] [-s seed]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if(numGames < 1 || sim.speed <= 0){
+        printf("games and speed must be positive\n");
+        return 1;
+    }
+
+    srand(seed);
+    signal(SIGINT, StopSignal);
+
+    memset(&sim.robot, 0, sizeof(sim.robot));
+    sim.robot.sin_family = AF_INET;
+    sim.robot.sin_addr.s_addr = inet_addr(robotIP);
+    sim.robot.sin_port = htons(robotPort);
+
+    EventLoop loop;
+    sim.timers = new TimerWheel(EventLoop::NowMs());
+
+    //One socket per game
+    vector< Game* > games;
+    for(int i=0; i<numGames; i++){
+
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = inet_addr(bindIP);
+        addr.sin_port = htons(port + i);
+
+        int fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if(bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0){
+            printf("Cannot bind %s:%d\n", bindIP, port + i);
+            return 1;
+        }
+
+        Game *game = new Game(&sim, fd);
+        loop.Add(fd, game);
+        games.push_back(game);
+    }
+
+    printf("%d games on %s:%d-%d, robot at %s:%d, %gx speed\n", numGames, bindIP, port, port + numGames - 1, robotIP, robotPort, sim.speed);
+
+    Reporter reporter;
+    reporter.mSim = &sim;
+    reporter.startMs = EventLoop::NowMs();
+    Timer reportTimer(&reporter, TIMER_REPORT);
+    sim.timers->Arm(&reportTimer, SIM_REPORT_MS, SIM_REPORT_MS);
+
+    for(unsigned i=0; i<games.size(); i++)
+        games[i]->NewGame();
+
+    long long endMs = seconds > 0 ? EventLoop::NowMs() + seconds * 1000LL : 0;
+
+    while(!bStop && (endMs == 0 || EventLoop::NowMs() < endMs)){
+
+        //Wait for commands until the next timer is due
+        long long next = sim.timers->NextDeadline();
+        long long wait = next ? next - EventLoop::NowMs() : 1000;
+        if(wait < 0)
+            wait = 0;
+
+        if(loop.Poll((int) wait) < 0)
+            break;
+        sim.timers->Advance(EventLoop::NowMs());
+    }
+
+    reporter.Report();
+
+    return 0;
+}
@@ -0,0 +1,207 @@
+/*
+ * TimerWheel.cpp
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Implementation of the hierarchical timer wheel for state machine deadlines and behavior scheduling.
+ * Last modified: 2026. 10. 18.
+ */
+
+#include "TimerWheel.h"
+
+//Ticks covered by the wheels below level l
+#define LEVEL_SPAN(l)   (1LL << (TIMER_WHEEL_BITS * (l)))
+
+Timer::Timer(TimerHandler *h, int timerID){
+
+    handler = h;
+    id = timerID;
+    expires = 0;
+    period = 0;
+    next = 0;
+    prev = 0;
+}
+
+TimerWheel::TimerWheel(long long nowMs){
+
+    for(int l=0; l<TIMER_WHEEL_LEVELS; l++)
+        for(int s=0; s<TIMER_WHEEL_SLOTS; s++)
+            wheel[l][s].next = wheel[l][s].prev = &wheel[l][s];
+
+    curTick = nowMs;
+    nPending = 0;
+}
+
+TimerWheel::~TimerWheel(){
+
+    //Leave the remaining timers disarmed
+    for(int l=0; l<TIMER_WHEEL_LEVELS; l++)
+        for(int s=0; s<TIMER_WHEEL_SLOTS; s++)
+            while(wheel[l][s].next != &wheel[l][s])
+                Cancel(wheel[l][s].next);
+}
+
+void TimerWheel::Arm(Timer *t, unsigned delayMs, unsigned periodMs){
+
+    Cancel(t);
+
+    t->expires = curTick + delayMs;
+    t->period = periodMs;
+
+    Insert(t);
+    nPending++;
+}
+
+void TimerWheel::Cancel(Timer *t){
+
+    if(!t->next)
+        return;
+
+    t->prev->next = t->next;
+    t->next->prev = t->prev;
+    t->next = 0;
+    t->prev = 0;
+
+    nPending--;
+}
+
+//Link t into the slot of the wheel covering its expiry
+void TimerWheel::Insert(Timer *t){
+
+    long long delta = t->expires - curTick;
+    Timer *head;
+
+    if(delta < 0){
+        //overdue: fire at the next processed tick
+        head = &wheel[0][curTick & TIMER_WHEEL_MASK];
+    }
+    else{
+        int l = 0;
+        while(l < TIMER_WHEEL_LEVELS-1 && delta >= LEVEL_SPAN(l+1))
+            l++;
+
+        if(delta >= LEVEL_SPAN(l+1))
+            t->expires = curTick + LEVEL_SPAN(l+1) - 1;     //clamp to the last wheel
+
+        head = &wheel[l][(t->expires >> (TIMER_WHEEL_BITS * l)) & TIMER_WHEEL_MASK];
+    }
+
+    t->next = head;
+    t->prev = head->prev;
+    head->prev->next = t;
+    head->prev = t;
+}
+
+//Move the timers of the current slot of a wheel down to the lower wheels. Returns the slot index.
+int TimerWheel::Cascade(int level){
+
+    int index = (curTick >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK;
+    Timer *head = &wheel[level][index];
+
+    while(head->next != head){
+        Timer *t = head->next;
+        head->next = t->next;
+        t->next->prev = head;
+        Insert(t);
+    }
+
+    return index;
+}
+
+int TimerWheel::Advance(long long nowMs){
+
+    int fired = 0;
+
+    while(curTick <= nowMs){
+
+        if(nPending == 0){
+            curTick = nowMs + 1;
+            break;
+        }
+
+        int index = curTick & TIMER_WHEEL_MASK;
+
+        //First wheel wrapped: bring down the timers of the upper wheels
+        if(index == 0){
+            int l = 1;
+            while(l < TIMER_WHEEL_LEVELS && Cascade(l) == 0)
+                l++;
+        }
+
+        //Detach the due slot, so that handlers may arm and cancel freely
+        Timer due;
+        Timer *head = &wheel[0][index];
+        if(head->next != head){
+            due.next = head->next;
+            due.prev = head->prev;
+            due.next->prev = &due;
+            due.prev->next = &due;
+            head->next = head;
+            head->prev = head;
+        }
+        else{
+            due.next = &due;
+            due.prev = &due;
+        }
+
+        while(due.next != &due){
+
+            Timer *t = due.next;
+            due.next = t->next;
+            t->next->prev = &due;
+            t->next = 0;
+            t->prev = 0;
+            nPending--;
+
+            if(t->period){
+                t->expires += t->period;
+                if(t->expires <= curTick)
+                    t->expires = curTick + 1;
+                Insert(t);
+                nPending++;
+            }
+
+            if(t->handler)
+                t->handler->OnTimer(t);
+            fired++;
+        }
+
+        curTick++;
+    }
+
+    return fired;
+}
+
+long long TimerWheel::NextDeadline(){
+
+    if(nPending == 0)
+        return 0;
+
+    long long best = -1;
+
+    //First wheel: exact expiry
+    for(int j=0; j<TIMER_WHEEL_SLOTS; j++){
+        Timer *head = &wheel[0][(curTick + j) & TIMER_WHEEL_MASK];
+        if(head->next != head){
+            best = curTick + j;
+            break;
+        }
+    }
+
+    //Upper wheels: the tick their first non-empty slot cascades at.
+    //On a wheel boundary the current slot is still to be cascaded by Advance().
+    for(int l=1; l<TIMER_WHEEL_LEVELS; l++){
+        long long base = curTick >> (TIMER_WHEEL_BITS * l);
+        int first = (curTick & (LEVEL_SPAN(l) - 1)) ? 1 : 0;
+        for(int j=first; j<first+TIMER_WHEEL_SLOTS; j++){
+            Timer *head = &wheel[l][(base + j) & TIMER_WHEEL_MASK];
+            if(head->next != head){
+                long long tick = (base + j) << (TIMER_WHEEL_BITS * l);
+                if(best < 0 || tick < best)
+                    best = tick;
+                break;
+            }
+        }
+    }
+
+    return best;
+}
@@ -0,0 +1,87 @@
+/*
+ * TimerWheel.h
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Declarations of the hierarchical timer wheel for state machine deadlines and behavior scheduling.
+ * Last modified: 2026. 10. 18.
+ */
+
+/*
+ * Timers are kept in TIMER_WHEEL_LEVELS wheels of TIMER_WHEEL_SLOTS slots with 1 msec ticks.
+ * A timer due within 64 msec sits in the first wheel, one due within 64^2 msec in the second,
+ * and so on; timers of an upper wheel slot move down (cascade) when the lower wheel wraps.
+ *
+ *  - Arm() and Cancel() are O(1): a timer is an intrusive list node owned by the caller.
+ *  - Advance() fires due timers on the thread calling it (the event loop thread).
+ *  - NextDeadline() tells when Advance() has work next, to arm a timerfd with it.
+ *  - Delays beyond the last wheel (about 12 days) are clamped to it.
+ */
+
+#ifndef _TIMERWHEEL_MODULE_H_
+#define _TIMERWHEEL_MODULE_H_
+
+#define TIMER_WHEEL_BITS    6
+#define TIMER_WHEEL_SLOTS   (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK    (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_LEVELS  5
+
+class Timer;
+
+//Receives the expiry of timers it was armed for.
+class TimerHandler{
+public:
+    virtual ~TimerHandler(){}
+    virtual void OnTimer(Timer *timer) = 0;
+};
+
+//----------------------------------------------------------------------
+//  Timer
+//      One-shot or periodic timer. Owned by the caller; must be cancelled before it is destroyed.
+//----------------------------------------------------------------------
+class Timer{
+
+public:
+    Timer(TimerHandler *h = 0, int timerID = 0);
+
+    TimerHandler *handler;
+    int id;                     //free for the handler, e.g. to tell its timers apart
+
+    bool IsArmed(){ return next != 0; }
+    long long Expires(){ return expires; }
+
+private:
+    friend class TimerWheel;
+
+    long long expires;          //tick (msec) the timer fires at
+    unsigned period;            //msec between periodic expiries, 0 for one-shot
+    Timer *next, *prev;         //slot list links, null when not armed
+};
+
+//----------------------------------------------------------------------
+//  TimerWheel
+//----------------------------------------------------------------------
+class TimerWheel{
+
+public:
+    TimerWheel(long long nowMs);
+    ~TimerWheel();
+
+    void Arm(Timer *t, unsigned delayMs, unsigned periodMs = 0);    //(Re)arm t to fire delayMs after the current tick.
+    void Cancel(Timer *t);                                          //Disarm t. Harmless if not armed.
+
+    int Advance(long long nowMs);       //Fire timers due up to nowMs. Returns the number fired.
+    long long NextDeadline();           //Earliest tick Advance() has work at. 0 if no timer is armed.
+
+    unsigned Pending(){ return nPending; }
+    long long Now(){ return curTick; }
+
+private:
+    Timer wheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];    //list heads
+    long long curTick;                  //next tick to process
+    unsigned nPending;
+
+    void Insert(Timer *t);
+    int Cascade(int level);
+};
+
+#endif
@@ -0,0 +1,143 @@
+/*
+ * TouchStream.cpp
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Implementation of the touch-drag streaming of synthesized gestures.
+ * Last modified: 2026. 10. 18.
+ */
+
+#include <unistd.h>
+#include <math.h>
+#include <iostream>
+
+#include "TouchStream.h"
+
+using std::cout;
+using std::endl;
+
+TouchStream::TouchStream(){
+
+    mLoop = NULL;
+    mSender = NULL;
+    timerfd = -1;
+    nRate = 0;
+
+    bRunning = false;
+    xFrom = yFrom = xTo = yTo = 0;
+    xLast = yLast = 0;
+    startUs = 0;
+    durationUs = 0;
+
+    nDrags = 0;
+    nMoves = 0;
+    nMissed = 0;
+}
+
+TouchStream::~TouchStream(){
+
+    //Closing the timerfd also removes it from the epoll set
+    if(timerfd >= 0)
+        close(timerfd);
+}
+
+bool TouchStream::Initialize(EventLoop *loop, CommandSender *sender, unsigned rate){
+
+    mLoop = loop;
+    mSender = sender;
+
+    if(rate > TOUCH_STREAM_MAX_HZ)
+        rate = TOUCH_STREAM_MAX_HZ;
+    nRate = rate;
+
+    if(nRate == 0)
+        return true;
+
+    timerfd = EventLoop::CreateTimer();
+    if(timerfd < 0 || !mLoop->Add(timerfd, this)){
+        cout << "Cannot create touch stream timer" << endl;
+        nRate = 0;
+        return false;
+    }
+
+    return true;
+}
+
+void TouchStream::Start(int x0, int y0, int x1, int y1, unsigned durationMs){
+
+    if(!IsEnabled())
+        return;
+
+    xFrom = x0;
+    yFrom = y0;
+    xTo = x1;
+    yTo = y1;
+    startUs = EventLoop::NowUs();
+    durationUs = (long long) durationMs * 1000;
+
+    mSender->Enqueue(CMD_TOUCH, x0, y0);
+    xLast = x0;
+    yLast = y0;
+
+    bRunning = true;
+    nDrags++;
+    EventLoop::ArmPeriodicTimer(timerfd, 1000000000LL / nRate);
+}
+
+void TouchStream::Finish(){
+
+    if(!bRunning)
+        return;
+
+    Move(xTo, yTo);
+    Cancel();
+}
+
+void TouchStream::Cancel(){
+
+    if(!bRunning)
+        return;
+
+    bRunning = false;
+    EventLoop::ArmPeriodicTimer(timerfd, 0);
+}
+
+void TouchStream::OnEvent(int fd){
+
+    unsigned long long expiries = EventLoop::Drain(fd);
+
+    if(!bRunning || expiries == 0)
+        return;
+
+    nMissed += expiries - 1;
+
+    long long elapsed = EventLoop::NowUs() - startUs;
+    if(elapsed >= durationUs){
+        Finish();
+        return;
+    }
+
+    //Ease in and out along the path
+    float t = (float) elapsed / durationUs;
+    float s = t * t * (3 - 2 * t);
+
+    Move(xFrom + (int) floorf((xTo - xFrom) * s + 0.5f), yFrom + (int) floorf((yTo - yFrom) * s + 0.5f));
+}
+
+void TouchStream::Move(int x, int y){
+
+    if(x == xLast && y == yLast)
+        return;
+
+    mSender->Enqueue(CMD_MOVE, x, y);
+    xLast = x;
+    yLast = y;
+    nMoves++;
+}
+
+void TouchStream::PrintStats(){
+
+    if(nDrags == 0)
+        return;
+
+    cout << "Streamed " << nDrags << " drags at " << nRate << " Hz: " << nMoves << " moves, " << nMissed << " timer expiries late" << endl;
+}
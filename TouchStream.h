@@ -0,0 +1,75 @@
+/*
+ * TouchStream.h
+ *
+ * Created on: 2026. 10. 18.
+ * Description: Declarations of the touch-drag streaming of synthesized gestures.
+ * Last modified: 2026. 10. 18.
+ */
+
+/*
+ * Instead of a touch at the aim point followed by a release, the finger goes down at the sling
+ * and is dragged to the aim point with "move x y" commands, so that the tablet sees the drag the
+ * arm performs.
+ *
+ *  - Moves are paced by a periodic timerfd at a configurable rate (e.g. 120 Hz) on the event loop.
+ *  - Each move is placed along the path by the time elapsed since Start() (ease-in/ease-out, like
+ *    the arm motion), so late or missed timer expiries do not slow the drag down.
+ *  - A move is sent only when the position changed. Commands go through the CommandSender ring;
+ *    nothing is allocated per move.
+ */
+
+#ifndef _TOUCHSTREAM_MODULE_H_
+#define _TOUCHSTREAM_MODULE_H_
+
+#include "EventLoop.h"
+#include "CommandSender.h"
+
+#define TOUCH_STREAM_MAX_HZ     1000
+
+//----------------------------------------------------------------------
+//  TouchStream
+//----------------------------------------------------------------------
+class TouchStream : public EventHandler{
+
+public:
+    TouchStream();
+    ~TouchStream();
+
+    // Stream through sender, paced on loop. rate 0 keeps streaming disabled.
+    bool Initialize(EventLoop *loop, CommandSender *sender, unsigned rate);
+
+    bool IsEnabled(){ return nRate > 0; }
+    bool IsRunning(){ return bRunning; }
+
+    // Touch at (x0,y0) and drag to (x1,y1) in durationMs.
+    void Start(int x0, int y0, int x1, int y1, unsigned durationMs);
+    // Finish the drag at its end point at once (before a release).
+    void Finish();
+    // Stop the drag where it is.
+    void Cancel();
+
+    virtual void OnEvent(int fd);
+
+    void PrintStats();
+
+    //Metrics
+    unsigned long nDrags;
+    unsigned long nMoves;               //moves sent
+    unsigned long nMissed;              //timer expiries handled late, merged into one move
+
+private:
+    EventLoop *mLoop;
+    CommandSender *mSender;
+    int timerfd;
+    unsigned nRate;                     //moves per second
+
+    bool bRunning;
+    int xFrom, yFrom, xTo, yTo;
+    int xLast, yLast;                   //last position sent
+    long long startUs;
+    long long durationUs;
+
+    void Move(int x, int y);
+};
+
+#endif
@@ -17,9 +17,10 @@
 using namespace std;
 using namespace Robot;
 
-int CBRLfD::nIDGenerator = 1;       //initialize static variable
+static volatile sig_atomic_t bDumpTrace = 0;    //set by SIGUSR1, served by the FSM thread
+static volatile sig_atomic_t bDumpLatency = 0;  //set by SIGUSR2, served by the FSM thread
 
-AngryDarwin::AngryDarwin(){
+AngryDarwin::AngryDarwin(int robotID){
     
     //////////////////// Socket Initialize ////////////////////////////
     ftsockfd=socket(AF_INET,SOCK_DGRAM,0);
@@ -40,6 +41,7 @@ AngryDarwin::AngryDarwin(){
     //////////////////// Framework Initialize ////////////////////////////
     change_current_dir();
     Action::GetInstance()->LoadFile(MOTION_FILE_PATH);
+    mPages.Load(MOTION_FILE_PATH);
     
     linux_cm730 =  new LinuxCM730("/dev/ttyUSB0");
     cm730 = new CM730(linux_cm730);
@@ -48,44 +50,85 @@ AngryDarwin::AngryDarwin(){
         cout << "Fail to initialize Motion Manager!" << endl;
     
     MotionManager::GetInstance()->AddModule((MotionModule*)Action::GetInstance());
+    MotionManager::GetInstance()->AddModule((MotionModule*)MotionWatcher::GetInstance());
+    
+    mLeds = new LedController(cm730);
+    MotionManager::GetInstance()->AddModule((MotionModule*)mLeds);
     
     motion_timer = new LinuxMotionTimer(MotionManager::GetInstance());
     motion_timer->Start();
     
     MotionManager::GetInstance()->SetEnable(true);
     
-    Action::GetInstance()->Start(85);    // Init(sit down) pose
-    while(Action::GetInstance()->IsRunning()) usleep(8*1000);
     //////////////////////////////////////////////////////////////////////
     
-    mCBR = new CBRLfD();
+    mCBR = new CBRLfD(robotID);
+    mReplicator = NULL;
+    bOfferBinary = false;
+    mesg = "";
+    mReceived = NULL;
+    bDeciding = false;
+    decisionProblem = NULL;
+    nDecision = nDecisionSeq = nQueueDecision = 0;
     
 	state = STATE_ROUND_READY;
     prevstate = state;
     
-    prevStatePacket.resize(2);
 	curCase = NULL;
     
     bIdle = true;
-    idlecount = 0;
     srand(time(NULL));
     timeout = rand() % IDLE_TIMEOUT + IDLE_TIMEOUT_OFFSET;
     
-    //initialize idle thread
-    bSuspendSubThread = true;
-    pthread_create(&thread_t, NULL, Idle_thread, this);
-    
+    //Event sources of the state machine: tablet packets, timers and motion completion
+    mTimers = new TimerWheel(EventLoop::NowMs());
+    idleTimer.handler = settleTimer.handler = stepTimer.handler = gestureTimer.handler = this;
+    mTimers->Arm(&idleTimer, timeout * 1000);
+    
+    timerfd = EventLoop::CreateTimer();
+    mProtocol.SetAckListener(&mSender);
+    mSender.SetLatency(&mLatency);
+    mSender.Start(ttsockfd, addr2, &mProtocol);
+    PacketBatch::EnableTimestamps(ftsockfd);
+    mReceiver.Start(ftsockfd, &mProtocol);
+    mPreAim.Start(mCBR, AimJoints);
+    signal(SIGUSR2, DumpLatencySignal);
+    mLoop.Add(mReceiver.GetFd(), this);
+    mLoop.Add(timerfd, this);
+    mLoop.Add(MotionWatcher::GetInstance()->GetFd(), this);
+    mLoop.Add(mPreAim.GetFd(), this);
+    
+    nRunningStep = STEP_NONE;
+    nRunningPage = 0;
+    nRunningDecision = 0;
+    QueueMotion(85);        // Init(sit down) pose
+    RunMotionQueue();
+    UpdateDeadlines();
+    
+    //Idle behavior is scheduled on the event loop, suspended until resumed
+    bIdleBehavior = false;
+    cpuMarkUs = EventLoop::CpuUs();
+    cpuMarkFsmUs = EventLoop::CpuUs(true);
+    cpuMarkWallUs = EventLoop::NowUs();
 }
 
 AngryDarwin::~AngryDarwin(){
     
     cout<<"kill AngryDarwin"<<endl;
     
-    if(thread_t)
-        pthread_exit(0);
+    mPreAim.Stop();
+    mPages.Stop();
     
+    if(mReplicator)
+        delete mReplicator;
+    if(mTimers)
+        delete mTimers;
     if(mCBR)
         delete mCBR;
+    if(mLeds){
+        MotionManager::GetInstance()->RemoveModule((MotionModule*)mLeds);
+        delete mLeds;
+    }
     if(linux_cm730)
         delete linux_cm730;
     if(cm730)
@@ -97,408 +140,886 @@ AngryDarwin::~AngryDarwin(){
     
 }
 
-//Execute finite-state machine(FSM)
+//Stream retained cases to peer robots and merge the cases they retain.
+bool AngryDarwin::StartReplication(int port, const vector< string > &peers){
+    
+    mReplicator = new CaseReplicator(mCBR->nRobotID, mCBR->nEpoch, port);
+    
+    for(unsigned i=0; i<peers.size(); i++){
+        vector< string > addr;
+        boost::algorithm::split( addr, peers[i], boost::is_any_of(":") );
+        
+        if(addr.size() == 2)
+            mReplicator->AddPeer(addr[0].c_str(), atoi(addr[1].c_str()));
+        else
+            cout << "Invalid peer address " << peers[i] << endl;
+    }
+    
+    if(!mReplicator->Start()){
+        delete mReplicator;
+        mReplicator = NULL;
+        return false;
+    }
+    
+    mCBR->SetListener(mReplicator);
+    
+    return true;
+}
+
+//Rebuild the case base from demonstration logs written by previous sessions.
+int AngryDarwin::LoadDemonstrationLogs(const vector< string > &logs){
+    
+    LogIngest ingest;
+    
+    mPreAim.LockCases();
+    int stored = ingest.Ingest(logs, mCBR);
+    mPreAim.UnlockCases(stored > 0);
+    
+    cout << "Loaded " << stored << " cases from " << logs.size() << " log(s) in " << (ingest.parseTime + ingest.loadTime) * 1000 << " ms" << endl;
+    
+    return stored;
+}
+
+void AngryDarwin::EnableBinaryProtocol(){
+    
+    char offer[PACKET_SIZE];
+    
+    bOfferBinary = true;
+    
+    int size = mProtocol.Offer(offer);
+    sendto(ttsockfd,offer,size,0,(struct sockaddr *)&addr2,sizeof(addr2));
+    mCapture.Record(CAPTURE_OUTBOUND, EventLoop::NowUs(), offer, size);
+}
+
+bool AngryDarwin::EnableCapture(const char *path){
+    
+    if(!mCapture.Open(path))
+        return false;
+    
+    mReceiver.SetCapture(&mCapture);
+    mSender.SetCapture(&mCapture);
+    
+    return true;
+}
+
+void AngryDarwin::SetTabletAddress(const char *ip, int port){
+    
+    addr2.sin_addr.s_addr = inet_addr(ip);
+    addr2.sin_port = htons(port);
+    
+    mSender.SetAddress(addr2);
+}
+
+bool AngryDarwin::EnableTouchStream(unsigned rate){
+    
+    return mStream.Initialize(&mLoop, &mSender, rate);
+}
+
+//Keep structured traces of the last capacity retrievals. Dumped to the log on SIGUSR1.
+void AngryDarwin::EnableRetrievalTrace(unsigned capacity){
+    
+    mCBR->EnableTrace(capacity);
+    signal(SIGUSR1, DumpTraceSignal);
+}
+
+void AngryDarwin::DumpTraceSignal(int sig){
+    bDumpTrace = 1;
+}
+
+//Serve the decision latency table on a unix socket (e.g. nc -U path).
+bool AngryDarwin::EnableLatencySocket(const char *path){
+    
+    if(!mLatency.Listen(path))
+        return false;
+    
+    return mLoop.Add(mLatency.GetFd(), this);
+}
+
+void AngryDarwin::SetSettleTime(unsigned windowMs, unsigned maxMs){
+    
+    mSettle.Configure(windowMs, maxMs);
+}
+
+void AngryDarwin::SetPageWriteBack(bool bWriteBack){
+    
+    if(bWriteBack)
+        mPages.StartWriteBack();
+    else
+        mPages.Stop();
+}
+
+void AngryDarwin::DumpLatencySignal(int sig){
+    bDumpLatency = 1;
+}
+
+//Execute finite-state machine(FSM) on the event loop
 void AngryDarwin::RunStateMachine(){
     
-    //Receive task-status packet from tablet
-    len = sizeof(ftaddr);
-    n = recvfrom(ftsockfd,mesg,1000,0,(struct sockaddr *)&ftaddr,&len);
-    mesg[n] = 0;
+    mLoop.Run();
+}
+
+//Handle the packets queued by the receiver thread, skipping superseded states
+void AngryDarwin::HandlePackets(){
     
-    //Split packet to string vector
-    packet = SplitPacket(mesg);
+    EventLoop::Drain(mReceiver.GetFd());
+    
+    ReceivedPacket *r;
+    while((r = mReceiver.Next()) != NULL){
+        
+        //Repeat the binary protocol offer every new round until the tablet accepts
+        if(bOfferBinary && !mProtocol.bBinary && !r->bFrame && r->bParsed && r->packet.kind == PACKET_STATE && r->packet.round == ROUND_TRANS_NEW)
+            EnableBinaryProtocol();
+        
+        ReceivedPacket *next = mReceiver.Following();
+        if(next && PacketBatch::Supersedes(*next, *r)){
+            mReceiver.Pop(true);
+            continue;
+        }
+        
+        mesg = r->text;
+        n = r->size;
+        ftaddr = r->from;
+        packet = r->packet;
+        mReceived = r;
+        
+        HandlePacket(r->bParsed);
+        
+        mesg = "";
+        mReceived = NULL;
+        mReceiver.Pop();
+    }
+}
+
+//Handle a packet received from tablet
+void AngryDarwin::HandlePacket(bool bParsed){
+    
+    //Ignore malformed packets, protocol control frames and stale states
+    if(!bParsed){
+        cout << "Ignored packet: " << mesg << endl;
+        return;
+    }
     
     //Received packet either starts with "state" for task status, and "usertouch" for touch event.
-    if(packet.at(0)=="state"){
+    if(packet.kind == PACKET_STATE){
         
         prevStatePacket = packet;
-        if(packet.at(5)=="trans_new_round")
+        if(packet.round == ROUND_TRANS_NEW && !mSettle.IsSettling())  //a settling round is finished first
             state = STATE_ROUND_READY;
+        
+        //The layout of the next round is known before it opens: plan the aim meanwhile
+        if(packet.round == ROUND_TRANS_NEW || packet.round == ROUND_END){
+            Problem *next = buildProblem(packet);
+            mPreAim.Speculate(next);
+            delete next;
+        }
+    }
+    
+    cout << "Current State: " << state << ", Received the following: " << mesg << endl;
+    cout << "Case-base Size: " << mCBR->casebase.size() << "\n" << endl;
+    
+    
+#ifdef DEBUG
+    LOG::write_log(mesg);
+#endif
+    
+    int next = stateTable.Dispatch(this, state, PacketEvent());
+    if(next != FSM_SAME)
+        state = next;
+}
+
+//Receipt of the packet being handled (usec, CLOCK_MONOTONIC): by the kernel if stamped. Now if none.
+long long AngryDarwin::ReceivedUs(){
+    
+    if(!mReceived)
+        return EventLoop::NowUs();
+    
+    return mReceived->kernelStamp ? mReceived->kernelStamp : mReceived->stamp;
+}
+
+//State machine event of the packet being handled.
+int AngryDarwin::PacketEvent(){
+    
+    if(packet.kind == PACKET_STATE)
+        return packet.round;                //EVENT_* of a state packet are its ROUND_STATES
+    
+    //A usertouch inside the tablet touch limit is a demonstration
+    int x = packet.touch[2];
+    int y = packet.touch[3];
+    
+    if((x <= xHighLimit) && (x >= xLowLimit) && (y <=yHighLimit) && (y >= yLowLimit))
+        return EVENT_DEMONSTRATION;
+    
+    return EVENT_TOUCH;
+}
+
+//State machine transitions (GameStates.h), compiled once. make statecheck walks the same rules without hardware.
+const StateTable< AngryDarwin, STATE_COUNT, EVENT_COUNT > AngryDarwin::stateTable(GameRules< AngryDarwin >::rules, GameRules< AngryDarwin >::Count());
+
+//Suspend idle behavior. A gesture already playing finishes.
+void AngryDarwin::SuspendIdle(){
+    
+    bIdleBehavior = false;
+    mTimers->Cancel(&gestureTimer);
+}
+
+//Resume idle behavior: neutral gestures one after another until suspended.
+void AngryDarwin::ResumeIdle(){
+    
+    if(bIdleBehavior)
+        return;
+    
+    bIdleBehavior = true;
+    mTimers->Arm(&gestureTimer, IDLE_GESTURE_GAP_MS);
+}
+
+//Idle gesture due: play it when the robot is free, otherwise try again later.
+void AngryDarwin::PlayIdleGesture(){
+    
+    if(!bIdleBehavior)
+        return;
+    
+    if(nRunningStep != STEP_NONE || !motionQueue.empty() || Action::GetInstance()->IsRunning()){
+        mTimers->Arm(&gestureTimer, IDLE_GESTURE_RETRY_MS);
+        return;
     }
     
-    //If FSM is stuck on some state, increase idle count.
-    //If the count exceeds timeout, enter idle thread.
-    if(prevstate == state) idlecount++;
-    else    idlecount = 0;
+    int r,g,b;
+    
+    r = rand()%255;
+    g = rand()%255;
+    b = rand()%255;
+    
+    mLeds->Set(LED_HEAD, r, g, b);
+    
+    r = rand()%255;
+    g = rand()%255;
+    b = rand()%255;
+    
+    mLeds->Set(LED_EYE, r, g, b);
+    
+    QueueMotion(Behavior::GetInstance()->RetrieveRandomGesture(Behavior::NEUTRAL), Behavior::GetInstance()->RetrieveRandomSpeech(Behavior::NEUTRAL));
+    QueueAction(ACTION_IDLE_GESTURE_DONE);
+}
+
+//CPU usage since the last report, in % of one core: the whole process and the state machine thread.
+void AngryDarwin::PrintCpuUsage(){
+    
+    long long wall = EventLoop::NowUs();
+    long long cpu = EventLoop::CpuUs();
+    long long fsm = EventLoop::CpuUs(true);
+    
+    if(wall > cpuMarkWallUs)
+        cout << "CPU usage: process " << 100.0 * (cpu - cpuMarkUs) / (wall - cpuMarkWallUs) << "%, state machine thread "
+             << 100.0 * (fsm - cpuMarkFsmUs) / (wall - cpuMarkWallUs) << "% over " << (wall - cpuMarkWallUs) / 1000 << " ms" << endl;
+    
+    cpuMarkUs = cpu;
+    cpuMarkFsmUs = fsm;
+    cpuMarkWallUs = wall;
+}
+
+//Every event of STATE_ROUND_READY: get ready (and greet when restarting from idle).
+void AngryDarwin::EnterRoundReady(){
     
-    if (idlecount > timeout){
-        state = STATE_IDLE;
-        idlecount = 0;
-        bIdle = true;
+    SuspendIdle();
+    
+    //Restarting from idle state
+    if(bIdle){
+        
+        //Produce start up behavior
+        QueueMotion(Behavior::GetInstance()->RetrieveRandomGesture(Behavior::STARTUP), Behavior::GetInstance()->RetrieveRandomSpeech(Behavior::STARTUP));
         
-        timeout = rand() % 15 + 7;
+        bIdle = false;
     }
     
-    prevstate = state;
+    curCase = NULL;
     
-    cout << "Current State: " << state << ", Received the following: " << mesg << endl;
-    cout << "Case-base Size: " << mCBR->casebase.size() << "\n" << endl;
+    QueueMotion(85);                //default sitting pose, after the current motion
+}
+
+//The user touched inside the tablet touch limit: record the demonstration as the case of this round.
+void AngryDarwin::RecordDemonstration(){
     
+    cout << "\n=================================================================================" << endl;
+    cout << "Demonstration Recording Begin" << endl;
+#ifdef DEBUG
+    LOG::write_log("[Demonstration Recording Begin]");
+#endif
+    
+    //Create problem description from the last task status, solution from the touch
+    curCase = buildCase(prevStatePacket, packet);
+}
+
+//Demonstration before the robot aims. Idle behavior may run while the round plays out.
+void AngryDarwin::Demonstrate(){
+    
+    RecordDemonstration();
+    ResumeIdle();
+}
+
+//Touch while the robot aims: stop aiming and sit back.
+void AngryDarwin::InterruptShot(){
+    
+    CancelDecision();
+    QueueMotion(85);
+    QueueAction(ACTION_RESUME_IDLE);
+}
+
+//Demonstration while the robot aims.
+void AngryDarwin::DemonstrateInShot(){
+    
+    InterruptShot();
+    RecordDemonstration();
+}
+
+//Task status while aiming: retrieve and reuse a solution (or self train), and aim at it.
+void AngryDarwin::Decide(){
+    
+    //The decision starts with this packet
+    if(mReceived)
+        mLatency.Begin(*mReceived);
+    
+    //Build problem description from packet
+    Problem *prob = buildProblem(packet);
+    
+    //RETRIEVE and REUSE on the worker: planned ahead for this very layout, or delivered to
+    //HandleDecision() while the state machine goes on. ACTION_AIM waits for it.
+    AimPlan plan;
+    decisionProblem = prob;
+    if(mPreAim.Decide(prob, plan)){
+        mLatency.Mark(STAGE_RETRIEVE, plan.retrievedUs);
+        mLatency.Mark(STAGE_REUSE, plan.reusedUs);
+        Aim(plan);
+    }
+    else
+        bDeciding = true;
+    
+    //The aim steps carry the decision, so that a usertouch takes back exactly them
+    nDecision = ++nDecisionSeq;
+    nQueueDecision = nDecision;
+    QueueAim();
+    nQueueDecision = 0;
+}
+
+//The worker decided: aim at its solution
+void AngryDarwin::HandleDecision(){
+    
+    AimPlan plan;
+    if(!mPreAim.TakeDecision(plan) || !bDeciding)
+        return;                             //cancelled meanwhile
+    
+    bDeciding = false;
+    mLatency.Mark(STAGE_RETRIEVE, plan.retrievedUs);    //stamped on the worker
+    mLatency.Mark(STAGE_REUSE, plan.reusedUs);
     
 #ifdef DEBUG
-    LOG::write_log(mesg);
+    if(mCBR->GetTrace()){
+        mPreAim.LockCases();
+        mCBR->GetTrace()->DumpLast();
+        mPreAim.UnlockCases(false);
+    }
 #endif
     
-    switch (state){
-            
-            //Initial task state
-        case STATE_ROUND_READY:{
-            
-            bSuspendSubThread = true;       //suspend idle thread
-            while(Action::GetInstance()->IsRunning()) usleep(8*1000);   //give robot some time to finish its motion
-            
-            //Restarting from idle state
-            if(bIdle){
-                
-                //Produce start up behavior
-                Action::GetInstance()->Start(Behavior::GetInstance()->RetrieveRandomGesture(Behavior::STARTUP));
-                LinuxActionScript::PlayMP3(Behavior::GetInstance()->RetrieveRandomSpeech(Behavior::STARTUP));
-                
-                while(Action::GetInstance()->IsRunning()) usleep(8*1000);   //give robot some time to finish its motion
-                
-                bIdle = false;
-            }
-            
-            curCase = NULL;
-            
-            Action::GetInstance()->Start(85);                           //default sitting pose
-            while(Action::GetInstance()->IsRunning()) usleep(8*1000);   //give robot some time to finish its motion
-            
-            //If packet starts with "usertouch", the user interrupted and is attempting to provide demonstration.
-            if(packet.at(0)=="usertouch"){
-                int x = atoi(packet.at(3).c_str());     //extract x-coordination of touch event
-                int y = atoi(packet.at(4).c_str());     //extract y-coordination of touch event
-                
-                //Check if touch event is inside tablet touch limit
-                if((x <= xHighLimit) && (x >= xLowLimit) && (y <=yHighLimit) && (y >= yLowLimit)){
-                    cout << "=================================================================================" << endl;
-                    cout << "Demonstration Recording Begin" << endl;
-                    
+    Aim(plan);
+}
+
+//Take the solution of the decision, or start self training if no case was retrieved.
+void AngryDarwin::Aim(const AimPlan &plan){
+    
+    Problem *prob = decisionProblem;
+    decisionProblem = NULL;
+    
+    //Solution and aim joint targets planned by the worker
+    if(plan.bRetrieved){
+        
+        xCoord = plan.xTouch;
+        yCoord = plan.yTouch;
+        aimJoints = plan.joints;
+        
+        delete prob;
+        return;
+    }
+    
+    //If no case is retrieved, start self training
+    Solution *sol = new Solution();
+    
+    xCoord = rand() % 200;
+    yCoord = rand() % 200 + 95;
+    aimJoints.clear();                      //computed by ACTION_AIM
+    
+    sol->xTouch = xCoord;
+    sol->yTouch = yCoord;
+    
+    if (SELF_TRAIN){
+        cout << "\n=================================================================================" << endl;
+        cout << "SELF TRAINING Recording Begin" << endl;
 #ifdef DEBUG
-                    LOG::write_log("[Demonstration Recording Begin]");
+        LOG::write_log("[Self Training Recording Begin]");
 #endif
-                    
-                    if(curCase) curCase = NULL;
-                    
-                    //Create problem description from packet
-                    curCase = buildCase(prevStatePacket, packet);
-                    
-                    state = STATE_ROUND_END;
-                    bSuspendSubThread = false;
-                    
-                }
-            }
-            //If packet starts with "state", regular task-status is received.
-            else if(packet.at(0)=="state"){
-                if(packet.at(5)=="state_new_round"){
-                    state = STATE_AIM;
-                }
-                else if((packet.at(5)=="state_end_round") || (packet.at(5)=="trans_call_round")){
-                    state = STATE_ROUND_END;
-                }
-                else if(packet.at(5)=="state_end_game")
-                    state = STATE_GAME_END;
-                
-            }
+        
+        curCase = buildCase(prob, sol);     //the case owns prob and sol
+        return;
+    }
+    
+    delete prob;
+    delete sol;
+}
+
+//Abort the decision in progress and the aim queued for it, whether or not the decision was delivered.
+void AngryDarwin::CancelDecision(){
+    
+    if(bDeciding){
+        
+        //Preemption latency counts from the receipt of the packet that preempts
+        mPreAim.Cancel(ReceivedUs());
+        bDeciding = false;
+        
+        delete decisionProblem;
+        decisionProblem = NULL;
+    }
+    
+    if(nDecision == 0)
+        return;
+    
+    //Aim steps of the decision only: steps queued before it (e.g. a startup gesture) still play
+    for(std::deque< MotionStep >::iterator it = motionQueue.begin(); it != motionQueue.end(); ){
+        if(it->decision == nDecision)
+            it = motionQueue.erase(it);
+        else
+            ++it;
+    }
+    
+    //The hold after the aiming motion
+    if(nRunningStep == STEP_DELAY && nRunningDecision == nDecision){
+        mTimers->Cancel(&stepTimer);
+        nRunningStep = STEP_NONE;
+    }
+    
+    nDecision = 0;
+    
+    //No touch of the aim reaches the tablet after the user's
+    mStream.Cancel();
+    mSender.Drop(CMD_TOUCH);
+    mSender.Drop(CMD_MOVE);
+}
+
+//Queue the aiming motion and the touch at (xCoord, yCoord).
+void AngryDarwin::QueueAim(){
+    
+    QueueAction(ACTION_AIM);        //compute embodiment joint mapping for aiming
+    if(mStream.IsEnabled()){
+        QueueAction(ACTION_TOUCH);  //touch at the sling and drag along with the aiming motion
+        QueueMotion(80);            //start aiming motion
+    }
+    else{
+        QueueMotion(80);            //start aiming motion
+        QueueAction(ACTION_TOUCH);  //send touch event command to tablet
+    }
+    QueueDelay(AIM_HOLD_MS);
+}
+
+//The game is ready for the shot: shoot.
+void AngryDarwin::Shoot(){
+    
+    QueueMotion(93);                //start shooting motion
+    QueueAction(ACTION_RELEASE);    //send release command to tablet, compute joint mapping for shooting
+    
+    //Generate behavior (speech and gesture)
+    QueueMotion(82, Behavior::GetInstance()->RetrieveRandomSpeech(Behavior::SHOOT));
+}
+
+//End of round reported: delay until all game physics are settled, i.e. the score stays the same
+//for the settle window (or the max wait passes). settleTimer finishes the round.
+void AngryDarwin::Settle(){
+    
+    mTimers->Arm(&settleTimer, mSettle.Update(packet.score, ReceivedUs()));
+    settlePacket = packet;
+    
+    cout << "STATE_ROUND_END waiting for timeout." << endl;
+}
+
+//Settle deadline: finish the round if settled. The deadline is only missed by timer granularity.
+void AngryDarwin::SettleTimeout(){
+    
+    long long now = EventLoop::NowUs();
+    int reason = mSettle.SettledBy(now);
+    
+    if(reason != SETTLE_NONE)
+        FinishRound(settlePacket, reason);
+    else if(mSettle.IsSettling())
+        mTimers->Arm(&settleTimer, mSettle.Update(settlePacket.score, now));
+}
+
+//New round in STATE_ROUND_READY: the round opens.
+void AngryDarwin::OpenRound(){
+    
+    mSettle.NextRound(ReceivedUs());
+}
+
+//Other task status after the end of round: the round is over.
+void AngryDarwin::EndRound(){
+    
+    if(mSettle.IsSettling() || (packet.round == ROUND_END_GAME))
+        FinishRound(packet, SETTLE_STATUS);
+}
+
+//Touch after the end of round: the user moves on.
+void AngryDarwin::EndRoundOnTouch(){
+    
+    if(mSettle.IsSettling())
+        FinishRound(settlePacket, SETTLE_TOUCH);
+}
+
+//Round is over: revise and retain the recorded case, generate behavior and proceed to new round.
+void AngryDarwin::FinishRound(const TabletPacket &packet, int reason){
+    
+    mSettle.Finish(reason, ReceivedUs());
+    mTimers->Cancel(&settleTimer);
+    
+    mReceiver.PrintStats();
+    mSender.PrintStats();
+    mStream.PrintStats();
+    mPreAim.PrintStats();
+    mSettle.PrintStats();
+    mLeds->PrintStats();
+    mPages.PrintStats();
+    PrintCpuUsage();
+    
+    if(curCase){
+        
+        //REVISE: Update score in problem descriptor.
+        curCase->mProblem->score = packet.score - curCase->mProblem->score;  //update score
+        mCBR->Revise(curCase->mProblem, curCase->mSolution);
+        
+        //RETAIN: Check condition for retaining.
+        mPreAim.LockCases();
+        mCBR->Retain(curCase);
+        mPreAim.UnlockCases(true);
+        
+        cout << "===DEMONSTRATION DATA SAVED==== Score is " << curCase->mProblem->score << "====================================================\n\n" << endl;
+#ifdef DEBUG
+        stringstream sstm;
+        
+        sstm << "ID: " << curCase->ID << endl;
+        sstm << "Problem: level(" << curCase->mProblem->level << ") round(" << curCase->mProblem->round << ") enemy(" << curCase->mProblem->enemy << ") enemy locations (";
+        
+        for (int i=0; i< curCase->mProblem->enemy; i++){
             
-            break;
+            sstm <<"(" << curCase->mProblem->enemyLocation[2*i] << "," << curCase->mProblem->enemyLocation[2*i+1] << ") ";
         }
-            
-        case STATE_AIM:{
-            
-            bSuspendSubThread = true;
-            
-            //User is attempting to provide demonstration. Start recording demonstration
-            if(packet.at(0)=="usertouch"){
-                
-                int x = atoi(packet.at(3).c_str());
-                int y = atoi(packet.at(4).c_str());
-                
-                if((x <= xHighLimit) && (x >= xLowLimit) && (y <=yHighLimit) && (y >= yLowLimit)){
-                    cout << "\n=================================================================================" << endl;
-                    cout << "Demonstration Recording Begin" << endl;
-#ifdef DEBUG
-                    LOG::write_log("[Demonstration Recording Begin]");
+        
+        sstm << ") score(" << curCase->mProblem->score << ")" << endl;
+        
+        sstm << "  Solution: x(" << curCase->mSolution->xTouch << ") y(" <<curCase->mSolution->yTouch << ")" << endl;
+        
+        LOG::write_log(sstm.str());
 #endif
-                    if(curCase) curCase = NULL;
-                    
-                    curCase = buildCase(prevStatePacket, packet);
-                    
-                    state = STATE_ROUND_END;
-                    bSuspendSubThread = false;
-                }
-            }
-            else if(packet.at(0)=="state"){
-                
-                char command[1000] = { 0 };
+    }
+    
+    mLeds->Set(LED_EYE, 0, 0, 255);
+    mLeds->Set(LED_HEAD, 0, 255, 0);
+    
+    state = RoundEndHandler(state, packet);     //Handle end of round condition
+    
+    QueueAction(ACTION_FULLTOUCH);              //send command to proceed to new round, after the behavior
+}
+
+//Dispatch events of the state machine's event loop
+void AngryDarwin::OnEvent(int fd){
+    
+    //Merge cases retained by peer robots since the last event
+    if(mReplicator){
+        mPreAim.LockCases();
+        int merged = mReplicator->MergePending(mCBR);
+        mPreAim.UnlockCases(merged > 0);
+    }
+    
+    //Serve a trace dump requested by SIGUSR1
+    if(bDumpTrace && mCBR->GetTrace()){
+        bDumpTrace = 0;
+        mPreAim.LockCases();
+        mCBR->GetTrace()->Dump();
+        mPreAim.UnlockCases(false);
+    }
+    
+    //Print the decision latency table requested by SIGUSR2
+    if(bDumpLatency){
+        bDumpLatency = 0;
+        cout << mLatency.Format();
+        PrintCpuUsage();
+    }
+    
+    //Fire due timers first, so that timers armed by the handlers count from now
+    mTimers->Advance(EventLoop::NowMs());
+    
+    if(fd == mReceiver.GetFd())
+        HandlePackets();
+    else if(fd == timerfd)
+        HandleTimer();
+    else if(fd == MotionWatcher::GetInstance()->GetFd())
+        HandleMotionDone();
+    else if(fd == mLatency.GetFd())
+        mLatency.Serve();
+    else if(fd == mPreAim.GetFd())
+        HandleDecision();
+    
+    RunMotionQueue();
+    UpdateDeadlines();
+}
+
+//Deadline timer expired
+void AngryDarwin::HandleTimer(){
+    
+    //Due timers are fired by OnEvent()
+    EventLoop::Drain(timerfd);
+}
+
+//An Action page finished
+void AngryDarwin::HandleMotionDone(){
+    
+    EventLoop::Drain(MotionWatcher::GetInstance()->GetFd());
+    
+    //The notification may be stale: a new page may have started since
+    if(nRunningStep == STEP_MOTION && !Action::GetInstance()->IsRunning())
+        EndMotionStep();
+}
+
+//Timer expiry (TimerHandler)
+void AngryDarwin::OnTimer(Timer *timer){
+    
+    if(timer == &idleTimer)
+        EnterIdle();                        //FSM is stuck on some state: enter idle
+    else if(timer == &settleTimer)
+        SettleTimeout();
+    else if(timer == &stepTimer && nRunningStep == STEP_DELAY)
+        nRunningStep = STEP_NONE;
+    else if(timer == &gestureTimer)
+        PlayIdleGesture();
+}
+
+//Queue a motion page (with speech) to start when the previous motion steps are done.
+void AngryDarwin::QueueMotion(int page, const char *speech){
+    
+    //Repeated requests for the same pose collapse into one
+    if(!speech && !motionQueue.empty() && motionQueue.back().type == STEP_MOTION && motionQueue.back().arg == page && !motionQueue.back().speech && motionQueue.back().decision == nQueueDecision)
+        return;
+    
+    MotionStep step = { STEP_MOTION, page, speech, nQueueDecision };
+    motionQueue.push_back(step);
+}
+
+//Queue a pause of the motion steps.
+void AngryDarwin::QueueDelay(unsigned ms){
+    
+    MotionStep step = { STEP_DELAY, (int) ms, NULL, nQueueDecision };
+    motionQueue.push_back(step);
+}
+
+//Queue an FSM action to run when the previous motion steps are done.
+void AngryDarwin::QueueAction(int action){
+    
+    MotionStep step = { STEP_ACTION, action, NULL, nQueueDecision };
+    motionQueue.push_back(step);
+}
+
+//Run queued steps until one has to wait for a motion or a delay.
+void AngryDarwin::RunMotionQueue(){
+    
+    //Completion notifications are edge-triggered: never wait on a motion that is over
+    if(nRunningStep == STEP_MOTION && !Action::GetInstance()->IsRunning())
+        EndMotionStep();
+    
+    while(nRunningStep == STEP_NONE && !motionQueue.empty()){
+        
+        MotionStep step = motionQueue.front();
+        
+        switch(step.type){
                 
-                //Build problem description from packet
-                Problem *prob = buildProblem(packet);
-                Solution *sol = new Solution();
+            case STEP_MOTION:
                 
-                //RETRIEVE the nearest cases from the new problem
-                caseVector result = mCBR->Retrieve(prob);
+                //Another motion is still playing. Wait for its completion.
+                if(Action::GetInstance()->IsRunning())
+                    return;
                 
-                //If no case is retrieved, start self training
-                if(result.size() == 0){
-                    
-                    xCoord = rand() % 200;
-                    yCoord = rand() % 200 + 95;
-                    
-                    sol->xTouch = xCoord;
-                    sol->yTouch = yCoord;
-                    
-                    if (SELF_TRAIN){
-                        cout << "\n=================================================================================" << endl;
-                        cout << "SELF TRAINING Recording Begin" << endl;
-#ifdef DEBUG
-                        LOG::write_log("[Self Training Recording Begin]");
-#endif
-                        
-                        if(curCase) curCase = NULL;
-                        
-                        curCase = buildCase(prob, sol);
-                    }
+                motionQueue.pop_front();
+                if(mPages.Start(step.arg)){
+                    if(step.speech)
+                        LinuxActionScript::PlayMP3(step.speech);
+                    nRunningStep = STEP_MOTION;
+                    nRunningPage = step.arg;
+                    nRunningDecision = step.decision;
+                    if(step.arg == 80)
+                        mLatency.Mark(STAGE_MOTION_START);      //aiming motion of the decision
                 }
-                //Create new solution
-                else{
-                    
-                    //REUSE: create new solution using retrieved solutions
-                    Solution *newSol = mCBR->Reuse(result);
-                    
-                    xCoord = newSol->xTouch;
-                    yCoord = newSol->yTouch;
-                }
-                
-                //Compute embodiment joint mapping for aiming
-                ComputeAim(xCoord, yCoord, motion_timer);
-                
-                //Turn eyes red: shows robot is in aiming state
-                cm730->WriteWord(CM730::P_LED_HEAD_L, CM730::MakeColor(250,0,0), 0);
-                cm730->WriteWord(CM730::P_LED_EYE_L, CM730::MakeColor(250,0,0), 0);
+                break;
                 
+            case STEP_DELAY:
                 
-                Action::GetInstance()->Start(80);       //start aiming motion
-                while(Action::GetInstance()->IsRunning()) usleep(8*1000);
+                motionQueue.pop_front();
+                mTimers->Arm(&stepTimer, step.arg);
+                nRunningStep = STEP_DELAY;
+                nRunningDecision = step.decision;
+                break;
                 
-                //Send touch event command to tablet
-                sprintf(command, "touch %d %d\n", xCoord, yCoord);
-                sendto(ttsockfd,command,strlen(command),0,(struct sockaddr *)&addr2,sizeof(addr2));
+            case STEP_ACTION:
                 
-                cout << "Sent the following: " << command << endl;
+                //The decision is still on the worker
+                if(step.arg == ACTION_AIM && bDeciding)
+                    return;
                 
-                state = STATE_SHOOT;
-                usleep(500000);
-            }
+                motionQueue.pop_front();
+                RunAction(step.arg);
+                break;
+        }
+    }
+}
+
+//The motion step in progress finished.
+void AngryDarwin::EndMotionStep(){
+    
+    nRunningStep = STEP_NONE;
+    
+    if(nRunningPage == 80)
+        mLatency.Mark(STAGE_MOTION_DONE);       //aiming motion of the decision
+}
+
+//FSM actions that follow robot motions.
+void AngryDarwin::RunAction(int action){
+    
+    switch(action){
+            
+        case ACTION_AIM:{
+            
+            //Compute embodiment joint mapping for aiming, unless planned ahead
+            if(aimJoints.empty())
+                ComputeAim(xCoord, yCoord, true);
+            else
+                ApplyAim(aimJoints);
+            
+            //Turn eyes red: shows robot is in aiming state
+            mLeds->Set(LED_HEAD, 250, 0, 0);
+            mLeds->Set(LED_EYE, 250, 0, 0);
             break;
         }
-        case STATE_SHOOT:{
+        case ACTION_TOUCH:{
             
-            //User is attempting to provide demonstration. Start recording demonstration
-            if(packet.at(0)=="usertouch"){
-                
-                Action::GetInstance()->Start(85);
-                while(Action::GetInstance()->IsRunning()) usleep(8*1000);
-                bSuspendSubThread = false;
-                
-                int x = atoi(packet.at(3).c_str());
-                int y = atoi(packet.at(4).c_str());
-                if((x <= xHighLimit) && (x >= xLowLimit) && (y <=yHighLimit) && (y >= yLowLimit)){
-                    
-                    cout << "\n=================================================================================" << endl;
-                    cout << "Demonstration Recording Begin" << endl;
-                    
-#ifdef DEBUG
-                    LOG::write_log("[Demonstration Recording Begin]");
-#endif
-                    if(curCase) curCase = NULL;
-                    
-                    curCase = buildCase(prevStatePacket, packet);
-                    
-                    state = STATE_ROUND_END;
-                    
-                }
-            }
-            else if(packet.at(0)=="state"){
-                if(packet.at(5)=="state_aiming_shot"){
-                    
-                    Action::GetInstance()->Start(93);       //start shooting motion
-                    while(Action::GetInstance()->IsRunning()) usleep(8*1000);
-                    
-                    //Send release command to tablet
-                    char command[1000] = { 0 };
-                    sprintf(command, "release %d %d\n", xCoord, yCoord);
-                    sendto(ttsockfd,command,strlen(command),0,(struct sockaddr *)&addr2,sizeof(addr2));
-                    
-#ifdef DEBUG
-                    LOG::write_log(command);
-#endif
-                    
-                    //Compute embodiment joint mapping for shooting
-                    ComputeShoot(xCoord, yCoord, motion_timer);
-                    
-                    //Generate behavior (speech and gesture)
-                    LinuxActionScript::PlayMP3(Behavior::GetInstance()->RetrieveRandomSpeech(Behavior::SHOOT));
-                    Action::GetInstance()->Start(82);
-                    while(Action::GetInstance()->IsRunning()) usleep(8*1000);
-                    
-                    cout << "Sent the following: " << command << endl;
-                    
-                    state = STATE_ROUND_END;
-                }
-                else if (packet.at(5)=="state_end_round"){
-                    
-                    state = STATE_ROUND_END;
-                }
+            //Drag the touch from the sling to the aim point, as long as the aiming motion takes
+            if(mStream.IsEnabled()){
+                int dragMs = mPages.PlayTimeMs(80);
+                mStream.Start(TOUCH_SLING_X, TOUCH_SLING_Y, xCoord, yCoord, dragMs > 0 ? dragMs : TOUCH_DRAG_MS);
+                cout << "Dragging touch to " << xCoord << " " << yCoord << endl;
+                break;
             }
             
+            //Send touch event command to tablet
+            string command = SendCommand(CMD_TOUCH, xCoord, yCoord);
+            
+            cout << "Sent the following: " << command << endl;
             break;
         }
-        case STATE_ROUND_END:{
+        case ACTION_RELEASE:{
             
-            bSuspendSubThread = true;
+            //Send release command to tablet, at the end of the drag
+            mStream.Finish();
+            string command = SendCommand(CMD_RELEASE, xCoord, yCoord);
             
-            if(packet.at(0)=="state"){
-                
-                bool bRoundTimeout = false;         //Flag for round timeout. Delays time until all game physics are settled.
-                
-                if(packet.at(5) == "state_end_round"){
-                    
-                    vector< string > prevPacket = packet;
-                    
-                    while(!bRoundTimeout){
-                        
-                        n = recvfrom(ftsockfd,mesg,1000,0,(struct sockaddr *)&ftaddr,&len);
-                        mesg[n] = 0;
-                        
-                        packet = SplitPacket(mesg);
-                        
-                        cout << "STATE_ROUND_END waiting for timeout. Received the following: " << mesg << endl;
-                        
-                        if(packet.at(0)=="state"){
-                            if (packet.at(5) == "state_end_round") {
-                                if(prevPacket.at(4) == packet.at(4))
-                                    bRoundTimeout = true;
-                                prevPacket = packet;
-                            }
-                            else //other state
-                                bRoundTimeout = true;
-                        }
-                        else { //usertouch
-                            bRoundTimeout = true;
-                            packet = prevPacket;
-                        }
-                    }
-                    
-                }
-                
-                if(bRoundTimeout || (packet.at(5)=="state_end_game")){
-                    
-                    bRoundTimeout = false;
-                    
-                    if(curCase){
-                        
-                        //REVISE: Update score in problem descriptor.
-                        curCase->mProblem->score = atoi(packet.at(4).c_str()) - curCase->mProblem->score;  //update score
-                        mCBR->Revise(curCase->mProblem, curCase->mSolution);
-                        
-                        //RETAIN: Check condition for retaining.
-                        mCBR->Retain(curCase);
-                        
-                        cout << "===DEMONSTRATION DATA SAVED==== Score is " << curCase->mProblem->score << "====================================================\n\n" << endl;
 #ifdef DEBUG
-                        stringstream sstm;
-                        
-                        sstm << "ID: " << curCase->ID << endl;
-                        sstm << "Problem: level(" << curCase->mProblem->level << ") round(" << curCase->mProblem->round << ") enemy(" << curCase->mProblem->enemy << ") enemy locations (";
-                        
-                        for (int i=0; i< curCase->mProblem->enemy; i++){
-                            
-                            sstm <<"(" << curCase->mProblem->enemyLocation[2*i] << "," << curCase->mProblem->enemyLocation[2*i+1] << ") ";
-                        }
-                        
-                        sstm << ") score(" << curCase->mProblem->score << ")" << endl;
-                        
-                        sstm << "  Solution: x(" << curCase->mSolution->xTouch << ") y(" <<curCase->mSolution->yTouch << ")" << endl;
-                        
-                        LOG::write_log(sstm.str());
+            LOG::write_log(command);
 #endif
-                    }
-                    
-                    cm730->WriteWord(CM730::P_LED_EYE_L, CM730::MakeColor(0,0,255), 0);
-                    cm730->WriteWord(CM730::P_LED_HEAD_L, CM730::MakeColor(0,255,0), 0);
-                    
-                    state = RoundEndHandler(state, packet);     //Handle end of round condition
-                    
-                    const char *command = "fulltouch 400 100\n";    //send command to proceed to new round
-                    sendto(ttsockfd,command,strlen(command),0,(struct sockaddr *)&addr2,sizeof(addr2));
-                    
-                    cout << "Sent the following: " << command << endl;
-                }
-                
-            }
+            
+            //Compute embodiment joint mapping for shooting
+            ComputeShoot(xCoord, yCoord);
+            
+            cout << "Sent the following: " << command << endl;
             break;
         }
+        case ACTION_FULLTOUCH:{
             
-        case STATE_GAME_END:{
-            
-            if(packet.at(0)=="state"){
-                if((packet.at(5)=="trans_new_round") || (packet.at(5)=="state_new_round")){
-                    bSuspendSubThread = true;
-                    state = STATE_ROUND_READY;
-                }
-                else if(packet.at(5)=="state_end_game")
-                    bSuspendSubThread = false;
-            }
+            string command = SendCommand(CMD_FULLTOUCH, 400, 100);    //send command to proceed to new round
             
+            cout << "Sent the following: " << command << endl;
             break;
         }
+        case ACTION_RESUME_IDLE:{
             
-        case STATE_IDLE:{
-            
-            //Start random idle behavior
-            bSuspendSubThread = true;
-            while(Action::GetInstance()->IsRunning()) usleep(8*1000);
-            Action::GetInstance()->Start(Behavior::GetInstance()->RetrieveRandomGesture(Behavior::IDLE));
-            LinuxActionScript::PlayMP3(Behavior::GetInstance()->RetrieveRandomSpeech(Behavior::IDLE));
-            while(Action::GetInstance()->IsRunning()) usleep(8*1000);
-            bSuspendSubThread = false;
+            ResumeIdle();
+            break;
+        }
+        case ACTION_IDLE_GESTURE_DONE:{
             
-            state = STATE_GAME_END;
+            //Next gesture after a pause, unless suspended meanwhile
+            if(bIdleBehavior)
+                mTimers->Arm(&gestureTimer, IDLE_GESTURE_GAP_MS);
+            break;
+        }
+        case ACTION_IDLE_DONE:{
             
+            ResumeIdle();
+            if(state == STATE_IDLE)
+                state = STATE_GAME_END;
             break;
         }
     }
+}
+
+//Start random idle behavior. Finished by HandleMotionDone().
+void AngryDarwin::EnterIdle(){
+    
+    state = STATE_IDLE;
+    bIdle = true;
+    timeout = rand() % IDLE_TIMEOUT + IDLE_TIMEOUT_OFFSET;
+    
+    cout << "No interaction: entering idle state" << endl;
     
+    SuspendIdle();
+    QueueMotion(Behavior::GetInstance()->RetrieveRandomGesture(Behavior::IDLE), Behavior::GetInstance()->RetrieveRandomSpeech(Behavior::IDLE));
+    QueueAction(ACTION_IDLE_DONE);
 }
 
-//Split received task-status packet to string vector.
-vector< string > AngryDarwin::SplitPacket (char *msg){
-	
-	vector< string > SplitVec;
-	
-	boost::algorithm::split( SplitVec, msg, boost::is_any_of("\t "), boost::token_compress_on );
-	
-	return SplitVec;
+//Restart the idle deadline on every state change and arm the timer for the nearest deadline.
+void AngryDarwin::UpdateDeadlines(){
+    
+    if(state != prevstate){
+        prevstate = state;
+        
+        if(state == STATE_IDLE)
+            mTimers->Cancel(&idleTimer);
+        else
+            mTimers->Arm(&idleTimer, timeout * 1000);
+    }
     
+    if(state != STATE_ROUND_END){
+        mSettle.Reset();
+        mTimers->Cancel(&settleTimer);
+    }
+    
+    EventLoop::ArmTimer(timerfd, mTimers->NextDeadline());
+}
+
+//Queue a command to tablet. Returns its text form.
+string AngryDarwin::SendCommand(int cmd, int x, int y){
+    
+    char command[PACKET_SIZE];
+    
+    mSender.Enqueue(cmd, x, y);
+    
+    TabletProtocol::FormatCommand(cmd, x, y, command, PACKET_SIZE);
+    
+    return command;
 }
 
 //Build problem from received task-status packet.
-Problem* AngryDarwin::buildProblem (vector< string > packet){
+Problem* AngryDarwin::buildProblem (const TabletPacket &packet){
     
     //packet starting with "state"
     Problem *p = new Problem();
     
-    p->level = atoi(&(packet.at(1).at(5)));     //extract level number from "level1"
-    p->round = 5 - atoi(packet.at(2).c_str());  //extract round number (life = 4)
-    p->enemy = atoi(packet.at(3).c_str());      //extract remaining enemy number
+    p->level = packet.level;                    //level number from "level1"
+    p->round = 5 - packet.lives;                //round number (life = 4)
+    p->enemy = packet.enemy;                    //remaining enemy number
     
-    for(int i=0; i<p->enemy; i++){              //extract enemy locations
-        p->enemyLocation.push_back(atof(packet.at(7+2*i).c_str()));
-        p->enemyLocation.push_back(atof(packet.at(8+2*i).c_str()));
-    }
+    p->enemyLocation.assign(packet.enemyLocation, packet.enemyLocation + 2*packet.enemy);  //enemy locations
     
-    p->score = atoi(packet.at(4).c_str());      //extract current score: score is updated after a round.
+    p->score = packet.score;                    //current score: score is updated after a round.
     
 	//    cout << "[Problem] level: " << p->level << ", round: " << p->round <<", remaining enemies: " << p->enemy << ", location: " << p->enemyLocation[0] << ", " << p->enemyLocation[1] << ", score: " << p->score << endl;
     
@@ -506,12 +1027,12 @@ Problem* AngryDarwin::buildProblem (vector< string > packet){
 }
 
 //Build solution from received touch-event packet.
-Solution* AngryDarwin::buildSolution(vector< string > packet){
+Solution* AngryDarwin::buildSolution(const TabletPacket &packet){
     //packet starting with "usertouch"
     Solution *s = new Solution();
     
-    s->xTouch = atoi(packet.at(1).c_str());     //extract x-coordinate of touch event
-    s->yTouch = atoi(packet.at(2).c_str());     //extract y-coordinate of touch event
+    s->xTouch = packet.touch[0];                //x-coordinate of touch event
+    s->yTouch = packet.touch[1];                //y-coordinate of touch event
     
     //    cout << "[Solution] xTouch: " << s->xTouch << " yTouch: " << s->yTouch << endl;
     
@@ -519,13 +1040,15 @@ Solution* AngryDarwin::buildSolution(vector< string > packet){
 }
 
 //Build case from task-status and touch-event packets.
-Case* AngryDarwin::buildCase (vector< string > statePacket, vector< string > touchPacket){
+Case* AngryDarwin::buildCase (const TabletPacket &statePacket, const TabletPacket &touchPacket){
     
     Case *newCase = new Case();
     newCase->mProblem = buildProblem(statePacket);
     newCase->mSolution = buildSolution(touchPacket);
     
-    newCase->ID = CBRLfD::nIDGenerator;
+    newCase->ID = mCBR->nIDGenerator;
+    newCase->robotID = mCBR->nRobotID;
+    newCase->epoch = mCBR->nEpoch;
     
     return newCase;
     
@@ -534,163 +1057,92 @@ Case* AngryDarwin::buildCase (vector< string > statePacket, vector< string > tou
 //Build case from current problem and solution
 Case* AngryDarwin::buildCase (Problem *p, Solution *s){
     
-    Case *newCase = new Case(p, s, CBRLfD::nIDGenerator);
+    Case *newCase = new Case(p, s, mCBR->nIDGenerator, mCBR->nRobotID, mCBR->nEpoch);
     
     return newCase;
 }
 
 //Joint mapping of 2-dimensional tablet surface to robot upper-body joints.
 //Each motion is defined on a "page" where joint position and timing values are stored.
-int AngryDarwin::SetJointValue(LinuxMotionTimer *timer, int pageindex, int stepindex, int posindex, int value){
-        
-	timer->Stop();      //stop motion timer
-	
-	Action::PAGE Page;
-	
-	if(pageindex > 0 && pageindex < Action::MAXNUM_PAGE)
-	{
-		Action::GetInstance()->LoadPage(pageindex, &Page);      //Retrieve the motion page
-	}
-	else {
-		return -1;
-	}
+//Compute pitch and roll for aiming angle 
+vector< int > AngryDarwin::ComputeAim(int x, int y, bool bApply){
     
-	if(stepindex >= 0 && stepindex < Action::MAXNUM_STEP)       //Check step range
-	{
-        if(posindex == -1){
-            Page.step[stepindex].time = value;
-        }
-        else{
-            if(value >= 0 && value <= MX28::MAX_VALUE)          //Check joint range
-            {
-                if(!(Page.step[stepindex].position[posindex] & Action::INVALID_BIT_MASK))
-                {
-                    Page.step[stepindex].position[posindex] = value;        //modify joint position
-                }
-            }
-            else{
-                cout << "Invalid value range" << endl;          
-                return -1;
-            }
-        }
-		
-	}
-	else{
-		cout << "Invalid step index" << endl;
-		return -1;
-	}
-	
-	if(Action::GetInstance()->SavePage(pageindex, &Page) == true){
-		timer->Start();     //restart motion timer
-		return 1;
-	}
-	
-	return 0;
-	
+    vector< int > pr = AimJoints(x, y);
+    
+    //Update joint mapping
+    if(bApply)
+        ApplyAim(pr);
+    
+    return pr;
 }
 
-//Compute pitch and roll for aiming angle 
-vector< int > AngryDarwin::ComputeAim(int x, int y, LinuxMotionTimer *timer){
+//Pitch and roll of the aiming angle, without side effects
+vector< int > AngryDarwin::AimJoints(int x, int y){
     
     vector< int > pr;
     
     pr.push_back(0.001*y*y - 1.5699*y + 2854);  //pitch
     pr.push_back(1.72*x + 1422);                //roll
     
-    //Update joint mapping
-    if(timer){
-        SetJointValue(timer, 93, 0, JointData::ID_R_SHOULDER_PITCH, pr[0]);
-        SetJointValue(timer, 93, 0, JointData::ID_R_SHOULDER_ROLL, pr[1]);
-    }
-    
     return pr;
 }
 
+//Write aiming pitch and roll into the shooting page
+void AngryDarwin::ApplyAim(const vector< int > &pr){
+    
+    mLatency.Mark(STAGE_AIM);
+    if(mPages.BeginEdit(93)){
+        mPages.SetJoint(0, JointData::ID_R_SHOULDER_PITCH, pr[0]);
+        mPages.SetJoint(0, JointData::ID_R_SHOULDER_ROLL, pr[1]);
+        mPages.Commit();
+    }
+    mLatency.Mark(STAGE_PAGE_EDIT);
+}
+
 //Compute pitch, roll, elbow, and speed for shooting angle and power 
-vector< int > AngryDarwin::ComputeShoot(int x, int y, LinuxMotionTimer *timer){
+vector< int > AngryDarwin::ComputeShoot(int x, int y){
     
-    vector< int > pres = ComputeAim((-2.1899*x+478.4884), (-2.1899*y+622.0349), NULL); //pitch-roll
-    float distance = sqrt((x-150)*(x-150)+(y-195)*(y-195));
+    vector< int > pres = ComputeAim((-2.1899*x+478.4884), (-2.1899*y+622.0349), false); //pitch-roll
+    float distance = sqrt((x-TOUCH_SLING_X)*(x-TOUCH_SLING_X)+(y-TOUCH_SLING_Y)*(y-TOUCH_SLING_Y));
         
     pres.push_back(-1.8556*distance+1528);          //elbow
     pres.push_back(0.3333*distance+75);             //speed
     
     //Update joint mapping
-    SetJointValue(timer, 82, 0, JointData::ID_R_SHOULDER_PITCH, pres[0]);
-    SetJointValue(timer, 82, 0, JointData::ID_R_SHOULDER_ROLL, pres[1]);
-    SetJointValue(timer, 82, 0, JointData::ID_R_ELBOW, pres[2]);
-    SetJointValue(timer, 82, 0, JointData::ID_HEAD_PAN, max((int)(-2.1268*pres[1]+5344), 1652));
-    SetJointValue(timer, 82, 0, JointData::ID_HEAD_TILT, 0.4808*pres[0]+768);
-    SetJointValue(timer, 82, 0, -1, pres[3]);
+    if(mPages.BeginEdit(82)){
+        mPages.SetJoint(0, JointData::ID_R_SHOULDER_PITCH, pres[0]);
+        mPages.SetJoint(0, JointData::ID_R_SHOULDER_ROLL, pres[1]);
+        mPages.SetJoint(0, JointData::ID_R_ELBOW, pres[2]);
+        mPages.SetJoint(0, JointData::ID_HEAD_PAN, max((int)(-2.1268*pres[1]+5344), 1652));
+        mPages.SetJoint(0, JointData::ID_HEAD_TILT, 0.4808*pres[0]+768);
+        mPages.SetTime(0, pres[3]);
+        mPages.Commit();
+    }
     
     return pres;
 }
 
 //At the end of the round, generate robot behavior (speech and gesture)
-int AngryDarwin::RoundEndHandler(int curState, vector< string > packet){
+int AngryDarwin::RoundEndHandler(int curState, const TabletPacket &packet){
     
     int state = curState;
     
-    bSuspendSubThread = true;
-    while(Action::GetInstance()->IsRunning()) usleep(8*1000);
+    SuspendIdle();
     
-    if(packet.at(3) == "0"){ //victory
-        Action::GetInstance()->Start(Behavior::GetInstance()->RetrieveRandomGesture(Behavior::VICTORY));
-        LinuxActionScript::PlayMP3(Behavior::GetInstance()->RetrieveRandomSpeech(Behavior::VICTORY));
-        while(Action::GetInstance()->IsRunning()) usleep(8*1000);
+    if(packet.enemy == 0){ //victory
+        QueueMotion(Behavior::GetInstance()->RetrieveRandomGesture(Behavior::VICTORY), Behavior::GetInstance()->RetrieveRandomSpeech(Behavior::VICTORY));
         state = STATE_GAME_END;
-    } else if(packet.at(2) == "0"){ //no ghost left
-        Action::GetInstance()->Start(Behavior::GetInstance()->RetrieveRandomGesture(Behavior::LOST));
-        LinuxActionScript::PlayMP3(Behavior::GetInstance()->RetrieveRandomSpeech(Behavior::LOST));
-        while(Action::GetInstance()->IsRunning()) usleep(8*1000);
+    } else if(packet.lives == 0){ //no ghost left
+        QueueMotion(Behavior::GetInstance()->RetrieveRandomGesture(Behavior::LOST), Behavior::GetInstance()->RetrieveRandomSpeech(Behavior::LOST));
         state = STATE_GAME_END;
     } else { //game continues
-        Action::GetInstance()->Start(85);
-        while(Action::GetInstance()->IsRunning()) usleep(8*1000);
+        QueueMotion(85);
         state = STATE_ROUND_READY;
     }
         
     return state;
 }
 
-//Idle thread: generate random idle behavior
-void* AngryDarwin::Idle_thread(void* ptr)
-{
-    AngryDarwin *pMain = (AngryDarwin*) ptr;
-    
-    int r,g,b;
-    
-    while(1) {
-        
-        if(!pMain->bSuspendSubThread){
-            
-            r = rand()%255;
-            g = rand()%255;
-            b = rand()%255;
-            
-            pMain->GetCM730()->WriteWord(CM730::P_LED_HEAD_L, CM730::MakeColor(r,g,b), 0);
-            
-            r = rand()%255;
-            g = rand()%255;
-            b = rand()%255;
-            
-            pMain->GetCM730()->WriteWord(CM730::P_LED_EYE_L, CM730::MakeColor(r,g,b), 0);
-            
-            while(Action::GetInstance()->IsRunning()) usleep(8*1000);
-            if(!Action::GetInstance()->IsRunning()){
-                
-                Action::GetInstance()->Start(Behavior::GetInstance()->RetrieveRandomGesture(Behavior::NEUTRAL));
-                LinuxActionScript::PlayMP3(Behavior::GetInstance()->RetrieveRandomSpeech(Behavior::NEUTRAL));
-                while(Action::GetInstance()->IsRunning()) usleep(8*1000);
-            }
-            
-            usleep(1000);
-        }
-        
-    }
-    return NULL;
-}
-
 void AngryDarwin::change_current_dir()
 {
     char exepath[1024] = {0};
@@ -712,72 +1164,137 @@ int _getch()
     return ch;
 }
 
-int ConvertStand2Sit(LinuxMotionTimer *timer, int pageindex){
-	
-	timer->Stop();
+int ConvertStand2Sit(MotionPageCache &pages, int pageindex){
 	
 	Action::PAGE Page;
     Action::PAGE Page_Sit;
 	
-	if(pageindex > 0 && pageindex < Action::MAXNUM_PAGE)
-	{
-		Action::GetInstance()->LoadPage(pageindex, &Page);
-        Action::GetInstance()->LoadPage(85, &Page_Sit);
-        
-	}
-	else {
+	if(!pages.GetPage(pageindex, Page) || !pages.GetPage(85, Page_Sit))
 		return -1;
-	}
+    
+    if(!pages.BeginEdit(pageindex))
+        return -1;
     
     for(int i=0; i < Page.header.stepnum; i++){
         for(int j= JointData::ID_R_HIP_YAW; j <= JointData::ID_L_ANKLE_ROLL; j++){
-            Page.step[i].position[j] = Page_Sit.step[0].position[j];
+            pages.SetJoint(i, j, Page_Sit.step[0].position[j]);
         }
     }
 	
-	if(Action::GetInstance()->SavePage(pageindex, &Page) == true){
-		timer->Start();
+	if(pages.Commit())
 		return 1;
-	}
 	
 	return 0;
 	
 }
 
-int AddHeadPan(LinuxMotionTimer *timer, int pageindex, int value){
-	
-	timer->Stop();
+int AddHeadPan(MotionPageCache &pages, int pageindex, int value){
 	
 	Action::PAGE Page;
 	
-	if(pageindex > 0 && pageindex < Action::MAXNUM_PAGE)
-	{
-		Action::GetInstance()->LoadPage(pageindex, &Page);
-	}
-	else {
+	if(!pages.GetPage(pageindex, Page) || !pages.BeginEdit(pageindex))
 		return -1;
-	}
     
     for(int i=0; i < Page.header.stepnum; i++){
         
-        Page.step[i].position[JointData::ID_HEAD_PAN] += value;
+        pages.SetJoint(i, JointData::ID_HEAD_PAN, Page.step[i].position[JointData::ID_HEAD_PAN] + value);
         
     }
 	
-	if(Action::GetInstance()->SavePage(pageindex, &Page) == true){
-		timer->Start();
+	if(pages.Commit())
 		return 1;
-	}
 	
 	return 0;
 	
 }
 
 
-int main(void)
+int main(int argc, char *argv[])
 {
+    //Command-line options
+    //  -r id           robot ID (default ROBOT_ID)
+    //  -p port         enable case-base replication on port (default REPLICA_PORT)
+    //  -P ip:port      replication peer (repeatable)
+    //  -l log          rebuild the case base from a demonstration log (repeatable)
+    //  -t records      keep retrieval traces, dumped to the log on SIGUSR1
+    //  -b              offer the binary tablet protocol
+    //  -s rate         drag the touch to the aim point with move commands at rate Hz (e.g. 120)
+    //  -c file         capture every datagram from and to tablet (see ReplayCapture)
+    //  -T ip[:port]    tablet address (default TABLET_IP:TO_TABLET_PORT)
+    //  -L path         serve the decision latency table on a unix socket (also printed on SIGUSR2)
+    //  -w ms[:max]     settle the end of round after ms of a stable score, at most max ms (default ROUND_SETTLE_MS:ROUND_SETTLE_MAX_MS)
+    //  -m              keep motion page edits in memory, do not write them back to MOTION_FILE_PATH
+    int robotID = ROBOT_ID;
+    int replicationPort = 0;
+    vector< string > peers;
+    vector< string > logs;
+    int traceCapacity = 0;
+    bool bBinary = false;
+    int streamRate = 0;
+    const char *capturePath = NULL;
+    string tablet;
+    const char *latencyPath = NULL;
+    unsigned settleMs = ROUND_SETTLE_MS, settleMaxMs = ROUND_SETTLE_MAX_MS;
+    bool bWriteBack = true;
+    int opt;
+    
+    while((opt = getopt(argc, argv, "r:p:P:l:t:bs:c:T:L:w:m")) != -1){
+        switch(opt){
+            case 'r': robotID = atoi(optarg); break;
+            case 'p': replicationPort = atoi(optarg); break;
+            case 'P': peers.push_back(optarg); break;
+            case 'l': logs.push_back(optarg); break;
+            case 't': traceCapacity = atoi(optarg); break;
+            case 'b': bBinary = true; break;
+            case 's': streamRate = atoi(optarg); break;
+            case 'c': capturePath = optarg; break;
+            case 'T': tablet = optarg; break;
+            case 'L': latencyPath = optarg; break;
+            case 'w':{
+                char *max = strchr(optarg, ':');
+                settleMs = atoi(optarg);
+                if(max)
+                    settleMaxMs = atoi(max + 1);
+                break;
+            }
+            case 'm': bWriteBack = false; break;
+            default:
+                printf("usage: %s [-r robot_id] [-p replication_port] [-P peer_ip:port ...] [-l log ...] [-t trace_records] [-b] [-s stream_hz] [-c capture_file] [-T tablet_ip[:port]] [-L latency_socket] [-w settle_ms[:max_ms]] [-m]\n", argv[0]);
+                return 1;
+        }
+    }
     
-    AngryDarwin *angrydarwin = new AngryDarwin();
+    AngryDarwin *angrydarwin = new AngryDarwin(robotID);
+    
+    if(!tablet.empty()){
+        vector< string > addr;
+        boost::algorithm::split( addr, tablet, boost::is_any_of(":") );
+        angrydarwin->SetTabletAddress(addr[0].c_str(), addr.size() > 1 ? atoi(addr[1].c_str()) : TO_TABLET_PORT);
+    }
+    
+    if(capturePath)
+        angrydarwin->EnableCapture(capturePath);
+    
+    if(!logs.empty())
+        angrydarwin->LoadDemonstrationLogs(logs);
+    
+    if(traceCapacity > 0)
+        angrydarwin->EnableRetrievalTrace(traceCapacity);
+    
+    if(replicationPort > 0 || !peers.empty())
+        angrydarwin->StartReplication(replicationPort > 0 ? replicationPort : REPLICA_PORT, peers);
+    
+    if(bBinary)
+        angrydarwin->EnableBinaryProtocol();
+    
+    if(streamRate > 0)
+        angrydarwin->EnableTouchStream(streamRate);
+    
+    if(latencyPath)
+        angrydarwin->EnableLatencySocket(latencyPath);
+    
+    angrydarwin->SetSettleTime(settleMs, settleMaxMs);
+    angrydarwin->SetPageWriteBack(bWriteBack);
     
     printf( "\n===== Angry DARwIn =====\n\n");
 #ifdef DEBUG
@@ -786,11 +1303,7 @@ int main(void)
     LOG::write_log("\n===== Angry DARwIn =====\n\n");
 #endif
     
-    while(1)
-    {
-		angrydarwin->RunStateMachine();
-        
-    }
+    angrydarwin->RunStateMachine();
     
     delete angrydarwin;
     
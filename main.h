@@ -33,10 +33,12 @@
 #include <time.h>
 #include <ctime>
 #include <pthread.h>
+#include <signal.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <cstdlib>
 #include <vector>
+#include <deque>
 #include <boost/algorithm/string.hpp>
 #include <cmath>
 
@@ -58,6 +60,23 @@
 //#include "ColorFinder.h"
 
 #include "CBRLfD_Simple.h"      //CBR-LfD (simplified) class header
+#include "TabletPacket.h"       //Tablet packet parsing
+#include "TabletProtocol.h"     //Binary tablet protocol
+#include "PacketCapture.h"      //Datagram capture
+#include "PacketReceiver.h"     //Network receiver thread
+#include "CommandSender.h"      //Asynchronous command sender
+#include "TouchStream.h"        //Touch-drag streaming
+#include "DecisionLatency.h"    //Per-stage decision latency histograms
+#include "PreAim.h"             //Speculative retrieval and aim ahead of the round
+#include "SettleDetector.h"     //End-of-round settle detection
+#include "StateTable.h"         //Table-driven state machine
+#include "EventLoop.h"          //epoll event loop
+#include "TimerWheel.h"         //Timers of the state machine
+#include "MotionPageCache.h"    //Motion pages in memory, edited in transactions
+#include "MotionWatcher.h"      //Motion-completion notifier
+#include "LedController.h"      //Head and eye LEDs, written on the motion tick
+#include "Replication.h"        //Case-base replication between robots
+#include "LogIngest.h"          //Case-base reconstruction from demonstration logs
 #include "Behavior.h"           //Robot gesture+speech behavior class header
 #include "Log.h"   
 
@@ -71,40 +90,77 @@
 #define TO_TABLET_PORT		8888
 
 //-------------------------------------------------------------
-// Robot is communicating with the tablet and generates
-// synthesized touch events. Inverse kinematics for the robot's
-// 6-DOF upper body and 2-DOF head is computed for the tablet region.
-// The following limits are defining the tablet screen region where the
-// robot is able to interact.
+// Tablet region limits (xLowLimit .. yHighLimit), end-of-round settle time
+// (ROUND_SETTLE_MS, ROUND_SETTLE_MAX_MS, -w window[:max]) and aim hold time (AIM_HOLD_MS)
+// are shared with the session server.
 //-------------------------------------------------------------
-#define xLowLimit   138
-#define xHighLimit  180
-#define yLowLimit   178
-#define yHighLimit  212
+#include "GameConstants.h"
 
 //-------------------------------------------------------------
-// Robot puts itself to an idle mode after certain period of no interaction.
+// Robot puts itself to an idle mode after certain period (seconds) of no interaction.
 //-------------------------------------------------------------
 #define IDLE_TIMEOUT        15
 #define IDLE_TIMEOUT_OFFSET 7
 
+//-------------------------------------------------------------
+// Idle behavior plays neutral gestures IDLE_GESTURE_GAP_MS (msec) apart.
+// A gesture due while other motions play is tried again IDLE_GESTURE_RETRY_MS later.
+//-------------------------------------------------------------
+#define IDLE_GESTURE_GAP_MS     1
+#define IDLE_GESTURE_RETRY_MS   100
+
+//-------------------------------------------------------------
+// Touch-drag streaming (-s rate): the finger goes down at the sling and is dragged
+// to the aim point along with the aiming motion, in the play time of its page (80).
+// TOUCH_DRAG_MS (msec) is used when the page timing is unknown.
+//-------------------------------------------------------------
+#define TOUCH_SLING_X       150
+#define TOUCH_SLING_Y       195
+#define TOUCH_DRAG_MS       600
+
 //-------------------------------------------------------------
 // If this parameter is set, robot is able to store its own trial cases.
 // If not, robot only stores demonstrated cases.
 //-------------------------------------------------------------
 #define SELF_TRAIN	true
 
+//-------------------------------------------------------------
+// Robots sharing a case base are told apart by their robot ID.
+// Cases are identified by (robot ID, case sequence number).
+// Replication is enabled from the command line (-p port -P ip:port ..., see Replication.h).
+//-------------------------------------------------------------
+#ifndef ROBOT_ID
+#define ROBOT_ID            1
+#endif
+
 
-//Angry Darwin state machine states enum.
+//Angry Darwin state machine states, events and transition rules.
+#include "GameStates.h"
+
+//Motion step types. Robot motions and the FSM actions following them are queued, so that the FSM never waits.
 enum{
-    STATE_ROUND_READY,
-    STATE_AIM,
-    STATE_SHOOT,
-    STATE_ROUND_END,
-    STATE_GAME_END,
-    STATE_DEMONSTRATION,
-    STATE_SELF_TRAIN,
-    STATE_IDLE
+    STEP_NONE,
+    STEP_MOTION,            //play a motion page (with speech)
+    STEP_DELAY,             //pause
+    STEP_ACTION             //run an FSM action
+};
+
+//FSM actions queued after motions.
+enum{
+    ACTION_AIM,             //compute aim joint mapping, turn eyes red
+    ACTION_TOUCH,           //send touch command
+    ACTION_RELEASE,         //send release command, compute shoot joint mapping
+    ACTION_FULLTOUCH,       //send command to proceed to new round
+    ACTION_RESUME_IDLE,     //resume idle behavior
+    ACTION_IDLE_GESTURE_DONE,   //neutral idle gesture finished
+    ACTION_IDLE_DONE        //idle behavior finished
+};
+
+struct MotionStep{
+    int type;
+    int arg;                //page, msec or action
+    const char *speech;
+    unsigned decision;      //decision whose aim the step belongs to, 0 if none
 };
 
 using std::string;
@@ -129,71 +185,190 @@ using namespace Robot;
 //      - Sending sythesized touch event to the tablet.
 //      - Managing these steps with a finite-state machine.
 //-------------------------------------------------------------
-class AngryDarwin{
+class AngryDarwin : public EventHandler, public TimerHandler{
     
 public:
-    AngryDarwin();
+    AngryDarwin(int robotID = ROBOT_ID);
     ~AngryDarwin();
     
-    //Angry Darwin finite-state machine
+    //Angry Darwin finite-state machine. Runs the event loop.
     void RunStateMachine();
     
-    //Idle thread activated when human interaction is absent for certain time.
-    static void *Idle_thread(void* ptr);
+    //Tablet packet, deadline and motion-completion events (EventHandler).
+    void OnEvent(int fd);
+    
+    //Idle, round settle and motion step timers (TimerHandler).
+    void OnTimer(Timer *timer);
+    
+    //Stream retained cases to peer robots ("ip:port") and merge theirs.
+    bool StartReplication(int port, const vector< string > &peers);
+    
+    //Rebuild the case base from demonstration logs written by previous sessions.
+    int LoadDemonstrationLogs(const vector< string > &logs);
+    
+    //Offer the binary tablet protocol. Text stays in use until the tablet accepts.
+    void EnableBinaryProtocol();
+    
+    //Drag the touch to the aim point with move commands at rate Hz.
+    bool EnableTouchStream(unsigned rate);
+    
+    //Record every datagram from and to tablet to a capture file (see ReplayCapture).
+    bool EnableCapture(const char *path);
+    
+    //Send commands to the tablet at ip:port instead of TABLET_IP:TO_TABLET_PORT.
+    void SetTabletAddress(const char *ip, int port);
+    
+    //Keep structured traces of the last capacity retrievals. Dumped to the log on SIGUSR1.
+    void EnableRetrievalTrace(unsigned capacity);
+    static void DumpTraceSignal(int sig);
+    
+    //Settle the end of round after windowMs of a stable score, at the latest maxMs after it.
+    void SetSettleTime(unsigned windowMs, unsigned maxMs);
+    
+    //Write motion page edits back to the motion file (on by default), or keep them in memory only.
+    void SetPageWriteBack(bool bWriteBack);
+    
+    //Serve the decision latency table on a unix socket. It is also printed on SIGUSR2.
+    bool EnableLatencySocket(const char *path);
+    static void DumpLatencySignal(int sig);
+    
+    //Aim joint targets (shoulder pitch, roll) of a tablet point. Safe to call from any thread.
+    static vector< int > AimJoints(int x, int y);
     
     
 private:
     
     CBRLfD *mCBR;
+    CaseReplicator *mReplicator;
 
     //Socket variables
     int ftsockfd, ttsockfd, n;
     struct sockaddr_in addr1, addr2, ftaddr;
-    socklen_t len;
-    char mesg[1000];
+    const char *mesg;           //text form of the packet being handled
+    TabletProtocol mProtocol;   //text or negotiated binary protocol
+    PacketCapture mCapture;     //datagram capture, if enabled
+    PacketReceiver mReceiver;   //receives and parses packets on its own thread
+    CommandSender mSender;      //sends commands on its own thread
+    TouchStream mStream;        //drags the touch along the aim path
+    DecisionLatency mLatency;   //stage timeline of decisions
+    const ReceivedPacket *mReceived;    //packet being handled
+    long long ReceivedUs();     //receipt of the packet being handled (usec), now if none
+    PreAim mPreAim;             //plans the aim of the next round while the robot sits
+    bool bOfferBinary;
 
     //Robot framework variables
     LinuxCM730 *linux_cm730;
     CM730 *cm730;
     LinuxMotionTimer *motion_timer;
+    MotionPageCache mPages;     //motion pages played from memory and edited in transactions
+    LedController *mLeds;       //LED colors and effects, flushed on the motion tick
 	
-    pthread_t thread_t;    
     
 	int state;              //current state
     int prevstate;          //previous state
 	int xCoord, yCoord;     //tablet (x,y) coordinates
+    vector< int > aimJoints;    //aim joint targets planned ahead, empty if computed by ACTION_AIM
+    bool bDeciding;             //decision on the PreAim worker: ACTION_AIM waits for it
+    unsigned nDecision;         //decision whose aim steps are queued or running, 0 if none
+    unsigned nDecisionSeq;      //last decision id
+    unsigned nQueueDecision;    //decision tagged onto the steps queued now, 0 if none
+    Problem *decisionProblem;   //problem of the decision, kept for self training
 
-    vector< string > packet, prevStatePacket;   //received packet is splitted and stored in vector
+    TabletPacket packet, prevStatePacket;   //received packet is parsed in place into fields
 	Case *curCase;
     
+    //Event loop: tablet socket, timerfd of the timer wheel and motion-completion notifier
+    EventLoop mLoop;
+    TimerWheel *mTimers;
+    int timerfd;
+    
     //Idle timeout variables
     bool bIdle;
-    int idlecount;
+    Timer idleTimer;
     int timeout;
-    bool bSuspendSubThread;
+    
+    //Idle behavior: neutral gestures while no round needs the robot
+    bool bIdleBehavior;
+    Timer gestureTimer;
+    
+    //CPU usage at the last report
+    long long cpuMarkUs, cpuMarkFsmUs, cpuMarkWallUs;
+    
+    //Round settle variables
+    SettleDetector mSettle;
+    Timer settleTimer;
+    TabletPacket settlePacket;
+    
+    //Motion steps
+    std::deque< MotionStep > motionQueue;
+    int nRunningStep;       //type of the step in progress, STEP_NONE if none
+    int nRunningPage;       //page of the last motion step started
+    unsigned nRunningDecision;  //decision of the step in progress, 0 if none
+    Timer stepTimer;
     
     //Initialize socket and robot framework
     void change_current_dir();
     void InitSocket();
     
-    //Parse received task-status packet from tablet.
-    vector< string > SplitPacket (char *msg);
+    //Event handlers
+    void HandlePackets();
+    void HandlePacket(bool bParsed);
+    void HandleTimer();
+    void HandleMotionDone();
+    void EnterIdle();
+    void FinishRound(const TabletPacket &packet, int reason);
+    void UpdateDeadlines();
+    
+    //State machine: transition table compiled from GameRules (GameStates.h), and the actions of its transitions
+    friend struct GameRules< AngryDarwin >;
+    static const StateTable< AngryDarwin, STATE_COUNT, EVENT_COUNT > stateTable;
+    int PacketEvent();
+    void SuspendIdle();
+    void ResumeIdle();
+    void PlayIdleGesture();
+    void PrintCpuUsage();
+    void EnterRoundReady();
+    void RecordDemonstration();
+    void Demonstrate();
+    void InterruptShot();
+    void DemonstrateInShot();
+    void Decide();
+    void HandleDecision();
+    void Aim(const AimPlan &plan);
+    void CancelDecision();
+    void QueueAim();
+    void Shoot();
+    void Settle();
+    void SettleTimeout();
+    void OpenRound();
+    void EndRound();
+    void EndRoundOnTouch();
+    
+    //Motion steps
+    void QueueMotion(int page, const char *speech = NULL);
+    void QueueDelay(unsigned ms);
+    void QueueAction(int action);
+    void RunMotionQueue();
+    void EndMotionStep();
+    void RunAction(int action);
+    
+    //Queue a command to tablet for the command sender. Returns its text form.
+    string SendCommand(int cmd, int x, int y);
     
     //Convert received packet data into problem and solution.
-    Problem* buildProblem (vector< string > packet);
-    Solution* buildSolution(vector< string > packet);
-    Case* buildCase (vector< string > statePacket, vector< string > touchPacket);
+    Problem* buildProblem (const TabletPacket &packet);
+    Solution* buildSolution(const TabletPacket &packet);
+    Case* buildCase (const TabletPacket &statePacket, const TabletPacket &touchPacket);
     Case* buildCase (Problem *p, Solution *s);
     
-    //Edit motion file to reflect new joint data.
-    int SetJointValue(LinuxMotionTimer *timer, int pageindex, int stepindex, int posindex, int value);
-    
     //Compute IK of the upper 6-dof arm pitch-roll-yaw and 2-dof head pan and tilt.
-    vector< int > ComputeAim(int x, int y, LinuxMotionTimer *timer);
-    vector< int > ComputeShoot(int x, int y, LinuxMotionTimer *timer);
+    //The joint data are committed to the motion pages in memory (see MotionPageCache).
+    vector< int > ComputeAim(int x, int y, bool bApply);
+    void ApplyAim(const vector< int > &pr);
+    vector< int > ComputeShoot(int x, int y);
     
     
-    int RoundEndHandler(int curState, vector< string > packet);
+    int RoundEndHandler(int curState, const TabletPacket &packet);
     
     LinuxMotionTimer* GetMotionTimer(){ return motion_timer;};
     CM730* GetCM730(){ return cm730;};